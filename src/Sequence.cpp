@@ -40,15 +40,18 @@
 #include "E131.h"
 #include "channeloutputthread.h"
 #include "common.h"
+#include "e131bridge.h"
 #include "events.h"
 #include "effects.h"
 #include "fpp.h" // for FPPstatus && #define-d status values
 #include "fppd.h"
 #include "log.h"
 #include "MultiSync.h"
+#include "OutputMetrics.h"
 #include "PixelOverlay.h"
 #include "Sequence.h"
 #include "settings.h"
+#include "Threads.h"
 #include <chrono>
 using namespace std::literals;
 using namespace std::chrono_literals;
@@ -58,6 +61,9 @@ using namespace std::literals::chrono_literals;
 
 Sequence *sequence = NULL;
 
+// frame number used in a read request to park the read thread
+#define SEQUENCE_READ_IDLE 0xFFFFFFFF
+
 Sequence::Sequence()
   :
     m_seqDuration(0),
@@ -73,20 +79,34 @@ Sequence::Sequence()
     m_seqLastControlMajor(0),
     m_seqLastControlMinor(0),
     m_remoteBlankCount(0),
-    m_readThread(nullptr),
-    m_lastFrameRead(-1),
-    m_doneRead(false),
+    m_dataProcessed(false),
+    frameCacheHead(0),
+    frameCacheTail(0),
+    m_readEpoch(0),
+    m_readStartFrame(0),
+    m_nextFrame(0),
+    m_readRequest(SEQUENCE_READ_IDLE),
+    m_readPosition(0),
+    m_doneReadEpoch(0),
     m_shuttingDown(false),
-    m_dataProcessed(false)
+    m_readThread(nullptr),
+    m_readThreadWaiting(false),
+    m_outputThreadWaiting(false)
 {
     m_seqFilename[0] = 0;
-    memset(m_seqData, 0, sizeof(m_seqData));
+    memset(m_seqDataBuffers, 0, sizeof(m_seqDataBuffers));
+    memset(m_seqDataNeedsBlank, 0, sizeof(m_seqDataNeedsBlank));
+    memset(m_seqDataSyncTime, 0, sizeof(m_seqDataSyncTime));
+    m_seqDataBuffer = 0;
+    m_seqData = m_seqDataBuffers[0];
 }
 
 Sequence::~Sequence()
 {
     m_shuttingDown = true;
-    frameLoadSignal.notify_all();
+    std::unique_lock<std::mutex> lock(frameReadLock);
+    lock.unlock();
+    frameReadSignal.notify_all();
     if (m_readThread) {
         m_readThread->join();
         delete m_readThread;
@@ -96,10 +116,71 @@ Sequence::~Sequence()
         delete m_seqFile;
     }
 }
+
+/*
+ * Single producer/single consumer frame ring.  The read thread is the only
+ * one that advances the tail, the consumer (whoever holds m_sequenceLock)
+ * is the only one that advances the head.
+ */
+bool Sequence::frameCacheFull() const {
+    return ((frameCacheTail + 1) % (SEQUENCE_CACHE_FRAMECOUNT + 1)) == frameCacheHead;
+}
+
+bool Sequence::frameCacheEmpty() const {
+    return frameCacheHead == frameCacheTail;
+}
+
+bool Sequence::pushCachedFrame(FSEQFile::FrameData *fd, uint32_t epoch) {
+    if (frameCacheFull())
+        return false;
+
+    uint32_t tail = frameCacheTail.load(std::memory_order_relaxed);
+    frameCache[tail].frame = fd;
+    frameCache[tail].epoch = epoch;
+    frameCacheTail = (tail + 1) % (SEQUENCE_CACHE_FRAMECOUNT + 1);
+    return true;
+}
+
+FSEQFile::FrameData *Sequence::popCachedFrame() {
+    while (true) {
+        FSEQFile::FrameData *fd = nullptr;
+        if (!rewoundFrameCache.empty()) {
+            fd = rewoundFrameCache.front();
+            rewoundFrameCache.pop_front();
+        } else if (frameCacheEmpty()) {
+            return nullptr;
+        } else {
+            uint32_t head = frameCacheHead.load(std::memory_order_relaxed);
+            fd = frameCache[head].frame;
+            uint32_t epoch = frameCache[head].epoch;
+            frameCacheHead = (head + 1) % (SEQUENCE_CACHE_FRAMECOUNT + 1);
+            wakeReadThread();
+
+            if (epoch != m_readEpoch) {
+                //read before the last seek, we don't need this frame anymore
+                delete fd;
+                continue;
+            }
+        }
+        if ((int)fd->frame < m_nextFrame) {
+            //skipped while we were waiting on it
+            delete fd;
+            continue;
+        }
+        return fd;
+    }
+}
+
 void Sequence::clearCaches() {
-    while (!frameCache.empty()) {
-        delete frameCache.front();
-        frameCache.pop_front();
+    while (!frameCacheEmpty()) {
+        uint32_t head = frameCacheHead.load(std::memory_order_relaxed);
+        delete frameCache[head].frame;
+        frameCacheHead = (head + 1) % (SEQUENCE_CACHE_FRAMECOUNT + 1);
+    }
+    wakeReadThread();
+    while (!rewoundFrameCache.empty()) {
+        delete rewoundFrameCache.front();
+        rewoundFrameCache.pop_front();
     }
     while (!pastFrameCache.empty()) {
         delete pastFrameCache.front();
@@ -107,58 +188,132 @@ void Sequence::clearCaches() {
     }
 }
 
+/*
+ * Start a new read epoch with the read thread reading from the given frame.
+ * Frames the read thread may still push for the old epoch are dropped when
+ * they are popped.
+ */
+void Sequence::startReading(uint32_t frame) {
+    m_readEpoch++;
+    m_readStartFrame = (frame == SEQUENCE_READ_IDLE) ? 0 : frame;
+    m_nextFrame = m_readStartFrame;
+    m_readRequest = ((uint64_t)m_readEpoch << 32) | frame;
+    if (frame == SEQUENCE_READ_IDLE) {
+        setDoneReadEpoch(m_readEpoch);
+    }
+    wakeReadThread();
+}
+
+void Sequence::setDoneReadEpoch(uint32_t epoch) {
+    //a late store from the read thread must not move this backwards
+    uint32_t cur = m_doneReadEpoch;
+    while (cur < epoch && !m_doneReadEpoch.compare_exchange_weak(cur, epoch)) {
+    }
+}
+
+bool Sequence::frameReadDone() const {
+    return m_doneReadEpoch == m_readEpoch;
+}
+
+int Sequence::nextFrameToRead() const {
+    uint64_t pos = m_readPosition;
+    if ((uint32_t)(pos >> 32) == m_readEpoch)
+        return (uint32_t)pos;
+
+    //read thread hasn't read anything for this epoch yet
+    return m_readStartFrame;
+}
+
+void Sequence::wakeReadThread() {
+    if (m_readThreadWaiting) {
+        std::unique_lock<std::mutex> lock(frameReadLock);
+        lock.unlock();
+        frameReadSignal.notify_all();
+    }
+}
+
+void Sequence::wakeOutputThread() {
+    if (m_outputThreadWaiting) {
+        std::unique_lock<std::mutex> lock(frameLoadedLock);
+        lock.unlock();
+        frameLoadedSignal.notify_all();
+    }
+}
+
+void Sequence::waitForReadRequest(uint64_t request, bool cacheFull) {
+    std::unique_lock<std::mutex> lock(frameReadLock);
+    m_readThreadWaiting = true;
+    frameReadSignal.wait(lock, [this, request, cacheFull]() {
+        return m_shuttingDown
+            || m_readRequest != request
+            || (cacheFull && !frameCacheFull());
+    });
+    m_readThreadWaiting = false;
+}
+
+bool Sequence::waitForFrame(const std::chrono::steady_clock::time_point &deadline) {
+    std::unique_lock<std::mutex> lock(frameLoadedLock);
+    m_outputThreadWaiting = true;
+    bool ret = frameLoadedSignal.wait_until(lock, deadline, [this]() {
+        return m_shuttingDown || !frameCacheEmpty() || frameReadDone();
+    });
+    m_outputThreadWaiting = false;
+    return ret && !m_shuttingDown;
+}
+
 
 /*
  *
  */
 
 void ReadSequenceDataThread(Sequence *sequence) {
+    SetThreadRole(THREAD_ROLE_SEQUENCE_READ, "fpp-seqread");
     sequence->ReadFramesLoop();
 }
 void Sequence::ReadFramesLoop() {
-    std::unique_lock<std::mutex> lock(frameCacheLock);
-    while (true) {
-        if (m_shuttingDown) {
-            return;
+    uint32_t epoch = 0;
+    uint32_t frame = SEQUENCE_READ_IDLE;
+    while (!m_shuttingDown) {
+        uint64_t request = m_readRequest;
+        if ((uint32_t)(request >> 32) != epoch) {
+            epoch = request >> 32;
+            frame = (uint32_t)request;
         }
-        int cacheSize = frameCache.size();
-        if (frameCache.size() < SEQUENCE_CACHE_FRAMECOUNT && m_seqStarting < 2 && m_seqFile && !m_doneRead) {
-            uint64_t frame = m_lastFrameRead + 1;
-            if (frame < m_seqFile->getNumFrames()) {
-                lock.unlock();
-                
-                std::unique_lock<std::mutex> readlock(readFileLock);
-                FSEQFile *file = m_seqFile;
-                FSEQFile::FrameData *fd = nullptr;
-                if (m_doneRead || file == nullptr) {
-                    //memset(fd->data, 0, maxChanToRead);
-                } else {
-                    fd = m_seqFile->getFrame(frame);
-                }
-                readlock.unlock();
-                
-                lock.lock();
-                if (fd) {
-                    if (m_lastFrameRead == (frame - 1)) {
-                        m_lastFrameRead = frame;
-                        frameCache.push_back(fd);
-
-                        lock.unlock();
-                        frameLoadedSignal.notify_all();
-                        std::this_thread::sleep_for(5ms);
-                        lock.lock();
-                    } else {
-                        //a skip is in progress, we don't need this frame anymore
-                        delete fd;
-                    }
-                }
-            } else {
-                frameLoadedSignal.notify_all();
-                m_doneRead = true;
-            }
+        if (frame == SEQUENCE_READ_IDLE) {
+            waitForReadRequest(request, false);
+            continue;
+        }
+        if (frameCacheFull()) {
+            waitForReadRequest(request, true);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> readlock(readFileLock);
+        if (m_readRequest != request || m_seqFile == nullptr) {
+            continue;
+        }
+        if (frame >= m_seqFile->getNumFrames()) {
+            readlock.unlock();
+            frame = SEQUENCE_READ_IDLE;
+            setDoneReadEpoch(epoch);
+            wakeOutputThread();
+            continue;
+        }
+        FSEQFile::FrameData *fd = m_seqFile->getFrame(frame);
+        readlock.unlock();
+
+        if (fd == nullptr) {
+            LogErr(VB_SEQUENCE, "Could not read frame %d\n", frame);
+        } else if (m_readRequest != request) {
+            //a seek happened while reading, we don't need this frame anymore
+            delete fd;
+            continue;
         } else {
-            frameLoadSignal.wait_for(lock, 25ms);
+            pushCachedFrame(fd, epoch);
         }
+        frame++;
+        m_readPosition = ((uint64_t)epoch << 32) | frame;
+        wakeOutputThread();
     }
 }
 
@@ -178,21 +333,16 @@ int Sequence::OpenSequenceFile(const char *filename, int startFrame, int startSe
         CloseSequenceFile();
 
     m_seqStarting = 2;
-    m_doneRead = false;
-    m_lastFrameRead = -1;
-    if (startFrame) {
-        m_lastFrameRead = startFrame - 1;
-    }
+    int startRead = startFrame;
 
-    std::unique_lock<std::mutex> lock(frameCacheLock);
+    startReading(SEQUENCE_READ_IDLE);
     clearCaches();
-    lock.unlock();
     
     m_seqPaused   = 0;
     m_seqDuration = 0;
     m_seqSecondsElapsed = 0;
     m_seqSecondsRemaining = 0;
-    SetChannelOutputFrameNumber(m_lastFrameRead + 1);
+    SetChannelOutputFrameNumber(startRead);
     if (m_readThread == nullptr) {
         m_readThread = new std::thread(ReadSequenceDataThread, this);
     }
@@ -242,10 +392,25 @@ int Sequence::OpenSequenceFile(const char *filename, int startFrame, int startSe
     if (startSecond >= 0) {
         int frame = startSecond * 1000;
         frame /= seqFile->getStepTime();
-        m_lastFrameRead = frame - 1;
-        if (m_lastFrameRead < -1) m_lastFrameRead = -1;
+        startRead = frame;
+        if (startRead < 0) startRead = 0;
     }
 
+    // Compressed sequences decompress upcoming blocks in the background,
+    // allow the window and memory used to be tuned for the hardware
+    int readAheadBlocks = 2;
+    int readAheadMemory = 64;
+    if (strlen(getSetting("fseqReadAheadBlocks")))
+        readAheadBlocks = getSettingInt("fseqReadAheadBlocks");
+    if (strlen(getSetting("fseqReadAheadMemory")))
+        readAheadMemory = getSettingInt("fseqReadAheadMemory");
+    seqFile->setReadAhead(readAheadBlocks, readAheadMemory * 1024ULL * 1024ULL);
+    seqFile->setReadAheadFrames(SEQUENCE_CACHE_FRAMECOUNT);
+    // enough buffers for every frame in frameCache and pastFrameCache plus
+    // the frame being read and the one being output so frame buffers are
+    // recycled instead of allocated during playback
+    seqFile->setFramePoolSize(SEQUENCE_CACHE_FRAMECOUNT + SEQUENCE_PAST_CACHE_FRAMECOUNT + 3);
+
     seqFile->prepareRead(GetOutputRanges());
     // Calculate duration
     m_seqMSRemaining = seqFile->getNumFrames() * seqFile->getStepTime();
@@ -258,7 +423,7 @@ int Sequence::OpenSequenceFile(const char *filename, int startFrame, int startSe
     //start reading frames
     m_seqFile = seqFile;
     m_seqStarting = 1;  //beyond header, read loop can start reading frames
-    frameLoadSignal.notify_all();
+    startReading(startRead);
     m_seqStarting = 0;
     m_seqPaused = 0;
     m_seqSingleStep = 0;
@@ -283,29 +448,32 @@ int Sequence::SeekSequenceFile(int frameNumber) {
         LogErr(VB_SEQUENCE, "No sequence is running\n");
         return 0;
     }
-    seqLock.unlock();
-    
-    std::unique_lock<std::mutex> lock(frameCacheLock);
+
+    seekCachedFrame(frameNumber);
+    return 1;
+}
+
+void Sequence::seekCachedFrame(int frameNumber) {
+    int firstCached = m_nextFrame;
     while (!pastFrameCache.empty()
-        && frameNumber >= pastFrameCache.back()->frame) {
-        //Going backwords but frame is cached, we'll push the old frames
-        frameCache.push_front(pastFrameCache.back());
+        && frameNumber <= (int)pastFrameCache.back()->frame) {
+        //Going backwords but frame is cached, we'll replay the old frames
+        rewoundFrameCache.push_front(pastFrameCache.back());
         pastFrameCache.pop_back();
     }
-    while (!frameCache.empty() && frameCache.front()->frame < frameNumber) {
-        delete frameCache.front();
-        frameCache.pop_front();
+    if (!rewoundFrameCache.empty()) {
+        firstCached = rewoundFrameCache.front()->frame;
     }
-    if (!frameCache.empty() && frameNumber < frameCache.front()->frame) {
+    //anything before the new frame is dropped as it is popped
+    m_nextFrame = frameNumber;
+
+    int nextRead = nextFrameToRead();
+    LogDebug(VB_SEQUENCE, "Seeking to %d.   Next read is %d\n", frameNumber, nextRead);
+    if (frameNumber < firstCached || frameNumber > nextRead) {
+        //not cached and not about to be read, restart reading at the new frame
+        startReading(frameNumber);
         clearCaches();
     }
-    LogDebug(VB_SEQUENCE, "Seeking to %d.   Last read is %d\n", frameNumber, (int)m_lastFrameRead);
-    if (frameCache.empty()) {
-        m_lastFrameRead = frameNumber - 1;
-        frameLoadSignal.notify_all();
-    }
-    lock.unlock();
-    frameLoadSignal.notify_all();
 }
 
 
@@ -331,7 +499,42 @@ int Sequence::IsSequenceRunning(char *filename) {
 }
 
 void Sequence::BlankSequenceData(void) {
-    memset(m_seqData, 0, sizeof(m_seqData));
+    //the buffers are blanked before they are swapped in so the data
+    //currently being output is never modified.  Called from other threads
+    //by SendBlankingData() so the swap has to be under the lock
+    std::unique_lock<std::recursive_mutex> seqLock(m_sequenceLock);
+    for (int x = 0; x < SEQUENCE_DATA_BUFFERS; x++) {
+        m_seqDataNeedsBlank[x] = true;
+    }
+    NextSequenceDataBuffer();
+    SwapSequenceDataBuffer();
+}
+
+char *Sequence::NextSequenceDataBuffer(void) {
+    int next = (m_seqDataBuffer + 1) % SEQUENCE_DATA_BUFFERS;
+    if (m_seqDataNeedsBlank[next]) {
+        memset(m_seqDataBuffers[next], 0, FPPD_MAX_CHANNELS);
+        m_seqDataNeedsBlank[next] = false;
+    }
+    return m_seqDataBuffers[next];
+}
+
+void Sequence::SwapSequenceDataBuffer(void) {
+    m_seqDataBuffer = (m_seqDataBuffer + 1) % SEQUENCE_DATA_BUFFERS;
+    m_seqData = m_seqDataBuffers[m_seqDataBuffer];
+    m_seqDataSyncTime[m_seqDataBuffer] = 0;
+}
+
+/*
+ * Record the time from the bridge sync packet which latched this frame to
+ * the frame being sent, only the first time the frame is sent.
+ */
+void Sequence::RecordInputLatency(char *seqData) {
+    int b = (seqData - m_seqDataBuffers[0]) / FPPD_MAX_CHANNELS;
+    if ((b >= 0) && (b < SEQUENCE_DATA_BUFFERS) && m_seqDataSyncTime[b]) {
+        RecordFrameStage(FRAME_STAGE_INPUT_LATENCY, GetMonotonicTime() - m_seqDataSyncTime[b]);
+        m_seqDataSyncTime[b] = 0;
+    }
 }
 
 int Sequence::SequenceIsPaused(void) {
@@ -365,22 +568,9 @@ void Sequence::ReadSequenceData(bool forceFirstFrame) {
             m_seqSingleStep = 0;
         } else if (m_seqSingleStepBack) {
             m_seqSingleStepBack = 0;
-            std::unique_lock<std::mutex> lock(frameCacheLock);
-            if (!pastFrameCache.empty()) {
-                frameCache.push_front(pastFrameCache.back());
-                pastFrameCache.pop_back();
-            } else if (frameCache.empty()) {
-                m_lastFrameRead = -1;
-                frameLoadSignal.notify_all();
-            } else {
-                int f = frameCache.front()->frame - 1;
-                m_lastFrameRead = f - 1;
-                if (m_lastFrameRead < -1) {
-                    m_lastFrameRead = -1;
-                }
-                clearCaches();
-                frameLoadSignal.notify_all();
-            }
+            //back to the frame before the one being displayed
+            int frame = m_nextFrame - 2;
+            seekCachedFrame(frame < 0 ? 0 : frame);
         } else {
             return;
         }
@@ -389,45 +579,43 @@ void Sequence::ReadSequenceData(bool forceFirstFrame) {
     if (forceFirstFrame || IsSequenceRunning()) {
         m_remoteBlankCount = 0;
 
-        std::unique_lock<std::mutex> lock(frameCacheLock);
-        if (frameCache.empty() && !m_doneRead) {
-            //wait up to the step time, if we don't have the frame, bail
-            frameLoadedSignal.wait_for(lock, std::chrono::milliseconds(m_seqStepTime - 1));
+        //wait up to the step time, if we don't have the frame, bail
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now()
+            + std::chrono::milliseconds(m_seqStepTime - 1);
+        bool done = frameReadDone();
+        FSEQFile::FrameData *data = popCachedFrame();
+        while (!data && !done && waitForFrame(deadline)) {
+            done = frameReadDone();
+            data = popCachedFrame();
         }
-        if (!frameCache.empty()) {
-            FSEQFile::FrameData *data = frameCache.front();
-            frameCache.pop_front();
-            if (pastFrameCache.size() > 5) {
+        if (data) {
+            if (pastFrameCache.size() > SEQUENCE_PAST_CACHE_FRAMECOUNT) {
                 delete pastFrameCache.front();
                 pastFrameCache.pop_front();
             }
             pastFrameCache.push_back(data);
-            lock.unlock();
-            frameLoadSignal.notify_all();
-            
-            data->readFrame((uint8_t*)m_seqData);
+            m_nextFrame = data->frame + 1;
+
+            //read into the buffer that isn't being output and swap it in
+            data->readFrame((uint8_t*)NextSequenceDataBuffer());
+            SwapSequenceDataBuffer();
             SetChannelOutputFrameNumber(data->frame);
             m_seqSecondsElapsed = data->frame * m_seqStepTime;
             m_seqSecondsElapsed /= 1000;
             m_seqSecondsRemaining = m_seqDuration - m_seqSecondsElapsed;
             m_dataProcessed = false;
-        } else if (m_doneRead) {
-            lock.unlock();
+        } else if (done) {
             m_seqSecondsElapsed = m_seqDuration;
             m_seqSecondsRemaining = m_seqDuration - m_seqSecondsElapsed;
             CloseSequenceFile();
-        } else {
-            if (m_lastFrameRead > 0) {
-                //we'll have the read thread discard the frame
-                m_lastFrameRead++;
-                if (!pastFrameCache.empty()) {
-                    //and copy the last frame data
-                    pastFrameCache.back()->readFrame((uint8_t*)m_seqData);
-                    m_dataProcessed = false;
-                }
-            }
-            lock.unlock();
-            frameLoadSignal.notify_all();
+        } else if (!pastFrameCache.empty()) {
+            //drop the late frame when it arrives
+            m_nextFrame++;
+            CountSkippedFrames(1);
+            //and copy the last frame data
+            pastFrameCache.back()->readFrame((uint8_t*)NextSequenceDataBuffer());
+            SwapSequenceDataBuffer();
+            m_dataProcessed = false;
         }
     } else {
         if (getFPPmode() != REMOTE_MODE || getSettingInt("blankBetweenSequences")) {
@@ -446,20 +634,46 @@ void Sequence::ReadSequenceData(bool forceFirstFrame) {
     }
 }
 
-void Sequence::ProcessSequenceData(int ms, int checkControlChannels) {
+/*
+ * Bridge mode equivalent of ReadSequenceData(), the latest frame latched by
+ * the E1.31/DDP bridge is copied into the buffer that isn't being output.
+ */
+void Sequence::ReadBridgeData(void) {
+    std::unique_lock<std::recursive_mutex> seqLock(m_sequenceLock);
+
+    long long syncTime = Bridge_ReadFrame(NextSequenceDataBuffer());
+    SwapSequenceDataBuffer();
+    m_seqDataSyncTime[m_seqDataBuffer] = syncTime;
+    m_dataProcessed = false;
+}
+
+/*
+ * Process the current frame and return the buffer that was processed.  A
+ * blank or a bridge frame may be swapped in from another thread while we
+ * are working, so the caller must send the returned buffer, not m_seqData.
+ */
+char *Sequence::ProcessSequenceData(int ms, int checkControlChannels, int prepOutputs) {
+    std::unique_lock<std::recursive_mutex> seqLock(m_sequenceLock);
+    char *seqData = m_seqData;
+    seqLock.unlock();
+
+    long long start = GetTime();
     if (IsEffectRunning())
-        OverlayEffects(m_seqData);
+        OverlayEffects(seqData);
+
+    long long effectsDone = GetTime();
+    RecordFrameStage(FRAME_STAGE_EFFECTS, effectsDone - start);
 
     if (SDLOutput::IsOverlayingVideo()) {
         SDLOutput::ProcessVideoOverlay(ms);
     }
     if (UsingMemoryMapInput())
-        OverlayMemoryMap(m_seqData);
+        OverlayMemoryMap(seqData);
 
     if (checkControlChannels && getControlMajor() && getControlMinor())
     {
-        char thisMajor = NormalizeControlValue(m_seqData[getControlMajor()-1]);
-        char thisMinor = NormalizeControlValue(m_seqData[getControlMinor()-1]);
+        char thisMajor = NormalizeControlValue(seqData[getControlMajor()-1]);
+        char thisMinor = NormalizeControlValue(seqData[getControlMinor()-1]);
 
         if ((m_seqLastControlMajor != thisMajor) ||
             (m_seqLastControlMinor != thisMinor))
@@ -473,14 +687,40 @@ void Sequence::ProcessSequenceData(int ms, int checkControlChannels) {
     }
 
     if (channelTester->Testing())
-        channelTester->OverlayTestData(m_seqData);
+        channelTester->OverlayTestData(seqData);
+
+    RecordFrameStage(FRAME_STAGE_OVERLAY, GetTime() - effectsDone);
     
-    PrepareChannelData(m_seqData);
+    if (prepOutputs)
+        PrepareChannelData(seqData);
+    else
+        ProcessChannelData(seqData);
     m_dataProcessed = true;
+    return seqData;
 }
 
 void Sequence::SendSequenceData(void) {
-    SendChannelData(m_seqData);
+    std::unique_lock<std::recursive_mutex> seqLock(m_sequenceLock);
+    char *seqData = m_seqData;
+    seqLock.unlock();
+
+    SendSequenceData(seqData, 0);
+}
+
+/*
+ * Send a buffer returned by ProcessSequenceData().  The pipelined output
+ * loop processes the data without prepping the outputs so the outputs are
+ * prepped here on the output thread, and the caller advances the frame
+ * counter.
+ */
+void Sequence::SendSequenceData(char *seqData, int prepOutputs) {
+    RecordInputLatency(seqData);
+    if (prepOutputs) {
+        PrepareChannelOutputs(seqData);
+        SendChannelOutputs(seqData);
+    } else {
+        SendChannelData(seqData);
+    }
 }
 
 void Sequence::SendBlankingData(void) {
@@ -491,8 +731,8 @@ void Sequence::SendBlankingData(void) {
         multiSync->SendBlankingDataPacket();
 
     BlankSequenceData();
-    ProcessSequenceData(0, 0);
-    SendSequenceData();
+    char *seqData = ProcessSequenceData(0, 0);
+    SendSequenceData(seqData, 0);
 }
 
 void Sequence::CloseIfOpen(char *filename) {
@@ -509,19 +749,17 @@ void Sequence::CloseSequenceFile(void) {
 
     std::unique_lock<std::recursive_mutex> seqLock(m_sequenceLock);
 
+    startReading(SEQUENCE_READ_IDLE);
     std::unique_lock<std::mutex> readLock(readFileLock);
     if (m_seqFile) {
+        LogDebug(VB_SEQUENCE, "Frame buffers allocated: %" PRIu64 ", reused: %" PRIu64 "\n",
+            m_seqFile->getFramePoolAllocations(), m_seqFile->getFramePoolReuses());
         delete m_seqFile;
         m_seqFile = nullptr;
     }
     readLock.unlock();
     
-    std::unique_lock<std::mutex> lock(frameCacheLock);
     clearCaches();
-    m_doneRead = true;
-    m_lastFrameRead = -1;
-    lock.unlock();
-    frameLoadedSignal.notify_all();
     
     m_seqFilename[0] = '\0';
     m_seqPaused = 0;
@@ -35,6 +35,7 @@
 #include <list>
 #include <atomic>
 #include <condition_variable>
+#include <chrono>
 
 #include "fseq/FSEQFile.h"
 
@@ -44,6 +45,8 @@
 #define DATA_DUMP_SIZE    28
 
 #define SEQUENCE_CACHE_FRAMECOUNT 20
+#define SEQUENCE_PAST_CACHE_FRAMECOUNT 5
+#define SEQUENCE_DATA_BUFFERS 3
 
 class Sequence {
   public:
@@ -53,10 +56,12 @@ class Sequence {
 	int   IsSequenceRunning(void);
 	int   IsSequenceRunning(char *filename);
 	int   OpenSequenceFile(const char *filename, int startFrame = 0, int startSecond = -1);
-	void  ProcessSequenceData(int ms, int checkControlChannels = 1);
+	char *ProcessSequenceData(int ms, int checkControlChannels = 1, int prepOutputs = 1);
 	int   SeekSequenceFile(int frameNumber);
 	void  ReadSequenceData(bool forceFirstFrame = false);
+	void  ReadBridgeData(void);
 	void  SendSequenceData(void);
+	void  SendSequenceData(char *seqData, int prepOutputs);
 	void  SendBlankingData(void);
 	void  CloseIfOpen(char *filename);
 	void  CloseSequenceFile(void);
@@ -70,11 +75,24 @@ class Sequence {
 	int           m_seqSecondsElapsed;
 	int           m_seqSecondsRemaining;
 	int           m_seqMSRemaining;
-	char          m_seqData[FPPD_MAX_CHANNELS] __attribute__ ((aligned (__BIGGEST_ALIGNMENT__)));
+	char         *m_seqData; // channel data currently being processed/output
 	char          m_seqFilename[1024];
 
   private:
+	// New frames are read into a buffer that is not being output and
+	// then swapped in by pointing m_seqData at it.  With the pipelined
+	// output loop one buffer is being sent while the next frame is
+	// processed in another, the third leaves room for a blank to be
+	// swapped in from another thread without touching either.
+	char          m_seqDataBuffers[SEQUENCE_DATA_BUFFERS][FPPD_MAX_CHANNELS] __attribute__ ((aligned (__BIGGEST_ALIGNMENT__)));
+	bool          m_seqDataNeedsBlank[SEQUENCE_DATA_BUFFERS];
+	long long     m_seqDataSyncTime[SEQUENCE_DATA_BUFFERS]; // bridge sync packet time, until sent
+	int           m_seqDataBuffer;
+
 	void  BlankSequenceData(void);
+	char *NextSequenceDataBuffer(void);
+	void  SwapSequenceDataBuffer(void);
+	void  RecordInputLatency(char *seqData);
 	char  NormalizeControlValue(char in);
 	char *CurrentSequenceFilename(void);
 
@@ -92,18 +110,56 @@ class Sequence {
     bool          m_dataProcessed;
 
     std::recursive_mutex m_sequenceLock;
-    
-    std::atomic_int m_lastFrameRead;
-    volatile bool m_doneRead;
-    volatile bool m_shuttingDown;
-    std::thread *m_readThread;
-    std::list<FSEQFile::FrameData*> frameCache;
+
+    // Frames are handed from the read thread to the output thread through
+    // a single producer/single consumer ring.  Every time the read thread
+    // is (re)positioned the read epoch is bumped and frames tagged with an
+    // older epoch are dropped by the consumer instead of locking the reader
+    // out of the ring.  All of the consumer side runs under m_sequenceLock.
+    class CachedFrame {
+      public:
+        FSEQFile::FrameData *frame;
+        uint32_t             epoch;
+    };
+    CachedFrame   frameCache[SEQUENCE_CACHE_FRAMECOUNT + 1];
+    std::atomic<uint32_t> frameCacheHead; // only written by the consumer
+    std::atomic<uint32_t> frameCacheTail; // only written by the read thread
+    std::list<FSEQFile::FrameData*> rewoundFrameCache; // past frames to replay before the ring
     std::list<FSEQFile::FrameData*> pastFrameCache;
-    void clearCaches();
-    std::mutex frameCacheLock;
+
+    uint32_t      m_readEpoch;
+    int           m_readStartFrame;
+    int           m_nextFrame;
+    std::atomic<uint64_t> m_readRequest;  // epoch << 32 | first frame to read
+    std::atomic<uint64_t> m_readPosition; // epoch << 32 | next frame the reader will read
+    std::atomic<uint32_t> m_doneReadEpoch;
+
+    std::atomic_bool m_shuttingDown;
+    std::thread *m_readThread;
     std::mutex readFileLock; //lock for just the stuff needed to read from the file (m_seqFile variable)
-    std::condition_variable frameLoadSignal;
+
+    // only used to sleep when the ring is full/empty, never to pass frames
+    std::mutex frameReadLock;
+    std::condition_variable frameReadSignal;
+    std::atomic_bool m_readThreadWaiting;
+    std::mutex frameLoadedLock;
     std::condition_variable frameLoadedSignal;
+    std::atomic_bool m_outputThreadWaiting;
+
+    bool  frameCacheFull() const;
+    bool  frameCacheEmpty() const;
+    bool  pushCachedFrame(FSEQFile::FrameData *fd, uint32_t epoch);
+    FSEQFile::FrameData *popCachedFrame();
+    void  clearCaches();
+    void  startReading(uint32_t frame);
+    void  setDoneReadEpoch(uint32_t epoch);
+    bool  frameReadDone() const;
+    int   nextFrameToRead() const;
+    void  seekCachedFrame(int frameNumber);
+    void  waitForReadRequest(uint64_t request, bool cacheFull);
+    bool  waitForFrame(const std::chrono::steady_clock::time_point &deadline);
+    void  wakeReadThread();
+    void  wakeOutputThread();
 
     public:
     void ReadFramesLoop();
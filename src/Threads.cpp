@@ -0,0 +1,363 @@
+/*
+ *   Thread scheduling for Falcon Player (FPP)
+ *
+ *   Copyright (C) 2013-2018 the Falcon Player Developers
+ *      Initial development by:
+ *      - David Pitts (dpitts)
+ *      - Tony Mace (MyKroFt)
+ *      - Mathew Mrosko (Materdaddy)
+ *      - Chris Pinkham (CaptainMurdoch)
+ *      For additional credits and developers, see credits.php.
+ *
+ *   The Falcon Player (FPP) is free software; you can redistribute it
+ *   and/or modify it under the terms of the GNU General Public License
+ *   as published by the Free Software Foundation; either version 2 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "log.h"
+#include "settings.h"
+#include "Threads.h"
+
+/*
+ * With RealTimeThreads enabled the frame critical threads run SCHED_FIFO
+ * and, on 4+ core systems, are kept on the upper half of the cores while
+ * the web server, media decoding and network housekeeping are kept on the
+ * lower half.  Each role can be overridden with <Key>ThreadCPUs (a CPU
+ * list such as "2-3" or "1,3") and <Key>ThreadPriority (0 for normal
+ * scheduling, 1-99 for SCHED_FIFO).  The default priorities are below the
+ * kernel's threaded interrupt handlers so network and SPI interrupts are
+ * still serviced first.
+ *
+ * LockMemory locks fppd in RAM so a frame never waits on a page fault.
+ */
+
+typedef enum {
+	CPUS_ALL = 0,
+	CPUS_CRITICAL,
+	CPUS_BACKGROUND
+} CPUGroup;
+
+typedef struct {
+	const char *key;
+	const char *name;
+	CPUGroup    group;
+	int         defaultPriority;
+} ThreadRoleInfo;
+
+// filled in from the settings by InitThreads()
+typedef struct {
+	bool        setAffinity;
+	cpu_set_t   cpus;
+	int         priority;
+} ThreadRoleConfig;
+
+static const ThreadRoleInfo roles[THREAD_ROLE_COUNT] = {
+	{ "Main",         "main",         CPUS_ALL,        0  },
+	{ "Output",       "output",       CPUS_CRITICAL,   45 },
+	{ "Process",      "process",      CPUS_CRITICAL,   44 },
+	{ "OutputWorker", "outputWorker", CPUS_CRITICAL,   42 },
+	{ "OutputDevice", "outputDevice", CPUS_CRITICAL,   43 },
+	{ "BridgeInput",  "bridgeInput",  CPUS_CRITICAL,   46 },
+	{ "SequenceRead", "sequenceRead", CPUS_ALL,        0  },
+	{ "Media",        "media",        CPUS_BACKGROUND, 0  },
+	{ "Network",      "network",      CPUS_BACKGROUND, 0  },
+	{ "HTTP",         "http",         CPUS_BACKGROUND, 0  }
+};
+
+static ThreadRoleConfig roleConfigs[THREAD_ROLE_COUNT];
+
+typedef struct {
+	std::string name;
+	ThreadRole  role;
+} ThreadInfo;
+
+static bool                     realTimeThreads = false;
+static std::mutex               threadsLock;
+static std::map<int, ThreadInfo> threads;
+
+/*
+ * Parse a CPU list such as "0-1,3"
+ */
+static bool ParseCPUList(const char *str, cpu_set_t &cpus)
+{
+	CPU_ZERO(&cpus);
+
+	const char *s = str;
+	while (*s) {
+		char *end;
+		int first = strtol(s, &end, 10);
+		if (end == s)
+			return false;
+
+		int last = first;
+		s = end;
+		if (*s == '-') {
+			s++;
+			last = strtol(s, &end, 10);
+			if (end == s)
+				return false;
+			s = end;
+		}
+
+		for (int c = first; (c <= last) && (c < CPU_SETSIZE); c++)
+			CPU_SET(c, &cpus);
+
+		if (*s == ',')
+			s++;
+		else if (*s)
+			return false;
+	}
+
+	return CPU_COUNT(&cpus) > 0;
+}
+
+static std::string CPUListString(const cpu_set_t &cpus)
+{
+	std::string result;
+	char buf[16];
+
+	for (int c = 0; c < CPU_SETSIZE; c++) {
+		if (!CPU_ISSET(c, &cpus))
+			continue;
+
+		int last = c;
+		while (((last + 1) < CPU_SETSIZE) && CPU_ISSET(last + 1, &cpus))
+			last++;
+
+		if (last == c)
+			snprintf(buf, sizeof(buf), "%d", c);
+		else
+			snprintf(buf, sizeof(buf), "%d-%d", c, last);
+
+		if (!result.empty())
+			result += ",";
+		result += buf;
+		c = last;
+	}
+
+	return result;
+}
+
+void InitThreads(void)
+{
+	realTimeThreads = getSettingInt("RealTimeThreads");
+
+	int cores = sysconf(_SC_NPROCESSORS_ONLN);
+	int half = cores / 2;
+
+	for (int r = 0; r < THREAD_ROLE_COUNT; r++) {
+		const ThreadRoleInfo &info = roles[r];
+		ThreadRoleConfig &cfg = roleConfigs[r];
+		char key[64];
+
+		cfg.setAffinity = false;
+		cfg.priority = info.defaultPriority;
+
+		// split the cores when there are enough of them to go around
+		if ((cores >= 4) && (info.group != CPUS_ALL)) {
+			int first = (info.group == CPUS_CRITICAL) ? half : 0;
+			int last = (info.group == CPUS_CRITICAL) ? cores : half;
+
+			CPU_ZERO(&cfg.cpus);
+			for (int c = first; c < last; c++)
+				CPU_SET(c, &cfg.cpus);
+			cfg.setAffinity = true;
+		}
+
+		snprintf(key, sizeof(key), "%sThreadCPUs", info.key);
+		const char *cpus = getSetting(key);
+		if (!strcmp(cpus, "all")) {
+			cfg.setAffinity = false;
+		} else if (strlen(cpus)) {
+			cpu_set_t parsed;
+			if (ParseCPUList(cpus, parsed)) {
+				cfg.cpus = parsed;
+				cfg.setAffinity = true;
+			} else {
+				LogErr(VB_GENERAL, "Invalid CPU list for %s: '%s'\n", key, cpus);
+			}
+		}
+
+		snprintf(key, sizeof(key), "%sThreadPriority", info.key);
+		if (strlen(getSetting(key))) {
+			int priority = getSettingInt(key);
+			if ((priority < 0) || (priority > 99)) {
+				LogErr(VB_GENERAL, "Invalid priority for %s: %d\n", key, priority);
+			} else {
+				cfg.priority = priority;
+			}
+		}
+
+		if (realTimeThreads)
+			LogDebug(VB_GENERAL, "Thread role %s: CPUs %s, %s %d\n", info.name,
+				cfg.setAffinity ? CPUListString(cfg.cpus).c_str() : "all",
+				cfg.priority ? "SCHED_FIFO" : "SCHED_OTHER", cfg.priority);
+	}
+
+	if (getSettingInt("LockMemory")) {
+		// lock pages as they are touched rather than faulting in every
+		// thread's whole stack up front
+#ifdef MCL_ONFAULT
+		if (mlockall(MCL_CURRENT | MCL_FUTURE | MCL_ONFAULT) == 0)
+			LogInfo(VB_GENERAL, "Locked fppd memory\n");
+		else
+#endif
+		if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+			LogInfo(VB_GENERAL, "Locked fppd memory\n");
+		else
+			LogErr(VB_GENERAL, "Unable to lock fppd memory: %s\n", strerror(errno));
+	}
+}
+
+void SetThreadRole(ThreadRole role, const char *name)
+{
+	int tid = syscall(SYS_gettid);
+
+	if (name) {
+		// Linux thread names are limited to 15 characters
+		char shortName[16];
+		snprintf(shortName, sizeof(shortName), "%s", name);
+		pthread_setname_np(pthread_self(), shortName);
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(threadsLock);
+		ThreadInfo &info = threads[tid];
+		if (name)
+			info.name = name;
+		info.role = role;
+	}
+
+	if (!realTimeThreads)
+		return;
+
+	ThreadRoleConfig &cfg = roleConfigs[role];
+	int result;
+
+	if (cfg.setAffinity) {
+		result = pthread_setaffinity_np(pthread_self(), sizeof(cfg.cpus), &cfg.cpus);
+		if (result)
+			LogWarn(VB_GENERAL, "Unable to set CPU affinity for %s thread: %s\n",
+				roles[role].name, strerror(result));
+	} else {
+		cpu_set_t all;
+		CPU_ZERO(&all);
+		for (int c = 0; c < sysconf(_SC_NPROCESSORS_CONF); c++)
+			CPU_SET(c, &all);
+		pthread_setaffinity_np(pthread_self(), sizeof(all), &all);
+	}
+
+	struct sched_param param;
+	param.sched_priority = cfg.priority;
+	result = pthread_setschedparam(pthread_self(),
+		cfg.priority ? SCHED_FIFO : SCHED_OTHER, &param);
+	if (result)
+		LogWarn(VB_GENERAL, "Unable to set scheduling for %s thread: %s\n",
+			roles[role].name, strerror(result));
+}
+
+void PinThreadInRole(ThreadRole role, int index)
+{
+	if (!realTimeThreads)
+		return;
+
+	ThreadRoleConfig &cfg = roleConfigs[role];
+	cpu_set_t cpus;
+
+	if (cfg.setAffinity) {
+		cpus = cfg.cpus;
+	} else {
+		CPU_ZERO(&cpus);
+		for (int c = 0; c < sysconf(_SC_NPROCESSORS_ONLN); c++)
+			CPU_SET(c, &cpus);
+	}
+
+	int count = CPU_COUNT(&cpus);
+	if (!count)
+		return;
+
+	int n = index % count;
+	for (int c = 0; c < CPU_SETSIZE; c++) {
+		if (!CPU_ISSET(c, &cpus))
+			continue;
+
+		if (n--)
+			continue;
+
+		cpu_set_t cpu;
+		CPU_ZERO(&cpu);
+		CPU_SET(c, &cpu);
+
+		int result = pthread_setaffinity_np(pthread_self(), sizeof(cpu), &cpu);
+		if (result)
+			LogWarn(VB_GENERAL, "Unable to pin %s thread to CPU %d: %s\n",
+				roles[role].name, c, strerror(result));
+		break;
+	}
+}
+
+void GetThreadInfo(Json::Value &result)
+{
+	std::unique_lock<std::mutex> lock(threadsLock);
+	Json::Value list(Json::arrayValue);
+	char path[64];
+
+	for (auto it = threads.begin(); it != threads.end(); ) {
+		// forget threads which have exited
+		snprintf(path, sizeof(path), "/proc/self/task/%d", it->first);
+		if (access(path, F_OK)) {
+			it = threads.erase(it);
+			continue;
+		}
+
+		Json::Value thread;
+		thread["tid"] = it->first;
+		thread["name"] = it->second.name;
+		thread["role"] = roles[it->second.role].name;
+
+		int policy = sched_getscheduler(it->first);
+		struct sched_param param;
+		param.sched_priority = 0;
+		sched_getparam(it->first, &param);
+		thread["policy"] = (policy == SCHED_FIFO) ? "SCHED_FIFO" :
+			(policy == SCHED_RR) ? "SCHED_RR" : "SCHED_OTHER";
+		thread["priority"] = param.sched_priority;
+
+		cpu_set_t cpus;
+		if (sched_getaffinity(it->first, sizeof(cpus), &cpus) == 0)
+			thread["cpus"] = CPUListString(cpus);
+
+		list.append(thread);
+		++it;
+	}
+
+	result["realTime"] = realTimeThreads;
+	result["threads"] = list;
+}
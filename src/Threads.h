@@ -0,0 +1,63 @@
+/*
+ *   Thread scheduling for Falcon Player (FPP)
+ *
+ *   Copyright (C) 2013-2018 the Falcon Player Developers
+ *      Initial development by:
+ *      - David Pitts (dpitts)
+ *      - Tony Mace (MyKroFt)
+ *      - Mathew Mrosko (Materdaddy)
+ *      - Chris Pinkham (CaptainMurdoch)
+ *      For additional credits and developers, see credits.php.
+ *
+ *   The Falcon Player (FPP) is free software; you can redistribute it
+ *   and/or modify it under the terms of the GNU General Public License
+ *   as published by the Free Software Foundation; either version 2 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _THREADS_H
+#define _THREADS_H
+
+#include <jsoncpp/json/json.h>
+
+// What a thread is used for.  Each role has its own CPU affinity and
+// scheduling policy, see Threads.cpp for the defaults and settings.
+typedef enum {
+	THREAD_ROLE_MAIN = 0,       // fppd main loop, scheduler
+	THREAD_ROLE_OUTPUT,         // channel output thread
+	THREAD_ROLE_PROCESS,        // pipelined output process thread
+	THREAD_ROLE_OUTPUT_WORKER,  // channel output worker threads
+	THREAD_ROLE_OUTPUT_DEVICE,  // threads owned by individual outputs
+	THREAD_ROLE_BRIDGE_INPUT,   // E1.31/DDP bridge receive threads
+	THREAD_ROLE_SEQUENCE_READ,  // sequence read ahead
+	THREAD_ROLE_MEDIA,          // media decoding
+	THREAD_ROLE_NETWORK,        // background network housekeeping
+	THREAD_ROLE_HTTP,           // API web server
+	THREAD_ROLE_COUNT
+} ThreadRole;
+
+// Read the thread settings and lock memory if configured.  Call once
+// from main() after the settings are loaded and before any threads are
+// started.
+void InitThreads(void);
+
+// Name the calling thread and apply its role's affinity and priority.
+// Threads started by this thread inherit the same scheduling.
+void SetThreadRole(ThreadRole role, const char *name = NULL);
+
+// Pin the calling thread to a single CPU out of its role's CPUs, picked
+// by index so a set of threads sharing a role each get their own CPU.
+// Does nothing unless RealTimeThreads is enabled.
+void PinThreadInRole(ThreadRole role, int index);
+
+void GetThreadInfo(Json::Value &result);
+
+#endif /* _THREADS_H */
@@ -30,6 +30,7 @@
 #include "BBBUtils.h"
 #include "common.h"
 #include "log.h"
+#include "OutputKernels.h"
 
 
 // These are the number of clock cycles it takes to clock out a single "row" of bits (1 bit) for 32x16 1/8 P10 scan panels.  Other
@@ -337,6 +338,9 @@ int BBBMatrix::Init(Json::Value config)
     if (!m_panelHeight)
         m_panelHeight = 16;
 
+    // top and bottom half rows for PrepData
+    m_rowData.resize(m_panelWidth * 3 * 2);
+
     int addressingType = config["panelAddressing"].asInt();
     
     m_invertedData = config["invertedData"].asInt();
@@ -634,6 +638,8 @@ void BBBMatrix::PrepData(unsigned char *channelData)
     rowLen /= 8;
     
     memset(m_outputFrame, 0, m_outputs * m_longestChain * m_panelHeight * m_panelWidth * 3);
+    uint8_t *row1 = m_rowData.data();
+    uint8_t *row2 = row1 + (m_panelWidth * 3);
     for (int output = 0; output < m_outputs; output++) {
         int panelsOnOutput = m_panelMatrix->m_outputPanels[output].size();
         
@@ -650,15 +656,20 @@ void BBBMatrix::PrepData(unsigned char *channelData)
                 m_handler->mapRow(yOut);
                 int offset = yOut * rowLen * m_colorDepth + output * 2 * 3
                     + (m_longestChain - chain - 1) * m_panelWidth/8 * m_outputs * 3 * 2 * m_panelHeight / (m_panelScan * 2);
+
+                GatherValueMap(row1, channelData, &m_panelMatrix->m_panels[panel].pixelMap[yw1],
+                               m_panelWidth * 3, gammaCurve);
+                GatherValueMap(row2, channelData, &m_panelMatrix->m_panels[panel].pixelMap[yw2],
+                               m_panelWidth * 3, gammaCurve);
                 
                 for (int x = 0; x < m_panelWidth; ++x) {
-                    uint8_t r1 = gammaCurve[channelData[m_panelMatrix->m_panels[panel].pixelMap[yw1 + x*3]]];
-                    uint8_t g1 = gammaCurve[channelData[m_panelMatrix->m_panels[panel].pixelMap[yw1 + x*3 + 1]]];
-                    uint8_t b1 = gammaCurve[channelData[m_panelMatrix->m_panels[panel].pixelMap[yw1 + x*3 + 2]]];
+                    uint8_t r1 = row1[x*3];
+                    uint8_t g1 = row1[x*3 + 1];
+                    uint8_t b1 = row1[x*3 + 2];
                     
-                    uint8_t r2 = gammaCurve[channelData[m_panelMatrix->m_panels[panel].pixelMap[yw2 + x*3]]];
-                    uint8_t g2 = gammaCurve[channelData[m_panelMatrix->m_panels[panel].pixelMap[yw2 + x*3 + 1]]];
-                    uint8_t b2 = gammaCurve[channelData[m_panelMatrix->m_panels[panel].pixelMap[yw2 + x*3 + 2]]];
+                    uint8_t r2 = row2[x*3];
+                    uint8_t g2 = row2[x*3 + 1];
+                    uint8_t b2 = row2[x*3 + 2];
 
                     
                     int xOut = x;
@@ -21,6 +21,7 @@
 #define _BBBMATRIX_H
 
 #include <string>
+#include <vector>
 
 #include "Matrix.h"
 #include "PanelMatrix.h"
@@ -107,7 +108,7 @@ class BBBMatrix : public ChannelOutputBase {
     uint32_t     brightnessValues[8];
     uint32_t     delayValues[8];
     uint8_t      gammaCurve[256];
-    
+    std::vector<uint8_t> m_rowData;
 };
 
 #endif
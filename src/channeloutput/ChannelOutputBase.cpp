@@ -32,6 +32,7 @@
 
 #include "ChannelOutputBase.h"
 #include "common.h"
+#include "FrameDiff.h"
 #include "log.h"
 
 ChannelOutputBase::ChannelOutputBase(unsigned int startChannel,
@@ -98,3 +99,8 @@ void ChannelOutputBase::DumpConfig(void)
 	LogDebug(VB_CHANNELOUT, "    Start Channel    : %u\n", m_startChannel + 1);
 	LogDebug(VB_CHANNELOUT, "    Channel Count    : %u\n", m_channelCount);
 }
+
+bool ChannelOutputBase::ChannelsChanged(unsigned int start, unsigned int count)
+{
+	return FrameChannelsChanged(m_startChannel + start, count);
+}
@@ -51,6 +51,12 @@ class ChannelOutputBase {
     virtual void  PrepData(unsigned char *channelData) {}
 	virtual int   SendData(unsigned char *channelData) = 0;
 
+	virtual void  GetOutputStats(Json::Value &result) {}
+
+	// True if SendData checks ChannelsChanged(), the frame diff is only
+	// kept when an output uses it
+	virtual bool  UsesFrameDiff(void) { return false; }
+
 
     virtual void  GetRequiredChannelRange(int &min, int & max) = 0;
   private:
@@ -59,6 +65,10 @@ class ChannelOutputBase {
   protected:
 	virtual void  DumpConfig(void);
 
+	// True if any of count channels starting at start (relative to our
+	// first channel) changed since the last frame was sent
+	bool          ChannelsChanged(unsigned int start, unsigned int count);
+
 	std::string      m_outputType;
 	unsigned int     m_maxChannels;
 	unsigned int     m_startChannel;
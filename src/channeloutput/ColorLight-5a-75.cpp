@@ -79,6 +79,7 @@
 
 #include "common.h"
 #include "ColorLight-5a-75.h"
+#include "OutputKernels.h"
 #include "log.h"
 
 
@@ -91,12 +92,10 @@ ColorLight5a75Output::ColorLight5a75Output(unsigned int startChannel, unsigned i
 	m_height(0),
 	m_colorOrder(kColorOrderRGB),
 	m_fd(-1),
-	m_buffer_0101(NULL),
-	m_buffer_0101_len(0),
-	m_buffer_0AFF(NULL),
-	m_buffer_0AFF_len(0),
-	m_data(NULL),
 	m_rowSize(0),
+	m_rowPackets(0),
+	m_frameReady(false),
+	m_framesNotReady(0),
 	m_panelWidth(0),
 	m_panelHeight(0),
 	m_panels(0),
@@ -120,17 +119,10 @@ ColorLight5a75Output::~ColorLight5a75Output()
 {
 	LogDebug(VB_CHANNELOUT, "ColorLight5a75Output::~ColorLight5a75Output()\n");
 
+	m_packets.Close();
+
 	if (m_fd >= 0)
 		close(m_fd);
-
-	if (m_outputFrame)
-		delete [] m_outputFrame;
-
-	if (m_buffer_0101)
-		free(m_buffer_0101);
-
-	if (m_buffer_0AFF)
-		free(m_buffer_0AFF);
 }
 
 /*
@@ -210,8 +202,6 @@ int ColorLight5a75Output::Init(Json::Value config)
 
 	m_channelCount = m_width * m_height * 3;
 
-	m_outputFrame = new char[m_outputs * m_longestChain * m_panelHeight * m_panelWidth * 3];
-
 	m_matrix = new Matrix(m_startChannel, m_width, m_height);
 
 	if (config.isMember("subMatrices")) {
@@ -253,49 +243,6 @@ int ColorLight5a75Output::Init(Json::Value config)
 		m_ifName = "eth1";
 
 
-	////////////////////////////
-	// Setup 0x0101 packet data
-	m_buffer_0101_len = sizeof(struct ether_header) + 98;
-	m_buffer_0101 = (char *)calloc(m_buffer_0101_len, 1);
-	if (!m_buffer_0101) {
-		LogErr(VB_CHANNELOUT, "Error allocating m_buffer_0101\n");
-		return 0;
-	}
-
-	memset(m_buffer_0101, 0, m_buffer_0101_len);
-	SetHostMACs(m_buffer_0101);
-	m_eh = (struct ether_header *)m_buffer_0101;
-	m_eh->ether_type = htons(0x0101);
-
-	////////////////////////////
-	// Setup 0x0AFF packet data
-	m_buffer_0AFF_len = sizeof(struct ether_header) + 63;
-	m_buffer_0AFF = (char *)calloc(m_buffer_0AFF_len, 1);
-	if (!m_buffer_0AFF) {
-		LogErr(VB_CHANNELOUT, "Error allocating m_buffer_0AFF\n");
-		return 0;
-	}
-
-	memset(m_buffer_0AFF, 0, m_buffer_0AFF_len);
-	SetHostMACs(m_buffer_0AFF);
-	m_eh = (struct ether_header *)m_buffer_0AFF;
-	m_data = m_buffer_0AFF + sizeof(struct ether_header);
-	m_eh->ether_type = htons(0x0AFF);
-	m_data[0] = 0xff;
-	m_data[1] = 0xff;
-	m_data[2] = 0xff;
-
-	////////////////////////////
-	// Set main data packet
-	memset(m_buffer, 0, CL5A75_BUFFER_SIZE);
-	m_eh = (struct ether_header *)m_buffer;
-	m_data = m_buffer + sizeof(struct ether_header);
-	m_eh->ether_type = htons(0x5500);
-	SetHostMACs(m_buffer);
-
-	m_rowSize = m_longestChain * m_panelWidth * 3;
-
-
 	// Open our raw socket
 	if ((m_fd = socket(AF_PACKET, SOCK_RAW, IPPROTO_RAW)) == -1) {
 		LogErr(VB_CHANNELOUT, "Error creating raw socket: %s\n", strerror(errno));
@@ -310,11 +257,96 @@ int ColorLight5a75Output::Init(Json::Value config)
 		return 0;
 	}
 
+	m_rowSize = m_longestChain * m_panelWidth * 3;
+	m_rowPackets = (m_rowSize + CL5A75_MAX_ROW_BYTES - 1) / CL5A75_MAX_ROW_BYTES;
+
+	struct ether_header eh;
+	SetHostMACs(&eh);
+
+	memset(&m_sock_addr, 0, sizeof(m_sock_addr));
+	m_sock_addr.sll_family = AF_PACKET;
 	m_sock_addr.sll_ifindex = m_if_idx.ifr_ifindex;
 	m_sock_addr.sll_halen = ETH_ALEN;
-	memcpy(m_sock_addr.sll_addr, m_eh->ether_dhost, 6);
+	memcpy(m_sock_addr.sll_addr, eh.ether_dhost, 6);
+
+	if (!m_packets.Init(m_fd, m_sock_addr, CL5A75_FIRST_ROW_PACKET + (m_rows * m_rowPackets),
+			CL5A75_BUFFER_SIZE)) {
+		LogErr(VB_CHANNELOUT, "Error setting up ColorLight packets\n");
+		return 0;
+	}
+
+	////////////////////////////
+	// Setup 0x0101 packet data
+	unsigned char *pkt = m_packets.Packet(0);
+	memset(pkt, 0, sizeof(struct ether_header) + 98);
+	SetHostMACs(pkt);
+	((struct ether_header *)pkt)->ether_type = htons(0x0101);
+	m_packets.SetLength(0, sizeof(struct ether_header) + 98);
+
+	////////////////////////////
+	// Setup 0x0AFF packet data
+	pkt = m_packets.Packet(1);
+	memset(pkt, 0, sizeof(struct ether_header) + 63);
+	SetHostMACs(pkt);
+	((struct ether_header *)pkt)->ether_type = htons(0x0AFF);
+	pkt[sizeof(struct ether_header)    ] = 0xff;
+	pkt[sizeof(struct ether_header) + 1] = 0xff;
+	pkt[sizeof(struct ether_header) + 2] = 0xff;
+	m_packets.SetLength(1, sizeof(struct ether_header) + 63);
+
+	////////////////////////////
+	// Setup row data packet headers
+	for (int row = 0; row < m_rows; row++) {
+		for (int offset = 0, p = 0; offset < m_rowSize; offset += CL5A75_MAX_ROW_BYTES, p++) {
+			int index = CL5A75_FIRST_ROW_PACKET + (row * m_rowPackets) + p;
+			int bytesInPacket = m_rowSize - offset;
+			if (bytesInPacket > CL5A75_MAX_ROW_BYTES)
+				bytesInPacket = CL5A75_MAX_ROW_BYTES;
+
+			int pixelOffset = offset / 3;
+			int pixelsInPacket = bytesInPacket / 3;
+
+			pkt = m_packets.Packet(index);
+			memset(pkt, 0, sizeof(struct ether_header) + 7 + bytesInPacket);
+			SetHostMACs(pkt);
+
+			// 0x5500 for rows 0-255, 0x5501 for rows 256-511
+			((struct ether_header *)pkt)->ether_type = htons(0x5500 + (row >> 8));
+
+			unsigned char *data = pkt + sizeof(struct ether_header);
+			data[0] = row & 0xFF;
+			data[1] = pixelOffset >> 8;      // Pixel Offset MSB
+			data[2] = pixelOffset & 0xFF;    // Pixel Offset LSB
+			data[3] = pixelsInPacket >> 8;   // Pixels In Packet MSB
+			data[4] = pixelsInPacket & 0xFF; // Pixels In Packet LSB
+			data[5] = 0x08; // ?? still not sure what this value is
+			data[6] = 0x80; // ?? still not sure what this value is
+
+			m_packets.SetLength(index, sizeof(struct ether_header) + 7 + bytesInPacket);
+		}
+	}
+
+	////////////////////////////
+	// Map each panel row to where it lands in the row packets
+	for (int output = 0; output < m_outputs; output++) {
+		int panelsOnOutput = m_panelMatrix->m_outputPanels[output].size();
+
+		for (int i = 0; i < panelsOnOutput; i++) {
+			int panel = m_panelMatrix->m_outputPanels[output][i];
+			int chain = m_panelMatrix->m_panels[panel].chain;
 
-	m_rowData = m_data + 7;
+			for (int y = 0; y < m_panelHeight; y++) {
+				int row = (output * m_panelHeight) + y;
+				int px = chain * m_panelWidth;
+				int yw = y * m_panelWidth * 3;
+
+				PacketRing::AddSegments(m_segments, px * 3,
+					&m_panelMatrix->m_panels[panel].pixelMap[yw], m_panelWidth * 3,
+					CL5A75_FIRST_ROW_PACKET + (row * m_rowPackets),
+					sizeof(struct ether_header) + 7, CL5A75_MAX_ROW_BYTES);
+			}
+		}
+	}
 
 	return ChannelOutputBase::Init(config);
 }
@@ -338,40 +370,16 @@ void ColorLight5a75Output::GetRequiredChannelRange(int &min, int & max) {
  */
 void ColorLight5a75Output::PrepData(unsigned char *channelData)
 {
-	unsigned char *r = NULL;
-	unsigned char *g = NULL;
-	unsigned char *b = NULL;
-	unsigned char *s = NULL;
-	unsigned char *dst = NULL;
-	int pw3 = m_panelWidth * 3;
+	// the last frame is still being sent if the ring hasn't drained
+	m_frameReady = m_packets.Ready();
+	if (!m_frameReady) {
+		m_framesNotReady++;
+		return;
+	}
 
 	channelData += m_startChannel; // FIXME, this function gets offset 0
 
-	for (int output = 0; output < m_outputs; output++) {
-		int panelsOnOutput = m_panelMatrix->m_outputPanels[output].size();
-
-		for (int i = 0; i < panelsOnOutput; i++) {
-			int panel = m_panelMatrix->m_outputPanels[output][i];
-			int chain = (panelsOnOutput - 1) - m_panelMatrix->m_panels[panel].chain;
-			chain = m_panelMatrix->m_panels[panel].chain;
-
-			for (int y = 0; y < m_panelHeight; y++) {
-				int px = chain * m_panelWidth;
-				int yw = y * m_panelWidth * 3;
-
-				dst = (unsigned char*)(m_outputFrame + (((((output * m_panelHeight) + y) * m_panelWidth * m_longestChain) + px) * 3));
-
-				for (int x = 0; x < pw3; x += 3)
-				{
-					*(dst++) = m_gammaCurve[channelData[m_panelMatrix->m_panels[panel].pixelMap[yw + x]]];
-					*(dst++) = m_gammaCurve[channelData[m_panelMatrix->m_panels[panel].pixelMap[yw + x + 1]]];
-					*(dst++) = m_gammaCurve[channelData[m_panelMatrix->m_panels[panel].pixelMap[yw + x + 2]]];
-
-					px++;
-				}
-			}
-		}
-	}
+	m_packets.Gather(m_segments, channelData, m_gammaCurve);
 }
 
 /*
@@ -381,66 +389,13 @@ int ColorLight5a75Output::SendData(unsigned char *channelData)
 {
 	LogExcess(VB_CHANNELOUT, "ColorLight5a75Output::SendData(%p)\n", channelData);
 
-	if (sendto(m_fd, m_buffer_0101, m_buffer_0101_len, 0, (struct sockaddr*)&m_sock_addr, sizeof(struct sockaddr_ll)) < 0) {
-		LogErr(VB_CHANNELOUT, "Error sending 0x0101 packet: %s\n", strerror(errno));
+	if (!m_frameReady) {
+		m_packets.Flush();
 		return 0;
 	}
 
-	if (sendto(m_fd, m_buffer_0AFF, m_buffer_0AFF_len, 0, (struct sockaddr*)&m_sock_addr, sizeof(struct sockaddr_ll)) < 0) {
-		LogErr(VB_CHANNELOUT, "Error sending 0x0AFF packet: %s\n", strerror(errno));
+	if (!m_packets.Send())
 		return 0;
-	}
-
-	char *rowPtr = (char *)m_outputFrame;
-	int row = 0;
-	int offset = 0;
-	int pixelOffset = 0;
-	int maxPixelsPerPacket = 497;
-	int maxBytesPerPacket = maxPixelsPerPacket * 3;
-	int bytesInPacket = 0;
-	int pixelsInPacket = 0;
-	int pktSize = 0;
-	for (row = 0; row < m_rows; row++) {
-		if (row < 256) {
-			m_eh->ether_type = htons(0x5500);
-			m_data[0] = row;
-		} else {
-			m_eh->ether_type = htons(0x5501);
-			m_data[0] = row % 256;
-		}
-
-		m_data[5] = 0x08; // ?? still not sure what this value is
-		m_data[6] = 0x80; // ?? still not sure what this value is
-
-		offset = 0;
-		while (offset < m_rowSize) {
-			if ((offset + maxBytesPerPacket) > m_rowSize)
-				bytesInPacket = m_rowSize - offset;
-			else
-				bytesInPacket = maxBytesPerPacket;
-
-			memcpy(m_rowData, rowPtr + offset, bytesInPacket);
-
-			pixelOffset = offset / 3;
-			pixelsInPacket = bytesInPacket / 3;
-
-			m_data[1] = pixelOffset >> 8;      // Pixel Offset MSB
-			m_data[2] = pixelOffset & 0xFF;    // Pixel Offset LSB
-			m_data[3] = pixelsInPacket >> 8;   // Pixels In Packet MSB
-			m_data[4] = pixelsInPacket & 0xFF; // Pixels In Packet LSB
-
-			offset += bytesInPacket;
-
-			pktSize = sizeof(struct ether_header) + 7 + bytesInPacket;
-
-			if (sendto(m_fd, m_buffer, pktSize, 0, (struct sockaddr*)&m_sock_addr, sizeof(struct sockaddr_ll)) < 0) {
-				LogErr(VB_CHANNELOUT, "Error sending row data packet: %s\n", strerror(errno));
-				return 0;
-			}
-		}
-
-		rowPtr += m_rowSize;
-	}
 
 	return m_channelCount;
 }
@@ -461,9 +416,21 @@ void ColorLight5a75Output::DumpConfig(void)
 	LogDebug(VB_CHANNELOUT, "    Longest Chain  : %d\n", m_longestChain);
 	LogDebug(VB_CHANNELOUT, "    Inverted Data  : %d\n", m_invertedData);
 
+	LogDebug(VB_CHANNELOUT, "    Packets        : %d\n", CL5A75_FIRST_ROW_PACKET + (m_rows * m_rowPackets));
+	LogDebug(VB_CHANNELOUT, "    TX Ring        : %s\n", m_packets.UsingRing() ? "yes" : "no");
+
 	ChannelOutputBase::DumpConfig();
 }
 
+/*
+ *
+ */
+void ColorLight5a75Output::GetOutputStats(Json::Value &result)
+{
+	result["txRing"] = m_packets.UsingRing();
+	result["framesNotReady"] = (Json::UInt64)m_framesNotReady;
+}
+
 /*
  *
  */
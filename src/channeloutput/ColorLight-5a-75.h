@@ -30,13 +30,17 @@
 #include <linux/if_packet.h>
 #include <net/if.h>
 #include <string>
+#include <vector>
 
 #include "ChannelOutputBase.h"
 #include "ColorOrder.h"
 #include "Matrix.h"
+#include "PacketRing.h"
 #include "PanelMatrix.h"
 
-#define CL5A75_BUFFER_SIZE  1536
+#define CL5A75_BUFFER_SIZE      1536
+#define CL5A75_MAX_ROW_BYTES    (497 * 3)
+#define CL5A75_FIRST_ROW_PACKET 2
 
 class ColorLight5a75Output : public ChannelOutputBase {
   public:
@@ -50,6 +54,7 @@ class ColorLight5a75Output : public ChannelOutputBase {
 	virtual int  SendData(unsigned char *channelData);
 
 	void DumpConfig(void);
+	void GetOutputStats(Json::Value &result);
 
     virtual void GetRequiredChannelRange(int &min, int & max);
 
@@ -65,19 +70,18 @@ class ColorLight5a75Output : public ChannelOutputBase {
 
 	int   m_fd;
 
-	char *m_buffer_0101;
-	int   m_buffer_0101_len;
-	char *m_buffer_0AFF;
-	int   m_buffer_0AFF_len;
-	
-	char  m_buffer[CL5A75_BUFFER_SIZE];
-	char *m_data;
-	char *m_rowData;
 	int   m_rowSize;
+	int   m_rowPackets;
+
+	// 0x0101, 0x0AFF then the row packets, the pixel data is gathered
+	// straight into the row packets
+	PacketRing                     m_packets;
+	std::vector<PacketRingSegment> m_segments;
+	bool                           m_frameReady;
+	unsigned long                  m_framesNotReady;
 
 	struct ifreq          m_if_idx;
 	struct ifreq          m_if_mac;
-	struct ether_header  *m_eh;
 	struct sockaddr_ll    m_sock_addr;
 
 	int          m_panelWidth;
@@ -87,7 +91,6 @@ class ColorLight5a75Output : public ChannelOutputBase {
 	int          m_outputs;
 	int          m_longestChain;
 	int          m_invertedData;
-	char        *m_outputFrame;
 	Matrix      *m_matrix;
 	PanelMatrix *m_panelMatrix;
     uint8_t      m_gammaCurve[256];
@@ -38,6 +38,7 @@ public:
     virtual bool IsPingable() { return true; }
     virtual void PrepareData(unsigned char *channelData);
     virtual void CreateMessages(std::vector<struct mmsghdr> &ipMsgs);
+    virtual bool HasPushMessage() { return true; }
     virtual void DumpConfig();
     
     char          sequenceNumber;
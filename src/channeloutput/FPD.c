@@ -40,6 +40,7 @@
 #include "log.h"
 #include "Sequence.h"
 #include "settings.h"
+#include "Threads.h"
 
 #ifdef USEWIRINGPI
 #	include "wiringPi.h"
@@ -154,6 +155,8 @@ void *RunFPDOutputThread(void *data)
 {
 	LogDebug(VB_CHANNELOUT, "RunFPDOutputThread()\n");
 
+	SetThreadRole(THREAD_ROLE_OUTPUT_DEVICE, "fpp-FPD");
+
 	long long wakeTime = GetTime();
 	struct timeval  tv;
 	struct timespec ts;
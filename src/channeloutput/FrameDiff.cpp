@@ -0,0 +1,163 @@
+/*
+ *   Channel output frame diff for Falcon Player (FPP)
+ *
+ *   Copyright (C) 2013-2018 the Falcon Player Developers
+ *      Initial development by:
+ *      - David Pitts (dpitts)
+ *      - Tony Mace (MyKroFt)
+ *      - Mathew Mrosko (Materdaddy)
+ *      - Chris Pinkham (CaptainMurdoch)
+ *      For additional credits and developers, see credits.php.
+ *
+ *   The Falcon Player (FPP) is free software; you can redistribute it
+ *   and/or modify it under the terms of the GNU General Public License
+ *   as published by the Free Software Foundation; either version 2 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+
+#include "log.h"
+#include "FrameDiff.h"
+#include "OutputKernels.h"
+
+static uint32_t       diffStart = 0;
+static uint32_t       diffCount = 0;
+static int            diffBlocks = 0;   // whole blocks
+static uint32_t       diffTail = 0;     // channels after the last whole block
+static unsigned char *prevFrame = NULL;
+static uint64_t      *dirtyBits = NULL;
+static int            dirtyWords = 0;
+static bool           allDirty = true;
+
+static std::atomic<uint64_t> framesCompared(0);
+static std::atomic<uint64_t> blocksChanged(0);
+static std::atomic<int>      lastBlocksChanged(0);
+
+static inline bool BlockDirty(int b)
+{
+	return dirtyBits[b / 64] & (1ULL << (b % 64));
+}
+
+void InitFrameDiff(uint32_t startChannel, uint32_t channelCount)
+{
+	CloseFrameDiff();
+
+	diffStart = startChannel;
+	diffCount = channelCount;
+	diffBlocks = channelCount / DIFF_BLOCK_SIZE;
+	diffTail = channelCount % DIFF_BLOCK_SIZE;
+
+	int totalBlocks = diffBlocks + (diffTail ? 1 : 0);
+	dirtyWords = (totalBlocks + 63) / 64;
+
+	prevFrame = (unsigned char *)calloc(1, channelCount ? channelCount : 1);
+	dirtyBits = (uint64_t *)calloc(dirtyWords ? dirtyWords : 1, sizeof(uint64_t));
+
+	LogDebug(VB_CHANNELOUT, "Frame diff covering channels %u-%u in %d byte blocks\n",
+		startChannel + 1, startChannel + channelCount, DIFF_BLOCK_SIZE);
+
+	// everything goes out with the first frame
+	allDirty = true;
+}
+
+void CloseFrameDiff(void)
+{
+	free(prevFrame);
+	free(dirtyBits);
+	prevFrame = NULL;
+	dirtyBits = NULL;
+	diffCount = 0;
+	diffBlocks = 0;
+	diffTail = 0;
+	dirtyWords = 0;
+	allDirty = true;
+}
+
+void UpdateFrameDiff(const unsigned char *channelData)
+{
+	if (!prevFrame)
+		return;
+
+	const unsigned char *cur = channelData + diffStart;
+	int changed = DiffBlocks(prevFrame, cur, diffBlocks, dirtyBits);
+
+	if (diffTail) {
+		uint32_t offset = diffBlocks * DIFF_BLOCK_SIZE;
+		if (memcmp(prevFrame + offset, cur + offset, diffTail)) {
+			memcpy(prevFrame + offset, cur + offset, diffTail);
+			dirtyBits[diffBlocks / 64] |= 1ULL << (diffBlocks % 64);
+			changed++;
+		}
+	}
+
+	framesCompared.fetch_add(1, std::memory_order_relaxed);
+	blocksChanged.fetch_add(changed, std::memory_order_relaxed);
+	lastBlocksChanged.store(changed, std::memory_order_relaxed);
+}
+
+void ClearFrameDiff(void)
+{
+	if (dirtyBits)
+		memset(dirtyBits, 0, dirtyWords * sizeof(uint64_t));
+
+	allDirty = false;
+}
+
+bool FrameChannelsChanged(uint32_t startChannel, uint32_t channelCount)
+{
+	if (allDirty || !prevFrame)
+		return true;
+
+	// Only the channels some output needs are compared, nothing else
+	// is read from the sequence so the rest never changes
+	uint64_t first = std::max((uint64_t)startChannel, (uint64_t)diffStart);
+	uint64_t end = std::min((uint64_t)startChannel + channelCount,
+	                        (uint64_t)diffStart + diffCount);
+	if (first >= end)
+		return false;
+
+	int firstBlock = (first - diffStart) / DIFF_BLOCK_SIZE;
+	int last = (end - 1 - diffStart) / DIFF_BLOCK_SIZE;
+
+	for (int b = firstBlock; b <= last; ) {
+		if (!(b % 64) && ((b + 63) <= last)) {
+			if (dirtyBits[b / 64])
+				return true;
+			b += 64;
+		} else {
+			if (BlockDirty(b))
+				return true;
+			b++;
+		}
+	}
+
+	return false;
+}
+
+void GetFrameDiffStats(Json::Value &result)
+{
+	uint64_t frames = framesCompared.load(std::memory_order_relaxed);
+	Json::Value stats;
+
+	stats["blockSize"] = DIFF_BLOCK_SIZE;
+	stats["blocks"] = diffBlocks + (diffTail ? 1 : 0);
+	stats["framesCompared"] = (Json::UInt64)frames;
+	stats["lastBlocksChanged"] = lastBlocksChanged.load(std::memory_order_relaxed);
+	stats["avgBlocksChanged"] = frames ?
+		(double)blocksChanged.load(std::memory_order_relaxed) / frames : 0.0;
+
+	result["frameDiff"] = stats;
+}
@@ -0,0 +1,56 @@
+/*
+ *   Channel output frame diff for Falcon Player (FPP)
+ *
+ *   Copyright (C) 2013-2018 the Falcon Player Developers
+ *      Initial development by:
+ *      - David Pitts (dpitts)
+ *      - Tony Mace (MyKroFt)
+ *      - Mathew Mrosko (Materdaddy)
+ *      - Chris Pinkham (CaptainMurdoch)
+ *      For additional credits and developers, see credits.php.
+ *
+ *   The Falcon Player (FPP) is free software; you can redistribute it
+ *   and/or modify it under the terms of the GNU General Public License
+ *   as published by the Free Software Foundation; either version 2 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _FRAMEDIFF_H
+#define _FRAMEDIFF_H
+
+#include <stdint.h>
+
+#include <jsoncpp/json/json.h>
+
+// Tracks which channels changed since the outputs last sent a frame.  The
+// frame is compared against a copy of the last one sent in DIFF_BLOCK_SIZE
+// byte blocks just before the outputs send it, and the dirty blocks are
+// cleared once every output has sent it.  A channel is reported as changed
+// if anything in its block changed.  Until InitFrameDiff() is called every
+// channel is reported as changed.  The callers in channeloutput.c
+// serialize all of these with the output dispatch.
+
+void InitFrameDiff(uint32_t startChannel, uint32_t channelCount);
+void CloseFrameDiff(void);
+
+// Compare channelData against the last frame sent
+void UpdateFrameDiff(const unsigned char *channelData);
+
+// Called once the frame has been sent to the outputs
+void ClearFrameDiff(void);
+
+// Channels are 0 based.  Channels outside the range the outputs need are
+// never read so are reported as unchanged.
+bool FrameChannelsChanged(uint32_t startChannel, uint32_t channelCount);
+
+void GetFrameDiffStats(Json::Value &result);
+
+#endif /* _FRAMEDIFF_H */
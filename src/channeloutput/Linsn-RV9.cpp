@@ -75,6 +75,7 @@
 
 #include "common.h"
 #include "Linsn-RV9.h"
+#include "OutputKernels.h"
 #include "log.h"
 
 /*
@@ -90,6 +91,8 @@ LinsnRV9Output::LinsnRV9Output(unsigned int startChannel, unsigned int channelCo
 	m_data(NULL),
 	m_pktSize(LINSNRV9_BUFFER_SIZE),
 	m_framePackets(0),
+	m_frameReady(false),
+	m_framesNotReady(0),
 	m_panelWidth(0),
 	m_panelHeight(0),
 	m_panels(0),
@@ -132,11 +135,10 @@ LinsnRV9Output::~LinsnRV9Output()
 {
 	LogDebug(VB_CHANNELOUT, "LinsnRV9Output::~LinsnRV9Output()\n");
 
+	m_packets.Close();
+
 	if (m_fd >= 0)
 		close(m_fd);
-
-	if (m_outputFrame)
-		delete [] m_outputFrame;
 }
 
 /*
@@ -220,10 +222,6 @@ int LinsnRV9Output::Init(Json::Value config)
 
 	m_channelCount = m_width * m_height * 3;
 
-	// Calculate max frame size and allocate
-	m_outputFrameSize = m_formatCodes[m_formatIndex].width * m_formatCodes[m_formatIndex].height * 3 + m_formatCodes[m_formatIndex].dataOffset;
-	m_outputFrame = new char[m_outputFrameSize];
-
 	// Calculate the minimum number of packets to send the height we need
 	m_framePackets = ((m_height * m_formatCodes[m_formatIndex].width + m_formatCodes[m_formatIndex].dataOffset) / 480) + 1;
 
@@ -353,6 +351,62 @@ int LinsnRV9Output::Init(Json::Value config)
 	// FIXME, this should use the MAC received during discovery
 	SetHostMACs(m_buffer);
 
+	// Only set up the frame packets after the handshake, every send on the
+	// socket goes through the TX ring once there is one
+	if (!m_packets.Init(m_fd, m_sock_addr, m_framePackets, LINSNRV9_BUFFER_SIZE))
+	{
+		LogErr(VB_CHANNELOUT, "Error setting up Linsn packets\n");
+		return 0;
+	}
+
+	// The first packet has the format and brightness and no data
+	unsigned char *pkt = m_packets.Packet(0);
+	memset(pkt, 0, LINSNRV9_BUFFER_SIZE);
+	memcpy(pkt, m_buffer, sizeof(struct ether_header) + LINSNRV9_HEADER_SIZE);
+	pkt[14] = 0x00; // frame number
+	pkt[15] = 0x00;
+
+	for (int frameNumber = 1; frameNumber < m_framePackets; frameNumber++)
+	{
+		pkt = m_packets.Packet(frameNumber);
+		memset(pkt, 0, LINSNRV9_BUFFER_SIZE);
+		memcpy(pkt, m_buffer, sizeof(struct ether_header));
+		pkt[14] = (unsigned char)(frameNumber & 0x00FF);
+		pkt[15] = (unsigned char)(frameNumber >> 8);
+	}
+
+	// Map each panel row to where it lands in the data packets, anything
+	// past the last packet isn't sent
+	std::vector<PacketRingSegment> segments;
+	for (int output = 0; output < m_outputs; output++)
+	{
+		int panelsOnOutput = m_panelMatrix->m_outputPanels[output].size();
+
+		for (int i = 0; i < panelsOnOutput; i++)
+		{
+			int panel = m_panelMatrix->m_outputPanels[output][i];
+			int chain = (panelsOnOutput - 1) - m_panelMatrix->m_panels[panel].chain;
+
+			for (int y = 0; y < m_panelHeight; y++)
+			{
+				int px = chain * m_panelWidth;
+				int yw = y * m_panelWidth * 3;
+				int offset = ((((output * m_panelHeight) + y) * m_formatCodes[m_formatIndex].width) + px) * 3 + m_formatCodes[m_formatIndex].dataOffset;
+
+				PacketRing::AddSegments(segments, offset,
+					&m_panelMatrix->m_panels[panel].pixelMap[yw], m_panelWidth * 3,
+					1, sizeof(struct ether_header) + LINSNRV9_HEADER_SIZE,
+					LINSNRV9_DATA_SIZE);
+			}
+		}
+	}
+
+	for (auto &seg : segments)
+	{
+		if (seg.packet < m_framePackets)
+			m_segments.push_back(seg);
+	}
+
 	return ChannelOutputBase::Init(config);
 }
 
@@ -376,42 +430,17 @@ void LinsnRV9Output::GetRequiredChannelRange(int &min, int & max) {
  */
 void LinsnRV9Output::PrepData(unsigned char *channelData)
 {
-	unsigned char *r = NULL;
-	unsigned char *g = NULL;
-	unsigned char *b = NULL;
-	unsigned char *s = NULL;
-	unsigned char *dst = NULL;
-	int pw3 = m_panelWidth * 3;
-
-	channelData += m_startChannel; // FIXME, this function gets offset 0
-
-	for (int output = 0; output < m_outputs; output++)
+	// the last frame is still being sent if the ring hasn't drained
+	m_frameReady = m_packets.Ready();
+	if (!m_frameReady)
 	{
-		int panelsOnOutput = m_panelMatrix->m_outputPanels[output].size();
-
-		for (int i = 0; i < panelsOnOutput; i++)
-		{
-			int panel = m_panelMatrix->m_outputPanels[output][i];
-			int chain = (panelsOnOutput - 1) - m_panelMatrix->m_panels[panel].chain;
-
-			for (int y = 0; y < m_panelHeight; y++)
-			{
-				int px = chain * m_panelWidth;
-				int yw = y * m_panelWidth * 3;
-
-				dst = (unsigned char*)(m_outputFrame + (((((output * m_panelHeight) + y) * m_formatCodes[m_formatIndex].width) + px) * 3) + m_formatCodes[m_formatIndex].dataOffset);
+		m_framesNotReady++;
+		return;
+	}
 
-				for (int x = 0; x < pw3; x += 3)
-				{
-					*(dst++) = m_gammaCurve[channelData[m_panelMatrix->m_panels[panel].pixelMap[yw + x]]];
-					*(dst++) = m_gammaCurve[channelData[m_panelMatrix->m_panels[panel].pixelMap[yw + x + 1]]];
-					*(dst++) = m_gammaCurve[channelData[m_panelMatrix->m_panels[panel].pixelMap[yw + x + 2]]];
+	channelData += m_startChannel; // FIXME, this function gets offset 0
 
-					px++;
-				}
-			}
-		}
-	}
+	m_packets.Gather(m_segments, channelData, m_gammaCurve);
 }
 
 /*
@@ -421,49 +450,14 @@ int LinsnRV9Output::SendData(unsigned char *channelData)
 {
 	LogExcess(VB_CHANNELOUT, "LinsnRV9Output::SendData(%p)\n", channelData);
 
-	SetHostMACs(m_buffer);
-	memset(m_data, 0, LINSNRV9_DATA_SIZE);
-
-	// Clear the frame number
-	m_buffer[14] = 0x00;
-	m_buffer[15] = 0x00;
-
-	m_buffer[22] = 0x96;
-
-	m_buffer[26] = 0x85;
-	m_buffer[27] = m_formatCodes[m_formatIndex].d27;
-	m_buffer[28] = 0xff; // something to do with brightness
-	m_buffer[29] = 0xff; // something to do with brightness
-	m_buffer[30] = 0xff; // something to do with brightness
-	m_buffer[31] = 0xff; // something to do with brightness
-
-	m_buffer[45] = m_formatCodes[m_formatIndex].code;
-
-	if (sendto(m_fd, m_buffer, LINSNRV9_BUFFER_SIZE, 0, (struct sockaddr*)&m_sock_addr, sizeof(struct sockaddr_ll)) < 0) {
-		LogErr(VB_CHANNELOUT, "Error sending row data packet: %s\n", strerror(errno));
+	if (!m_frameReady)
+	{
+		m_packets.Flush();
 		return 0;
 	}
 
-	int row = 0;
-	int frameNumber = 1;
-	int bytesSent = 0;
-	int framesSent = 0;
-
-	memset(m_header, 0, LINSNRV9_HEADER_SIZE);
-	while (frameNumber < m_framePackets) {
-		m_buffer[14] = (unsigned char)(frameNumber & 0x00FF);
-		m_buffer[15] = (unsigned char)(frameNumber >> 8);
-
-		memcpy(m_data, m_outputFrame + bytesSent, LINSNRV9_DATA_SIZE);
-
-		if (sendto(m_fd, m_buffer, LINSNRV9_BUFFER_SIZE, 0, (struct sockaddr*)&m_sock_addr, sizeof(struct sockaddr_ll)) < 0) {
-			LogErr(VB_CHANNELOUT, "Error sending row data packet: %s\n", strerror(errno));
-			return 0;
-		}
-
-		bytesSent += LINSNRV9_DATA_SIZE;
-		frameNumber++;
-	}
+	if (!m_packets.Send())
+		return 0;
 
 	return m_channelCount;
 }
@@ -493,10 +487,21 @@ void LinsnRV9Output::DumpConfig(void)
 		 m_formatCodes[m_formatIndex].dataOffset);
 	LogDebug(VB_CHANNELOUT, "    Fmt D27        : 0x%02x\n",
 		 m_formatCodes[m_formatIndex].d27);
+	LogDebug(VB_CHANNELOUT, "    TX Ring        : %s\n",
+		m_packets.UsingRing() ? "yes" : "no");
 
 	ChannelOutputBase::DumpConfig();
 }
 
+/*
+ *
+ */
+void LinsnRV9Output::GetOutputStats(Json::Value &result)
+{
+	result["txRing"] = m_packets.UsingRing();
+	result["framesNotReady"] = (Json::UInt64)m_framesNotReady;
+}
+
 /*
  *
  */
@@ -35,6 +35,7 @@
 #include "ChannelOutputBase.h"
 #include "ColorOrder.h"
 #include "Matrix.h"
+#include "PacketRing.h"
 #include "PanelMatrix.h"
 
 #define LINSNRV9_BUFFER_SIZE  1486
@@ -53,6 +54,7 @@ class LinsnRV9Output : public ChannelOutputBase {
 	int  SendData(unsigned char *channelData);
 
 	void DumpConfig(void);
+	void GetOutputStats(Json::Value &result);
 
     virtual void GetRequiredChannelRange(int &min, int & max);
 
@@ -79,6 +81,13 @@ class LinsnRV9Output : public ChannelOutputBase {
 	int   m_framePackets;
 	int   m_frameNumber;
 
+	// The header packet then the data packets, the pixel data is
+	// gathered straight into the data packets
+	PacketRing                     m_packets;
+	std::vector<PacketRingSegment> m_segments;
+	bool                           m_frameReady;
+	unsigned long                  m_framesNotReady;
+
 	struct ifreq          m_if_idx;
 	struct ifreq          m_if_mac;
 	struct ether_header  *m_eh;
@@ -91,8 +100,6 @@ class LinsnRV9Output : public ChannelOutputBase {
 	int          m_outputs;
 	int          m_longestChain;
 	int          m_invertedData;
-	char        *m_outputFrame;
-	int          m_outputFrameSize;
 	Matrix      *m_matrix;
 	PanelMatrix *m_panelMatrix;
 	int          m_formatIndex;
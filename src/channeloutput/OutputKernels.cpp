@@ -0,0 +1,294 @@
+/*
+ *   Channel data kernels for Falcon Player (FPP)
+ *
+ *   Copyright (C) 2013-2018 the Falcon Player Developers
+ *      Initial development by:
+ *      - David Pitts (dpitts)
+ *      - Tony Mace (MyKroFt)
+ *      - Mathew Mrosko (Materdaddy)
+ *      - Chris Pinkham (CaptainMurdoch)
+ *      For additional credits and developers, see credits.php.
+ *
+ *   The Falcon Player (FPP) is free software; you can redistribute it
+ *   and/or modify it under the terms of the GNU General Public License
+ *   as published by the Free Software Foundation; either version 2 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__arm__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#include "log.h"
+#include "OutputKernels.h"
+
+/////////////////////////////////////////////////////////////////////////////
+// Plain C versions, used when nothing better is available and for the
+// leftover channels at the end of the vector loops
+
+static void ApplyValueMapC(uint8_t *data, int count, const uint8_t *table)
+{
+    for (int x = 0; x < count; x++) {
+        data[x] = table[data[x]];
+    }
+}
+
+static void GatherValueMapC(uint8_t *dst, const uint8_t *src, const int *map,
+                            int count, const uint8_t *table)
+{
+    for (int x = 0; x < count; x++) {
+        dst[x] = table[src[map[x]]];
+    }
+}
+
+static void ReorderRGBC(uint8_t *dst, const uint8_t *src, int count,
+                        const uint8_t *order)
+{
+    for (int x = 0; x < count; x++, src += 3, dst += 3) {
+        uint8_t a = src[order[0]];
+        uint8_t b = src[order[1]];
+        uint8_t c = src[order[2]];
+        dst[0] = a;
+        dst[1] = b;
+        dst[2] = c;
+    }
+}
+
+static int DiffBlocksC(uint8_t *prev, const uint8_t *cur, int blocks,
+                       uint64_t *dirty)
+{
+    int changed = 0;
+    for (int b = 0; b < blocks; b++, prev += DIFF_BLOCK_SIZE, cur += DIFF_BLOCK_SIZE) {
+        uint64_t diff = 0;
+        for (int i = 0; i < DIFF_BLOCK_SIZE; i += 8) {
+            uint64_t p, c;
+            memcpy(&p, prev + i, 8);
+            memcpy(&c, cur + i, 8);
+            diff |= p ^ c;
+        }
+        if (diff) {
+            memcpy(prev, cur, DIFF_BLOCK_SIZE);
+            dirty[b / 64] |= 1ULL << (b % 64);
+            changed++;
+        }
+    }
+    return changed;
+}
+
+static const OutputKernels cKernels = {
+    "C", ApplyValueMapC, GatherValueMapC, ReorderRGBC, DiffBlocksC
+};
+
+/////////////////////////////////////////////////////////////////////////////
+#if defined(__x86_64__) || defined(__i386__)
+
+// 16 pixels at a time in three registers.  A pixel can straddle two
+// registers so each output register is built from the shuffles of all
+// three inputs.  Everything is loaded before storing so src may be dst.
+__attribute__((target("sse4.1")))
+static void ReorderRGBSSE41(uint8_t *dst, const uint8_t *src, int count,
+                            const uint8_t *order)
+{
+    uint8_t masks[3][3][16];
+    memset(masks, 0x80, sizeof(masks));
+    for (int p = 0; p < 48; p++) {
+        int s = ((p / 3) * 3) + order[p % 3];
+        masks[p / 16][s / 16][p % 16] = s % 16;
+    }
+
+    __m128i m[3][3];
+    for (int o = 0; o < 3; o++) {
+        for (int i = 0; i < 3; i++) {
+            m[o][i] = _mm_loadu_si128((const __m128i *)masks[o][i]);
+        }
+    }
+
+    int x = 0;
+    for (; (x + 16) <= count; x += 16, src += 48, dst += 48) {
+        __m128i in0 = _mm_loadu_si128((const __m128i *)src);
+        __m128i in1 = _mm_loadu_si128((const __m128i *)(src + 16));
+        __m128i in2 = _mm_loadu_si128((const __m128i *)(src + 32));
+
+        for (int o = 0; o < 3; o++) {
+            __m128i r = _mm_or_si128(_mm_shuffle_epi8(in0, m[o][0]),
+                                     _mm_shuffle_epi8(in1, m[o][1]));
+            r = _mm_or_si128(r, _mm_shuffle_epi8(in2, m[o][2]));
+            _mm_storeu_si128((__m128i *)(dst + (o * 16)), r);
+        }
+    }
+    ReorderRGBC(dst, src, count - x, order);
+}
+
+__attribute__((target("sse4.1")))
+static int DiffBlocksSSE41(uint8_t *prev, const uint8_t *cur, int blocks,
+                           uint64_t *dirty)
+{
+    int changed = 0;
+    for (int b = 0; b < blocks; b++, prev += DIFF_BLOCK_SIZE, cur += DIFF_BLOCK_SIZE) {
+        __m128i c0 = _mm_loadu_si128((const __m128i *)cur);
+        __m128i c1 = _mm_loadu_si128((const __m128i *)(cur + 16));
+        __m128i c2 = _mm_loadu_si128((const __m128i *)(cur + 32));
+        __m128i c3 = _mm_loadu_si128((const __m128i *)(cur + 48));
+        __m128i d = _mm_or_si128(
+            _mm_or_si128(_mm_xor_si128(c0, _mm_loadu_si128((const __m128i *)prev)),
+                         _mm_xor_si128(c1, _mm_loadu_si128((const __m128i *)(prev + 16)))),
+            _mm_or_si128(_mm_xor_si128(c2, _mm_loadu_si128((const __m128i *)(prev + 32))),
+                         _mm_xor_si128(c3, _mm_loadu_si128((const __m128i *)(prev + 48)))));
+        if (!_mm_testz_si128(d, d)) {
+            _mm_storeu_si128((__m128i *)prev, c0);
+            _mm_storeu_si128((__m128i *)(prev + 16), c1);
+            _mm_storeu_si128((__m128i *)(prev + 32), c2);
+            _mm_storeu_si128((__m128i *)(prev + 48), c3);
+            dirty[b / 64] |= 1ULL << (b % 64);
+            changed++;
+        }
+    }
+    return changed;
+}
+
+__attribute__((target("avx2")))
+static int DiffBlocksAVX2(uint8_t *prev, const uint8_t *cur, int blocks,
+                          uint64_t *dirty)
+{
+    int changed = 0;
+    for (int b = 0; b < blocks; b++, prev += DIFF_BLOCK_SIZE, cur += DIFF_BLOCK_SIZE) {
+        __m256i c0 = _mm256_loadu_si256((const __m256i *)cur);
+        __m256i c1 = _mm256_loadu_si256((const __m256i *)(cur + 32));
+        __m256i d = _mm256_or_si256(
+            _mm256_xor_si256(c0, _mm256_loadu_si256((const __m256i *)prev)),
+            _mm256_xor_si256(c1, _mm256_loadu_si256((const __m256i *)(prev + 32))));
+        if (!_mm256_testz_si256(d, d)) {
+            _mm256_storeu_si256((__m256i *)prev, c0);
+            _mm256_storeu_si256((__m256i *)(prev + 32), c1);
+            dirty[b / 64] |= 1ULL << (b % 64);
+            changed++;
+        }
+    }
+    return changed;
+}
+
+// x86 has no byte gather or table lookup instruction.  A 16 pass pshufb
+// lookup measured slower than the C loop in kerneltest (2.5x slower with
+// AVX2 on a Xeon), so the value map and gather use the C versions.
+static const OutputKernels sse41Kernels = {
+    "SSE4.1", ApplyValueMapC, GatherValueMapC, ReorderRGBSSE41,
+    DiffBlocksSSE41
+};
+static const OutputKernels avx2Kernels = {
+    "AVX2", ApplyValueMapC, GatherValueMapC, ReorderRGBSSE41,
+    DiffBlocksAVX2
+};
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////////
+
+int GetSupportedOutputKernels(const OutputKernels *kernels[MAX_OUTPUT_KERNELS])
+{
+    int count = 0;
+    kernels[count++] = &cKernels;
+
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.1")) {
+        kernels[count++] = &sse41Kernels;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        kernels[count++] = &avx2Kernels;
+    }
+#elif defined(__aarch64__)
+    if (GetNEONOutputKernels()) {
+        kernels[count++] = GetNEONOutputKernels();
+    }
+#elif defined(__arm__)
+    if ((getauxval(AT_HWCAP) & HWCAP_NEON) && GetNEONOutputKernels()) {
+        kernels[count++] = GetNEONOutputKernels();
+    }
+#endif
+
+    return count;
+}
+
+static const OutputKernels *SelectOutputKernels(void)
+{
+    const OutputKernels *supported[MAX_OUTPUT_KERNELS];
+    const OutputKernels *kernels = supported[GetSupportedOutputKernels(supported) - 1];
+
+    LogDebug(VB_CHANNELOUT, "Using %s channel data kernels\n", kernels->name);
+    return kernels;
+}
+
+static inline const OutputKernels *GetOutputKernels(void)
+{
+    static const OutputKernels *kernels = SelectOutputKernels();
+    return kernels;
+}
+
+const char *GetOutputKernelsName(void)
+{
+    return GetOutputKernels()->name;
+}
+
+void ApplyValueMap(uint8_t *data, int count, const uint8_t *table)
+{
+    GetOutputKernels()->applyValueMap(data, count, table);
+}
+
+void GatherValueMap(uint8_t *dst, const uint8_t *src, const int *map,
+                    int count, const uint8_t *table, int dstStride)
+{
+    if (dstStride == 1) {
+        GetOutputKernels()->gatherValueMap(dst, src, map, count, table);
+        return;
+    }
+
+    uint8_t buf[1024];
+    for (int x = 0; x < count; x += sizeof(buf)) {
+        int len = std::min(count - x, (int)sizeof(buf));
+        GetOutputKernels()->gatherValueMap(buf, src, map + x, len, table);
+        for (int i = 0; i < len; i++, dst += dstStride) {
+            *dst = buf[i];
+        }
+    }
+}
+
+void ReorderRGB(uint8_t *dst, const uint8_t *src, int count,
+                FPPColorOrder colorOrder)
+{
+    static const uint8_t orders[][3] = {
+        { 0, 1, 2 }, // kColorOrderRGB
+        { 0, 2, 1 }, // kColorOrderRBG
+        { 1, 0, 2 }, // kColorOrderGRB
+        { 1, 2, 0 }, // kColorOrderGBR
+        { 2, 0, 1 }, // kColorOrderBRG
+        { 2, 1, 0 }  // kColorOrderBGR
+    };
+
+    if (colorOrder == kColorOrderRGB) {
+        if (dst != src) {
+            memcpy(dst, src, count * 3);
+        }
+        return;
+    }
+
+    GetOutputKernels()->reorderRGB(dst, src, count, orders[colorOrder]);
+}
+
+int DiffBlocks(uint8_t *prev, const uint8_t *cur, int blocks, uint64_t *dirty)
+{
+    return GetOutputKernels()->diffBlocks(prev, cur, blocks, dirty);
+}
@@ -0,0 +1,78 @@
+/*
+ *   Channel data kernels for Falcon Player (FPP)
+ *
+ *   Copyright (C) 2013-2018 the Falcon Player Developers
+ *      Initial development by:
+ *      - David Pitts (dpitts)
+ *      - Tony Mace (MyKroFt)
+ *      - Mathew Mrosko (Materdaddy)
+ *      - Chris Pinkham (CaptainMurdoch)
+ *      For additional credits and developers, see credits.php.
+ *
+ *   The Falcon Player (FPP) is free software; you can redistribute it
+ *   and/or modify it under the terms of the GNU General Public License
+ *   as published by the Free Software Foundation; either version 2 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _OUTPUTKERNELS_H
+#define _OUTPUTKERNELS_H
+
+#include <stdint.h>
+
+#include "ColorOrder.h"
+
+// The per channel loops shared by the outputs and output processors.  The
+// first call picks the fastest implementation the CPU supports (AVX2,
+// SSE4.1, NEON or plain C).
+
+// data[x] = table[data[x]]
+void ApplyValueMap(uint8_t *data, int count, const uint8_t *table);
+
+// dst[x * dstStride] = table[src[map[x]]]
+void GatherValueMap(uint8_t *dst, const uint8_t *src, const int *map,
+                    int count, const uint8_t *table, int dstStride = 1);
+
+// Reorder count RGB pixels from src into dst, dst may be the same as src
+void ReorderRGB(uint8_t *dst, const uint8_t *src, int count,
+                FPPColorOrder colorOrder);
+
+// Compare blocks of DIFF_BLOCK_SIZE bytes of cur against prev.  Sets the
+// bit in dirty for each block that differs (bits are never cleared) and
+// copies those blocks into prev.  Returns the number of changed blocks.
+#define DIFF_BLOCK_SIZE 64
+int DiffBlocks(uint8_t *prev, const uint8_t *cur, int blocks, uint64_t *dirty);
+
+const char *GetOutputKernelsName(void);
+
+
+// One implementation of the kernels.  order is the index of the source
+// channel for each of the three output channels.
+typedef struct {
+    const char *name;
+    void (*applyValueMap)(uint8_t *data, int count, const uint8_t *table);
+    void (*gatherValueMap)(uint8_t *dst, const uint8_t *src, const int *map,
+                           int count, const uint8_t *table);
+    void (*reorderRGB)(uint8_t *dst, const uint8_t *src, int count,
+                       const uint8_t *order);
+    int  (*diffBlocks)(uint8_t *prev, const uint8_t *cur, int blocks,
+                       uint64_t *dirty);
+} OutputKernels;
+
+// NULL if fppd was not built with NEON support
+const OutputKernels *GetNEONOutputKernels(void);
+
+// Fills in every implementation this CPU can run, slowest (plain C) first,
+// and returns how many there are.  Used by kerneltest to check them all.
+#define MAX_OUTPUT_KERNELS 4
+int GetSupportedOutputKernels(const OutputKernels *kernels[MAX_OUTPUT_KERNELS]);
+
+#endif /* _OUTPUTKERNELS_H */
@@ -0,0 +1,169 @@
+/*
+ *   NEON channel data kernels for Falcon Player (FPP)
+ *
+ *   Copyright (C) 2013-2018 the Falcon Player Developers
+ *      Initial development by:
+ *      - David Pitts (dpitts)
+ *      - Tony Mace (MyKroFt)
+ *      - Mathew Mrosko (Materdaddy)
+ *      - Chris Pinkham (CaptainMurdoch)
+ *      For additional credits and developers, see credits.php.
+ *
+ *   The Falcon Player (FPP) is free software; you can redistribute it
+ *   and/or modify it under the terms of the GNU General Public License
+ *   as published by the Free Software Foundation; either version 2 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file is built with NEON enabled on 32-bit ARM, so nothing in here
+// may be called before OutputKernels.cpp has checked the CPU has NEON.
+
+#include <stddef.h>
+
+#include "OutputKernels.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+#include <arm_neon.h>
+
+static void ApplyValueMapNEON(uint8_t *data, int count, const uint8_t *table)
+{
+    int x = 0;
+
+#if defined(__aarch64__)
+    // 64 byte tables, tbx leaves lanes alone when the index is out of range
+    uint8x16x4_t t[4];
+    for (int k = 0; k < 4; k++) {
+        for (int i = 0; i < 4; i++) {
+            t[k].val[i] = vld1q_u8(table + (k * 64) + (i * 16));
+        }
+    }
+    const uint8x16_t step = vdupq_n_u8(64);
+
+    for (; (x + 16) <= count; x += 16) {
+        uint8x16_t v = vld1q_u8(data + x);
+        uint8x16_t r = vqtbl4q_u8(t[0], v);
+        for (int k = 1; k < 4; k++) {
+            v = vsubq_u8(v, step);
+            r = vqtbx4q_u8(r, t[k], v);
+        }
+        vst1q_u8(data + x, r);
+    }
+#else
+    // 32 byte tables on ARMv7
+    uint8x8x4_t t[8];
+    for (int k = 0; k < 8; k++) {
+        for (int i = 0; i < 4; i++) {
+            t[k].val[i] = vld1_u8(table + (k * 32) + (i * 8));
+        }
+    }
+    const uint8x8_t step = vdup_n_u8(32);
+
+    for (; (x + 8) <= count; x += 8) {
+        uint8x8_t v = vld1_u8(data + x);
+        uint8x8_t r = vtbl4_u8(t[0], v);
+        for (int k = 1; k < 8; k++) {
+            v = vsub_u8(v, step);
+            r = vtbx4_u8(r, t[k], v);
+        }
+        vst1_u8(data + x, r);
+    }
+#endif
+
+    for (; x < count; x++) {
+        data[x] = table[data[x]];
+    }
+}
+
+#define GATHER_BLOCK_SIZE 1024
+
+static void GatherValueMapNEON(uint8_t *dst, const uint8_t *src, const int *map,
+                               int count, const uint8_t *table)
+{
+    for (int x = 0; x < count; x += GATHER_BLOCK_SIZE) {
+        int len = count - x;
+        if (len > GATHER_BLOCK_SIZE) {
+            len = GATHER_BLOCK_SIZE;
+        }
+        for (int i = 0; i < len; i++) {
+            dst[x + i] = src[map[x + i]];
+        }
+        ApplyValueMapNEON(dst + x, len, table);
+    }
+}
+
+// vld3/vst3 split and merge the color channels for us
+static void ReorderRGBNEON(uint8_t *dst, const uint8_t *src, int count,
+                           const uint8_t *order)
+{
+    int x = 0;
+    for (; (x + 16) <= count; x += 16, src += 48, dst += 48) {
+        uint8x16x3_t in = vld3q_u8(src);
+        uint8x16x3_t out;
+        out.val[0] = in.val[order[0]];
+        out.val[1] = in.val[order[1]];
+        out.val[2] = in.val[order[2]];
+        vst3q_u8(dst, out);
+    }
+
+    for (; x < count; x++, src += 3, dst += 3) {
+        uint8_t a = src[order[0]];
+        uint8_t b = src[order[1]];
+        uint8_t c = src[order[2]];
+        dst[0] = a;
+        dst[1] = b;
+        dst[2] = c;
+    }
+}
+
+static int DiffBlocksNEON(uint8_t *prev, const uint8_t *cur, int blocks,
+                          uint64_t *dirty)
+{
+    int changed = 0;
+    for (int b = 0; b < blocks; b++, prev += DIFF_BLOCK_SIZE, cur += DIFF_BLOCK_SIZE) {
+        uint8x16_t c0 = vld1q_u8(cur);
+        uint8x16_t c1 = vld1q_u8(cur + 16);
+        uint8x16_t c2 = vld1q_u8(cur + 32);
+        uint8x16_t c3 = vld1q_u8(cur + 48);
+        uint8x16_t d = vorrq_u8(
+            vorrq_u8(veorq_u8(c0, vld1q_u8(prev)), veorq_u8(c1, vld1q_u8(prev + 16))),
+            vorrq_u8(veorq_u8(c2, vld1q_u8(prev + 32)), veorq_u8(c3, vld1q_u8(prev + 48))));
+        uint64x2_t d64 = vreinterpretq_u64_u8(d);
+        if (vgetq_lane_u64(d64, 0) | vgetq_lane_u64(d64, 1)) {
+            vst1q_u8(prev, c0);
+            vst1q_u8(prev + 16, c1);
+            vst1q_u8(prev + 32, c2);
+            vst1q_u8(prev + 48, c3);
+            dirty[b / 64] |= 1ULL << (b % 64);
+            changed++;
+        }
+    }
+    return changed;
+}
+
+static const OutputKernels neonKernels = {
+    "NEON", ApplyValueMapNEON, GatherValueMapNEON, ReorderRGBNEON,
+    DiffBlocksNEON
+};
+
+const OutputKernels *GetNEONOutputKernels(void)
+{
+    return &neonKernels;
+}
+
+#else
+
+const OutputKernels *GetNEONOutputKernels(void)
+{
+    return NULL;
+}
+
+#endif
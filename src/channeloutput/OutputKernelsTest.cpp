@@ -0,0 +1,324 @@
+/*
+ *   Channel data kernel check and benchmark for Falcon Player (FPP)
+ *
+ *   Copyright (C) 2013-2018 the Falcon Player Developers
+ *      Initial development by:
+ *      - David Pitts (dpitts)
+ *      - Tony Mace (MyKroFt)
+ *      - Mathew Mrosko (Materdaddy)
+ *      - Chris Pinkham (CaptainMurdoch)
+ *      For additional credits and developers, see credits.php.
+ *
+ *   The Falcon Player (FPP) is free software; you can redistribute it
+ *   and/or modify it under the terms of the GNU General Public License
+ *   as published by the Free Software Foundation; either version 2 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "log.h"
+
+#include "OutputKernels.h"
+
+void usage(char *appname) {
+    printf("Usage: %s [OPTIONS]\n", appname);
+    printf("\n");
+    printf("  Checks every channel data kernel this CPU supports against\n");
+    printf("  plain loops and then times them.\n");
+    printf("\n");
+    printf("  Options:\n");
+    printf("   -c #              - Channels per call for the benchmark (default 65536)\n");
+    printf("   -i #              - Benchmark iterations (default 1000)\n");
+    printf("   -n                - Only run the checks, no benchmark\n");
+    printf("   -h                - This help output\n");
+}
+static int benchChannels = 65536;
+static int benchIterations = 1000;
+static bool benchmark = true;
+static int failures = 0;
+
+// every permutation of RGB, including the identity the kernels never see
+// from ReorderRGB()
+static const uint8_t orders[6][3] = {
+    { 0, 1, 2 }, { 0, 2, 1 }, { 1, 0, 2 }, { 1, 2, 0 }, { 2, 0, 1 }, { 2, 1, 0 }
+};
+
+// Short counts for the tails of the vector loops and a few around the
+// 1024 byte gather block
+static std::vector<int> checkCounts() {
+    std::vector<int> counts;
+    for (int x = 0; x <= 100; x++) {
+        counts.push_back(x);
+    }
+    int large[] = { 127, 128, 129, 1000, 1023, 1024, 1025, 2047, 2048, 2049, 4099 };
+    for (int x : large) {
+        counts.push_back(x);
+    }
+    return counts;
+}
+
+static void fillRandom(uint8_t *data, int count) {
+    for (int x = 0; x < count; x++) {
+        data[x] = rand() & 0xFF;
+    }
+}
+
+static void checkResult(const char *kernels, const char *func, int count,
+                        const char *extra, const uint8_t *expected,
+                        const uint8_t *result, int size) {
+    for (int x = 0; x < size; x++) {
+        if (expected[x] != result[x]) {
+            printf("FAIL %s %s count %d%s: byte %d is %d, expected %d\n",
+                   kernels, func, count, extra, x, result[x], expected[x]);
+            failures++;
+            return;
+        }
+    }
+}
+
+// Each buffer gets a guard area after it so writes past count are caught
+#define GUARD 64
+
+static void checkApplyValueMap(const OutputKernels *k, int count) {
+    uint8_t table[256];
+    std::vector<uint8_t> data(count + GUARD);
+    fillRandom(table, 256);
+    fillRandom(&data[0], data.size());
+
+    std::vector<uint8_t> expected(data);
+    for (int x = 0; x < count; x++) {
+        expected[x] = table[expected[x]];
+    }
+
+    k->applyValueMap(&data[0], count, table);
+    checkResult(k->name, "ApplyValueMap", count, "", &expected[0], &data[0], data.size());
+}
+
+static void checkGatherValueMap(const OutputKernels *k, int count) {
+    uint8_t table[256];
+    std::vector<uint8_t> src(count * 2 + 1);
+    std::vector<int> map(count);
+    std::vector<uint8_t> dst(count + GUARD);
+    fillRandom(table, 256);
+    fillRandom(&src[0], src.size());
+    fillRandom(&dst[0], dst.size());
+    for (int x = 0; x < count; x++) {
+        map[x] = rand() % src.size();
+    }
+
+    std::vector<uint8_t> expected(dst);
+    for (int x = 0; x < count; x++) {
+        expected[x] = table[src[map[x]]];
+    }
+
+    k->gatherValueMap(&dst[0], &src[0], count ? &map[0] : NULL, count, table);
+    checkResult(k->name, "GatherValueMap", count, "", &expected[0], &dst[0], dst.size());
+}
+
+static void checkReorderRGB(const OutputKernels *k, int count) {
+    for (int o = 0; o < 6; o++) {
+        char extra[32];
+        std::vector<uint8_t> src(count * 3 + GUARD);
+        std::vector<uint8_t> dst(count * 3 + GUARD);
+        fillRandom(&src[0], src.size());
+        fillRandom(&dst[0], dst.size());
+
+        std::vector<uint8_t> expected(dst);
+        for (int x = 0; x < count; x++) {
+            for (int c = 0; c < 3; c++) {
+                expected[x * 3 + c] = src[x * 3 + orders[o][c]];
+            }
+        }
+
+        snprintf(extra, sizeof(extra), " order %d%d%d", orders[o][0], orders[o][1], orders[o][2]);
+        k->reorderRGB(&dst[0], &src[0], count, orders[o]);
+        checkResult(k->name, "ReorderRGB", count, extra, &expected[0], &dst[0], dst.size());
+
+        // in place, the guard area after the pixels must be untouched
+        memcpy(&expected[count * 3], &src[count * 3], GUARD);
+        snprintf(extra, sizeof(extra), " order %d%d%d in place", orders[o][0], orders[o][1], orders[o][2]);
+        k->reorderRGB(&src[0], &src[0], count, orders[o]);
+        checkResult(k->name, "ReorderRGB", count, extra, &expected[0], &src[0], src.size());
+    }
+}
+
+static void checkDiffBlocks(const OutputKernels *k, int blocks) {
+    int size = blocks * DIFF_BLOCK_SIZE;
+    std::vector<uint8_t> prev(size + GUARD);
+    std::vector<uint8_t> cur(size + GUARD);
+    uint64_t dirty[2] = { 0, 0 };
+    fillRandom(&prev[0], prev.size());
+    cur = prev;
+
+    // change a random byte in about half of the blocks, first and last
+    // bytes included
+    uint64_t expectedDirty[2] = { 0, 0 };
+    int expectedChanged = 0;
+    for (int b = 0; b < blocks; b++) {
+        if (rand() & 1) {
+            int offset = (b * DIFF_BLOCK_SIZE) + (rand() % DIFF_BLOCK_SIZE);
+            if (b == 0) {
+                offset = 0;
+            } else if (b == (blocks - 1)) {
+                offset = size - 1;
+            }
+            cur[offset]++;
+            expectedDirty[b / 64] |= 1ULL << (b % 64);
+            expectedChanged++;
+        }
+    }
+    std::vector<uint8_t> expected(cur);
+    memcpy(&expected[size], &prev[size], GUARD);
+
+    int changed = k->diffBlocks(&prev[0], &cur[0], blocks, dirty);
+    checkResult(k->name, "DiffBlocks", blocks, " blocks", &expected[0], &prev[0], prev.size());
+    if ((changed != expectedChanged) ||
+        (dirty[0] != expectedDirty[0]) || (dirty[1] != expectedDirty[1])) {
+        printf("FAIL %s DiffBlocks %d blocks: %d changed, expected %d\n",
+               k->name, blocks, changed, expectedChanged);
+        failures++;
+    }
+}
+
+static double elapsedSeconds(const std::chrono::steady_clock::time_point &start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void printTime(const OutputKernels *k, const char *func,
+                      const std::chrono::steady_clock::time_point &start) {
+    double t = elapsedSeconds(start);
+    printf("%-8s %-16s %12.2f %12.1f\n", k->name, func,
+           t * 1000000.0 / benchIterations,
+           (double)benchChannels * benchIterations / t / 1000000.0);
+}
+
+// Functions a set shares with the C set are only timed for the C set,
+// timing them again would just show noise
+static void runBenchmark(const OutputKernels *k, const OutputKernels *c) {
+    int pixels = benchChannels / 3;
+    int blocks = benchChannels / DIFF_BLOCK_SIZE;
+    uint8_t table[256];
+    std::vector<uint8_t> src(benchChannels);
+    std::vector<uint8_t> dst(benchChannels);
+    std::vector<uint8_t> prev(benchChannels);
+    std::vector<int> map(benchChannels);
+    std::vector<uint64_t> dirty(blocks / 64 + 1);
+    fillRandom(table, 256);
+    fillRandom(&src[0], benchChannels);
+    for (int x = 0; x < benchChannels; x++) {
+        map[x] = rand() % benchChannels;
+    }
+
+    std::chrono::steady_clock::time_point start;
+    if ((k == c) || (k->applyValueMap != c->applyValueMap)) {
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < benchIterations; i++) {
+            k->applyValueMap(&src[0], benchChannels, table);
+        }
+        printTime(k, "ApplyValueMap", start);
+    }
+
+    if ((k == c) || (k->gatherValueMap != c->gatherValueMap)) {
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < benchIterations; i++) {
+            k->gatherValueMap(&dst[0], &src[0], &map[0], benchChannels, table);
+        }
+        printTime(k, "GatherValueMap", start);
+    }
+
+    if ((k == c) || (k->reorderRGB != c->reorderRGB)) {
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < benchIterations; i++) {
+            k->reorderRGB(&dst[0], &src[0], pixels, orders[2]);
+        }
+        printTime(k, "ReorderRGB", start);
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < benchIterations; i++) {
+            k->reorderRGB(&src[0], &src[0], pixels, orders[2]);
+        }
+        printTime(k, "ReorderRGB (in)", start);
+    }
+
+    if ((k == c) || (k->diffBlocks != c->diffBlocks)) {
+        // alternate between two frames so every block is copied
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < benchIterations; i++) {
+            k->diffBlocks(&prev[0], (i & 1) ? &src[0] : &dst[0], blocks, &dirty[0]);
+        }
+        printTime(k, "DiffBlocks", start);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int c;
+    while ((c = getopt(argc, argv, "c:i:nh")) != -1) {
+        switch (c) {
+            case 'c':
+                benchChannels = strtol(optarg, NULL, 10);
+                break;
+            case 'i':
+                benchIterations = strtol(optarg, NULL, 10);
+                break;
+            case 'n':
+                benchmark = false;
+                break;
+            case 'h':
+                usage(argv[0]);
+                exit(EXIT_SUCCESS);
+            default:
+                usage(argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if ((benchChannels < DIFF_BLOCK_SIZE) || (benchIterations < 1)) {
+        usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    const OutputKernels *kernels[MAX_OUTPUT_KERNELS];
+    int kernelCount = GetSupportedOutputKernels(kernels);
+    std::vector<int> counts = checkCounts();
+
+    srand(1);
+    for (int k = 0; k < kernelCount; k++) {
+        for (int count : counts) {
+            checkApplyValueMap(kernels[k], count);
+            checkGatherValueMap(kernels[k], count);
+            checkReorderRGB(kernels[k], count);
+        }
+        // the dirty bitmap in the check holds up to 128 blocks
+        for (int blocks = 0; blocks <= 128; blocks++) {
+            checkDiffBlocks(kernels[k], blocks);
+        }
+        printf("Checked %s kernels\n", kernels[k]->name);
+    }
+    if (failures) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+
+    if (benchmark) {
+        printf("\n%d channels, %d iterations\n", benchChannels, benchIterations);
+        printf("%-8s %-16s %12s %12s\n", "Kernels", "Function", "us/call", "Mchan/s");
+        for (int k = 0; k < kernelCount; k++) {
+            runBenchmark(kernels[k], kernels[0]);
+        }
+    }
+    return 0;
+}
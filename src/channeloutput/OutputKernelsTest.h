@@ -0,0 +1,4 @@
+#ifndef _OUTPUTKERNELSTEST_H
+#define _OUTPUTKERNELSTEST_H
+
+#endif
@@ -0,0 +1,147 @@
+/*
+ *   Channel output metrics for Falcon Player (FPP)
+ *
+ *   Copyright (C) 2013-2018 the Falcon Player Developers
+ *      Initial development by:
+ *      - David Pitts (dpitts)
+ *      - Tony Mace (MyKroFt)
+ *      - Mathew Mrosko (Materdaddy)
+ *      - Chris Pinkham (CaptainMurdoch)
+ *      For additional credits and developers, see credits.php.
+ *
+ *   The Falcon Player (FPP) is free software; you can redistribute it
+ *   and/or modify it under the terms of the GNU General Public License
+ *   as published by the Free Software Foundation; either version 2 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "OutputMetrics.h"
+
+// Upper bound of each bucket in microseconds, the last bucket is everything
+// above the one before it
+static const uint32_t bucketLimits[FRAME_TIME_BUCKETS - 1] = {
+	100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000
+};
+
+static const char *stageNames[FRAME_STAGE_COUNT] = {
+	"read",
+	"effects",
+	"overlay",
+	"processors",
+	"prep",
+	"send",
+	"work",
+	"interval",
+	"overshoot",
+	"jitter",
+	"inputLatency"
+};
+
+static FrameTimeHistogram frameStages[FRAME_STAGE_COUNT];
+static std::atomic<uint64_t> lateFrames(0);
+static std::atomic<uint64_t> skippedFrames(0);
+
+FrameTimeHistogram::FrameTimeHistogram()
+{
+	Reset();
+}
+
+void FrameTimeHistogram::Record(long long us)
+{
+	if (us < 0)
+		us = 0;
+
+	int b = 0;
+	while ((b < (FRAME_TIME_BUCKETS - 1)) && (us > bucketLimits[b]))
+		b++;
+
+	m_counts[b].fetch_add(1, std::memory_order_relaxed);
+	m_samples.fetch_add(1, std::memory_order_relaxed);
+	m_totalUs.fetch_add(us, std::memory_order_relaxed);
+	m_lastUs.store(us, std::memory_order_relaxed);
+
+	uint32_t max = m_maxUs.load(std::memory_order_relaxed);
+	while ((us > max) &&
+		   !m_maxUs.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+	}
+}
+
+void FrameTimeHistogram::Reset(void)
+{
+	for (int b = 0; b < FRAME_TIME_BUCKETS; b++)
+		m_counts[b] = 0;
+
+	m_samples = 0;
+	m_totalUs = 0;
+	m_lastUs = 0;
+	m_maxUs = 0;
+}
+
+void FrameTimeHistogram::GetJSON(Json::Value &result) const
+{
+	uint64_t samples = m_samples.load(std::memory_order_relaxed);
+	Json::Value counts(Json::arrayValue);
+
+	for (int b = 0; b < FRAME_TIME_BUCKETS; b++)
+		counts.append((Json::UInt64)m_counts[b].load(std::memory_order_relaxed));
+
+	result["count"] = (Json::UInt64)samples;
+	result["lastUs"] = (uint32_t)m_lastUs.load(std::memory_order_relaxed);
+	result["maxUs"] = (uint32_t)m_maxUs.load(std::memory_order_relaxed);
+	result["avgUs"] = samples ? (Json::UInt64)(m_totalUs.load(std::memory_order_relaxed) / samples) : 0;
+	result["buckets"] = counts;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void RecordFrameStage(FrameStage stage, long long us)
+{
+	frameStages[stage].Record(us);
+}
+
+void CountLateFrame(void)
+{
+	lateFrames.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CountSkippedFrames(int count)
+{
+	if (count > 0)
+		skippedFrames.fetch_add(count, std::memory_order_relaxed);
+}
+
+void ResetOutputMetrics(void)
+{
+	for (int i = 0; i < FRAME_STAGE_COUNT; i++)
+		frameStages[i].Reset();
+
+	lateFrames = 0;
+	skippedFrames = 0;
+}
+
+void GetOutputMetrics(Json::Value &result)
+{
+	Json::Value limits(Json::arrayValue);
+	for (int b = 0; b < (FRAME_TIME_BUCKETS - 1); b++)
+		limits.append(bucketLimits[b]);
+
+	Json::Value stages;
+	for (int i = 0; i < FRAME_STAGE_COUNT; i++) {
+		Json::Value stage;
+		frameStages[i].GetJSON(stage);
+		stages[stageNames[i]] = stage;
+	}
+
+	result["bucketLimitsUs"] = limits;
+	result["stages"] = stages;
+	result["lateFrames"] = (Json::UInt64)lateFrames.load(std::memory_order_relaxed);
+	result["skippedFrames"] = (Json::UInt64)skippedFrames.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,78 @@
+/*
+ *   Channel output metrics for Falcon Player (FPP)
+ *
+ *   Copyright (C) 2013-2018 the Falcon Player Developers
+ *      Initial development by:
+ *      - David Pitts (dpitts)
+ *      - Tony Mace (MyKroFt)
+ *      - Mathew Mrosko (Materdaddy)
+ *      - Chris Pinkham (CaptainMurdoch)
+ *      For additional credits and developers, see credits.php.
+ *
+ *   The Falcon Player (FPP) is free software; you can redistribute it
+ *   and/or modify it under the terms of the GNU General Public License
+ *   as published by the Free Software Foundation; either version 2 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _OUTPUTMETRICS_H
+#define _OUTPUTMETRICS_H
+
+#include <atomic>
+#include <stdint.h>
+
+#include <jsoncpp/json/json.h>
+
+#define FRAME_TIME_BUCKETS 12
+
+// Counts of durations in fixed microsecond buckets.  Recording is a few
+// relaxed atomic adds so it is cheap enough to leave on all the time and
+// safe to call from any thread.
+class FrameTimeHistogram {
+  public:
+	FrameTimeHistogram();
+
+	void Record(long long us);
+	void Reset(void);
+	void GetJSON(Json::Value &result) const;
+
+  private:
+	std::atomic<uint64_t> m_counts[FRAME_TIME_BUCKETS];
+	std::atomic<uint64_t> m_samples;
+	std::atomic<uint64_t> m_totalUs;
+	std::atomic<uint32_t> m_lastUs;
+	std::atomic<uint32_t> m_maxUs;
+};
+
+// Stages of a channel output frame
+typedef enum {
+	FRAME_STAGE_READ = 0,     // waiting for and reading the sequence frame
+	FRAME_STAGE_EFFECTS,      // overlaying running effects
+	FRAME_STAGE_OVERLAY,      // video, memory map and test overlays
+	FRAME_STAGE_PROCESSORS,   // output processors
+	FRAME_STAGE_PREP,         // PrepData for all the outputs
+	FRAME_STAGE_SEND,         // SendData for all the outputs
+	FRAME_STAGE_WORK,         // everything done for the frame
+	FRAME_STAGE_INTERVAL,     // start of one frame to the start of the next
+	FRAME_STAGE_OVERSHOOT,    // time slept past the frame deadline
+	FRAME_STAGE_JITTER,       // frame spacing error against the schedule
+	FRAME_STAGE_INPUT_LATENCY, // bridge sync/push packet to sending the frame
+	FRAME_STAGE_COUNT
+} FrameStage;
+
+void RecordFrameStage(FrameStage stage, long long us);
+void CountLateFrame(void);
+void CountSkippedFrames(int count);
+
+void ResetOutputMetrics(void);
+void GetOutputMetrics(Json::Value &result);
+
+#endif /* _OUTPUTMETRICS_H */
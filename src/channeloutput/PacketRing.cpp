@@ -0,0 +1,284 @@
+/*
+ *   Raw packet transmit ring for Falcon Player (FPP)
+ *
+ *   Copyright (C) 2013-2018 the Falcon Player Developers
+ *      Initial development by:
+ *      - David Pitts (dpitts)
+ *      - Tony Mace (MyKroFt)
+ *      - Mathew Mrosko (Materdaddy)
+ *      - Chris Pinkham (CaptainMurdoch)
+ *      For additional credits and developers, see credits.php.
+ *
+ *   The Falcon Player (FPP) is free software; you can redistribute it
+ *   and/or modify it under the terms of the GNU General Public License
+ *   as published by the Free Software Foundation; either version 2 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "OutputKernels.h"
+#include "PacketRing.h"
+
+// Frame data starts after the aligned tpacket2_hdr, the sockaddr_ll that
+// follows it on receive isn't used for transmit
+#define PACKET_RING_DATA_OFFSET (TPACKET2_HDRLEN - sizeof(struct sockaddr_ll))
+
+#define PACKET_RING_MAX_BLOCK_SIZE (64 * 1024)
+
+PacketRing::PacketRing()
+  : m_fd(-1),
+	m_count(0),
+	m_ring(NULL),
+	m_ringSize(0)
+{
+	memset(&m_addr, 0, sizeof(m_addr));
+}
+
+PacketRing::~PacketRing()
+{
+	Close();
+}
+
+int PacketRing::Init(int fd, const struct sockaddr_ll &addr, int count,
+	int maxSize, bool useRing)
+{
+	Close();
+
+	m_fd = fd;
+	m_addr = addr;
+	m_count = count;
+	m_packets.resize(count);
+	m_lengths.assign(count, maxSize);
+
+	int ring = useRing ? InitRing(maxSize) : 0;
+	if (ring > 0)
+		return 1;
+	if (ring < 0)
+		return 0;
+
+	m_buffer.assign((size_t)count * maxSize, 0);
+	m_msgs.resize(count);
+	m_iovs.resize(count);
+	for (int i = 0; i < count; i++) {
+		m_packets[i] = &m_buffer[(size_t)i * maxSize];
+
+		m_iovs[i].iov_base = m_packets[i];
+		memset(&m_msgs[i], 0, sizeof(struct mmsghdr));
+		m_msgs[i].msg_hdr.msg_name = &m_addr;
+		m_msgs[i].msg_hdr.msg_namelen = sizeof(m_addr);
+		m_msgs[i].msg_hdr.msg_iov = &m_iovs[i];
+		m_msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	return 1;
+}
+
+int PacketRing::InitRing(int maxSize)
+{
+	int version = TPACKET_V2;
+	if (setsockopt(m_fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+		LogWarn(VB_CHANNELOUT, "Unable to set TPACKET_V2, using sendmmsg(): %s\n",
+			strerror(errno));
+		return 0;
+	}
+
+	// skip a packet the kernel rejects rather than stopping the ring on it
+	int loss = 1;
+	setsockopt(m_fd, SOL_PACKET, PACKET_LOSS, &loss, sizeof(loss));
+
+	// The kernel walks the ring in order and carries on from where the last
+	// send() stopped, so the ring has to be exactly one slot per packet for
+	// every frame to start at the first packet.  Frames can't span blocks
+	// and every block holds the same number of frames, so use a divisor of
+	// the packet count as the frames per block and pad the frame size out
+	// to fill the block.
+	int pageSize = sysconf(_SC_PAGESIZE);
+	int minFrameSize = TPACKET_ALIGN(PACKET_RING_DATA_OFFSET + maxSize);
+	int framesPerBlock = 1;
+	for (int f = 2; (f <= m_count) && ((f * minFrameSize) <= PACKET_RING_MAX_BLOCK_SIZE); f++) {
+		if ((m_count % f) == 0)
+			framesPerBlock = f;
+	}
+
+	struct tpacket_req req;
+	req.tp_block_size = ((framesPerBlock * minFrameSize) + pageSize - 1) / pageSize * pageSize;
+	req.tp_block_nr = m_count / framesPerBlock;
+	req.tp_frame_size = (req.tp_block_size / framesPerBlock) & ~(TPACKET_ALIGNMENT - 1);
+	req.tp_frame_nr = m_count;
+
+	if ((req.tp_block_size / req.tp_frame_size) != framesPerBlock) {
+		LogWarn(VB_CHANNELOUT, "Unable to size PACKET_TX_RING for %d packets, using sendmmsg()\n",
+			m_count);
+		return 0;
+	}
+
+	if (setsockopt(m_fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req)) < 0) {
+		LogWarn(VB_CHANNELOUT, "Unable to set up PACKET_TX_RING, using sendmmsg(): %s\n",
+			strerror(errno));
+		return 0;
+	}
+
+	m_ringSize = (size_t)req.tp_block_size * req.tp_block_nr;
+	void *ring = mmap(NULL, m_ringSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+	if (ring == MAP_FAILED) {
+		LogWarn(VB_CHANNELOUT, "Unable to map PACKET_TX_RING, using sendmmsg(): %s\n",
+			strerror(errno));
+
+		m_ringSize = 0;
+
+		// the kernel sends everything through the ring once one is set,
+		// mapped or not, so take it down again before using sendmmsg()
+		memset(&req, 0, sizeof(req));
+		if (setsockopt(m_fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req)) < 0) {
+			LogErr(VB_CHANNELOUT, "Unable to remove PACKET_TX_RING: %s\n",
+				strerror(errno));
+			return -1;
+		}
+		return 0;
+	}
+	m_ring = (unsigned char *)ring;
+
+	m_slots.resize(m_count);
+	for (int i = 0; i < m_count; i++) {
+		unsigned char *slot = m_ring
+			+ ((size_t)(i / framesPerBlock) * req.tp_block_size)
+			+ ((i % framesPerBlock) * req.tp_frame_size);
+		m_slots[i] = (struct tpacket2_hdr *)slot;
+		m_packets[i] = slot + PACKET_RING_DATA_OFFSET;
+	}
+
+	LogDebug(VB_CHANNELOUT, "Using PACKET_TX_RING with %d %d byte frames for %d packets\n",
+		req.tp_frame_nr, req.tp_frame_size, m_count);
+
+	return 1;
+}
+
+void PacketRing::Close(void)
+{
+	if (m_ring) {
+		munmap(m_ring, m_ringSize);
+		m_ring = NULL;
+	}
+	m_ringSize = 0;
+	m_slots.clear();
+	m_packets.clear();
+	m_lengths.clear();
+	m_buffer.clear();
+	m_msgs.clear();
+	m_iovs.clear();
+	m_count = 0;
+}
+
+bool PacketRing::Ready(void)
+{
+	if (!m_ring)
+		return true;
+
+	for (int i = 0; i < m_count; i++) {
+		unsigned int status = __atomic_load_n(&m_slots[i]->tp_status, __ATOMIC_ACQUIRE);
+		if (status == TP_STATUS_AVAILABLE)
+			continue;
+
+		if (status & TP_STATUS_WRONG_FORMAT) {
+			// the kernel rejected it, the slot is ours again
+			LogExcess(VB_CHANNELOUT, "PACKET_TX_RING rejected packet %d\n", i);
+			__atomic_store_n(&m_slots[i]->tp_status, TP_STATUS_AVAILABLE, __ATOMIC_RELAXED);
+			continue;
+		}
+
+		return false;
+	}
+
+	return true;
+}
+
+int PacketRing::Send(void)
+{
+	if (!m_count)
+		return 0;
+
+	if (m_ring) {
+		for (int i = 0; i < m_count; i++) {
+			m_slots[i]->tp_len = m_lengths[i];
+			__atomic_store_n(&m_slots[i]->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+		}
+
+		if (!Flush())
+			return 0;
+
+		return m_count;
+	}
+
+	for (int i = 0; i < m_count; i++)
+		m_iovs[i].iov_len = m_lengths[i];
+
+	int sent = 0;
+	while (sent < m_count) {
+		int result = sendmmsg(m_fd, &m_msgs[sent], m_count - sent, 0);
+		if (result <= 0) {
+			LogErr(VB_CHANNELOUT, "Error sending raw packets: %s\n", strerror(errno));
+			break;
+		}
+		sent += result;
+	}
+
+	return sent;
+}
+
+int PacketRing::Flush(void)
+{
+	if (!m_ring)
+		return 1;
+
+	// blocks until the kernel has sent everything requested in the ring
+	if (sendto(m_fd, NULL, 0, 0, (struct sockaddr *)&m_addr, sizeof(m_addr)) < 0) {
+		LogErr(VB_CHANNELOUT, "Error sending PACKET_TX_RING: %s\n", strerror(errno));
+		return 0;
+	}
+
+	return 1;
+}
+
+void PacketRing::AddSegments(std::vector<PacketRingSegment> &segments,
+	int offset, const int *map, int count, int firstPacket, int headerSize,
+	int dataSize)
+{
+	while (count > 0) {
+		PacketRingSegment seg;
+		int packetOffset = offset % dataSize;
+
+		seg.packet = firstPacket + (offset / dataSize);
+		seg.offset = headerSize + packetOffset;
+		seg.map = map;
+		seg.count = dataSize - packetOffset;
+		if (seg.count > count)
+			seg.count = count;
+
+		segments.push_back(seg);
+
+		offset += seg.count;
+		map += seg.count;
+		count -= seg.count;
+	}
+}
+
+void PacketRing::Gather(const std::vector<PacketRingSegment> &segments,
+	const unsigned char *channelData, const uint8_t *table)
+{
+	for (auto &seg : segments)
+		GatherValueMap(m_packets[seg.packet] + seg.offset, channelData,
+			seg.map, seg.count, table);
+}
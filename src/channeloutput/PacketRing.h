@@ -0,0 +1,110 @@
+/*
+ *   Raw packet transmit ring for Falcon Player (FPP)
+ *
+ *   Copyright (C) 2013-2018 the Falcon Player Developers
+ *      Initial development by:
+ *      - David Pitts (dpitts)
+ *      - Tony Mace (MyKroFt)
+ *      - Mathew Mrosko (Materdaddy)
+ *      - Chris Pinkham (CaptainMurdoch)
+ *      For additional credits and developers, see credits.php.
+ *
+ *   The Falcon Player (FPP) is free software; you can redistribute it
+ *   and/or modify it under the terms of the GNU General Public License
+ *   as published by the Free Software Foundation; either version 2 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _PACKETRING_H
+#define _PACKETRING_H
+
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// A run of pixel map entries gathered into one packet
+typedef struct {
+	int        packet;
+	int        offset;
+	const int *map;
+	int        count;
+} PacketRingSegment;
+
+/*
+ * A fixed set of raw ethernet packets sent every frame.  The packets are
+ * laid out once (headers and all) and the output writes its channel data
+ * straight into them before calling Send().  With a PACKET_TX_RING the
+ * packets live in the ring shared with the kernel and the whole frame is
+ * sent with one send() and no copies.  If the ring can't be set up the
+ * packets are kept in memory and sent with sendmmsg().
+ */
+class PacketRing {
+  public:
+	PacketRing();
+	~PacketRing();
+
+	// fd must be an AF_PACKET socket, packets are sent to addr
+	int  Init(int fd, const struct sockaddr_ll &addr, int count, int maxSize,
+	          bool useRing = true);
+	void Close(void);
+
+	unsigned char *Packet(int index) { return m_packets[index]; }
+	void  SetLength(int index, int len) { m_lengths[index] = len; }
+
+	// True once the last frame has left and the packets can be written
+	bool  Ready(void);
+
+	// Returns the number of packets sent
+	int   Send(void);
+
+	// Retry anything left in the ring by a failed Send()
+	int   Flush(void);
+
+	bool  UsingRing(void) { return m_ring != NULL; }
+
+	// Split count bytes at offset in a frame carried dataSize bytes at a
+	// time by packets starting at firstPacket, after headerSize bytes of
+	// header in each packet
+	static void AddSegments(std::vector<PacketRingSegment> &segments,
+	                        int offset, const int *map, int count,
+	                        int firstPacket, int headerSize, int dataSize);
+
+	// GatherValueMap() the channel data into the packets
+	void  Gather(const std::vector<PacketRingSegment> &segments,
+	             const unsigned char *channelData, const uint8_t *table);
+
+  private:
+	// 1 using the ring, 0 to fall back to sendmmsg(), -1 if the socket
+	// can't be used at all
+	int   InitRing(int maxSize);
+
+	int                          m_fd;
+	struct sockaddr_ll           m_addr;
+	int                          m_count;
+
+	std::vector<unsigned char *> m_packets;
+	std::vector<int>             m_lengths;
+
+	// PACKET_TX_RING
+	unsigned char               *m_ring;
+	size_t                       m_ringSize;
+	std::vector<struct tpacket2_hdr *> m_slots;
+
+	// sendmmsg() fallback
+	std::vector<unsigned char>   m_buffer;
+	std::vector<struct mmsghdr>  m_msgs;
+	std::vector<struct iovec>    m_iovs;
+};
+
+#endif /* _PACKETRING_H */
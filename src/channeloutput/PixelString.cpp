@@ -28,6 +28,7 @@
 
 #include "common.h"
 #include "log.h"
+#include "OutputKernels.h"
 #include "PixelString.h"
 #include "Sequence.h" // for FPPD_MAX_CHANNELS
 
@@ -177,6 +178,26 @@ int PixelString::Init(Json::Value config)
 	return 1;
 }
 
+/*
+ *
+ */
+void PixelString::GatherChannels(uint8_t *out, const unsigned char *channelData,
+	int outStride) const
+{
+	int offset = 0;
+
+	// Each virtual string has its own brightness map
+	for (int i = 0; i < m_virtualStrings.size(); i++)
+	{
+		const VirtualString &vs = m_virtualStrings[i];
+		int channels = (vs.nullNodes * 3) + (vs.pixelCount * vs.channelsPerNode());
+
+		GatherValueMap(out + (offset * outStride), channelData,
+			m_outputMap.data() + offset, channels, vs.brightnessMap, outStride);
+
+		offset += channels;
+	}
+}
 
 void PixelString::SetupMap(int vsOffset, VirtualString vs)
 {
@@ -63,6 +63,10 @@ class PixelString {
 	int  Init(Json::Value config);
 	void DumpConfig(void);
 
+	// out[x * outStride] = brightness/gamma adjusted value of output channel x
+	void GatherChannels(uint8_t *out, const unsigned char *channelData,
+		int outStride = 1) const;
+
 	int               m_portNumber;
 	int               m_channelOffset;
 	int               m_inputChannels;
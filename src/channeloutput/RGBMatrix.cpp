@@ -29,6 +29,7 @@
 
 #include "common.h"
 #include "log.h"
+#include "OutputKernels.h"
 #include "RGBMatrix.h"
 #include "settings.h"
 
@@ -86,6 +87,8 @@ int RGBMatrixOutput::Init(Json::Value config)
 	if (!m_panelHeight)
 		m_panelHeight = 16;
 
+	m_rowData.resize(m_panelWidth * 3);
+
 	m_invertedData = config["invertedData"].asInt();
 	m_colorOrder = config["colorOrder"].asString();
 
@@ -272,9 +275,7 @@ void RGBMatrixOutput::PrepData(unsigned char *channelData)
               channelData);
 	m_matrix->OverlaySubMatrices(channelData);
     
-    unsigned char r;
-    unsigned char g;
-    unsigned char b;
+    uint8_t *row = m_rowData.data();
 
     channelData += m_startChannel;
 
@@ -290,13 +291,15 @@ void RGBMatrixOutput::PrepData(unsigned char *channelData)
             for (int y = 0; y < m_panelHeight; y++)
             {
                 int px = chain * m_panelWidth;
+
+                GatherValueMap(row, channelData,
+                    &m_panelMatrix->m_panels[panel].pixelMap[y * m_panelWidth * 3],
+                    m_panelWidth * 3, m_gammaCurve);
+
                 for (int x = 0; x < m_panelWidth; x++)
                 {
-                    r = m_gammaCurve[channelData[m_panelMatrix->m_panels[panel].pixelMap[(y * m_panelWidth + x) * 3]]];
-                    g = m_gammaCurve[channelData[m_panelMatrix->m_panels[panel].pixelMap[(y * m_panelWidth + x) * 3 + 1]]];
-                    b = m_gammaCurve[channelData[m_panelMatrix->m_panels[panel].pixelMap[(y * m_panelWidth + x) * 3 + 2]]];
-                    
-                    m_canvas->SetPixel(px, y + (output * m_panelHeight), r, g, b);
+                    m_canvas->SetPixel(px, y + (output * m_panelHeight),
+                        row[x * 3], row[x * 3 + 1], row[x * 3 + 2]);
                     
                     px++;
                 }
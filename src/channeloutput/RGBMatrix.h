@@ -27,6 +27,7 @@
 #define _RGBMATRIX_H
 
 #include <string>
+#include <vector>
 
 #include "Matrix.h"
 #include "PanelMatrix.h"
@@ -77,6 +78,7 @@ class RGBMatrixOutput : public ChannelOutputBase {
 	PanelMatrix *m_panelMatrix;
     
     uint8_t      m_gammaCurve[256];
+    std::vector<uint8_t> m_rowData;
 };
 
 #endif /* _RGBMATRIX_H */
@@ -27,25 +27,34 @@
 
 #include <errno.h>
 #include <string.h>
-#include <sys/time.h>
 #include <unistd.h>
 
 #include "ThreadedChannelOutputBase.h"
 #include "common.h"
 #include "log.h"
+#include "Threads.h"
+
+// Set in m_latestSlot when the slot holds a frame the thread has not sent
+#define SLOT_NEW_FRAME 0x4
+#define SLOT_INDEX     0x3
 
 ThreadedChannelOutputBase::ThreadedChannelOutputBase(unsigned int startChannel,
 	 unsigned int channelCount)
   : ChannelOutputBase(startChannel, channelCount),
 	m_threadIsRunning(0),
 	m_runThread(0),
-	m_dataWaiting(0),
 	m_useDoubleBuffer(0),
+	m_skipUnchangedFrames(0),
 	m_threadID(0),
-	m_inBuf(NULL),
-	m_outBuf(NULL)
+	m_latestSlot(2),
+	m_writeSlot(0),
+	m_readSlot(1),
+	m_threadWaiting(0),
+	m_framesDropped(0),
+	m_framesUnchanged(0)
 {
-	pthread_mutex_init(&m_bufLock, NULL);
+	m_slots[0] = m_slots[1] = m_slots[2] = NULL;
+
 	pthread_mutex_init(&m_sendLock, NULL);
 	pthread_cond_init(&m_sendCond, NULL);
 }
@@ -53,7 +62,6 @@ ThreadedChannelOutputBase::ThreadedChannelOutputBase(unsigned int startChannel,
 ThreadedChannelOutputBase::~ThreadedChannelOutputBase()
 {
     pthread_cond_destroy(&m_sendCond);
-	pthread_mutex_destroy(&m_bufLock);
 	pthread_mutex_destroy(&m_sendLock);
 }
 
@@ -61,9 +69,9 @@ int ThreadedChannelOutputBase::Init(void)
 {
 	LogDebug(VB_CHANNELOUT, "ThreadedChannelOutputBase::Init()\n");
 
-	if (m_useDoubleBuffer){
-	 	m_inBuf = new unsigned char[m_channelCount];
-		m_outBuf = new unsigned char[m_channelCount];
+	if (m_useDoubleBuffer) {
+		for (int i = 0; i < 3; i++)
+			m_slots[i] = new unsigned char[m_channelCount];
 	}
     StartOutputThread();
 	DumpConfig();
@@ -90,8 +98,10 @@ int ThreadedChannelOutputBase::Close(void)
     StopOutputThread();
 
 	if (m_useDoubleBuffer) {
-        delete [] m_inBuf;
-		delete [] m_outBuf;
+		for (int i = 0; i < 3; i++) {
+			delete [] m_slots[i];
+			m_slots[i] = NULL;
+		}
 	}
 
 	return ChannelOutputBase::Close();
@@ -102,41 +112,67 @@ int ThreadedChannelOutputBase::SendData(unsigned char *channelData)
 {
 	LogExcess(VB_CHANNELOUT, "ThreadedChannelOutputBase::SendData(%p)\n", channelData);
 
-    if (m_useDoubleBuffer) {
-        pthread_mutex_lock(&m_bufLock);
-        memcpy(m_inBuf, channelData, m_channelCount);
-        m_dataWaiting = 1;
-        pthread_mutex_unlock(&m_bufLock);
-    } else {
-        m_outBuf = channelData;
-        m_dataWaiting = 1;
-    }
-    
-    pthread_cond_signal(&m_sendCond);
+	if (m_skipUnchangedFrames && !ChannelsChanged(0, m_channelCount)) {
+		m_framesUnchanged.fetch_add(1, std::memory_order_relaxed);
+		return m_channelCount;
+	}
+
+	// Fill our slot and swap it with the latest one.  If the thread had
+	// not picked up the previous frame yet then that frame is dropped.
+	if (m_useDoubleBuffer)
+		memcpy(m_slots[m_writeSlot], channelData, m_channelCount);
+	else
+		m_slots[m_writeSlot] = channelData;
+
+	int prev = m_latestSlot.exchange(m_writeSlot | SLOT_NEW_FRAME);
+	m_writeSlot = prev & SLOT_INDEX;
+
+	if (prev & SLOT_NEW_FRAME)
+		m_framesDropped.fetch_add(1, std::memory_order_relaxed);
+
+	// Only take the lock if the thread is (or is about to be) asleep.  It
+	// sets m_threadWaiting before checking for a frame so one of us always
+	// sees the other.
+	if (m_threadWaiting) {
+		pthread_mutex_lock(&m_sendLock);
+		pthread_cond_signal(&m_sendCond);
+		pthread_mutex_unlock(&m_sendLock);
+	}
+
+	return m_channelCount;
+}
+
+int ThreadedChannelOutputBase::DataWaiting(void)
+{
+	return (m_latestSlot & SLOT_NEW_FRAME) ? 1 : 0;
 }
 
 int ThreadedChannelOutputBase::SendOutputBuffer(void)
 {
 	LogExcess(VB_CHANNELOUT, "ChannelOutputBase::SendOutputBuffer()\n");
 
-	if (m_useDoubleBuffer) {
-		pthread_mutex_lock(&m_bufLock);
-		memcpy(m_outBuf, m_inBuf, m_channelCount);
-		m_dataWaiting = 0;
-		pthread_mutex_unlock(&m_bufLock);
-	} else {
-		m_dataWaiting = 0;
-	}
+	if (!DataWaiting())
+		return 0;
+
+	m_readSlot = m_latestSlot.exchange(m_readSlot) & SLOT_INDEX;
 
-	RawSendData(m_outBuf);
+	return RawSendData(m_slots[m_readSlot]);
+}
+
+void ThreadedChannelOutputBase::GetOutputStats(Json::Value &result)
+{
+	result["framesDropped"] = m_framesDropped.load(std::memory_order_relaxed);
+	if (m_skipUnchangedFrames)
+		result["framesUnchanged"] = m_framesUnchanged.load(std::memory_order_relaxed);
 }
 
 void ThreadedChannelOutputBase::DumpConfig(void)
 {
     ChannelOutputBase::DumpConfig();
-	LogDebug(VB_CHANNELOUT, "    Thread Running   : %u\n", m_threadIsRunning);
-	LogDebug(VB_CHANNELOUT, "    Run Thread       : %u\n", m_runThread);
-	LogDebug(VB_CHANNELOUT, "    Data Waiting     : %u\n", m_dataWaiting);
+	LogDebug(VB_CHANNELOUT, "    Thread Running   : %u\n", (unsigned int)m_threadIsRunning);
+	LogDebug(VB_CHANNELOUT, "    Run Thread       : %u\n", (unsigned int)m_runThread);
+	LogDebug(VB_CHANNELOUT, "    Data Waiting     : %d\n", DataWaiting());
+	LogDebug(VB_CHANNELOUT, "    Frames Dropped   : %u\n", (unsigned int)m_framesDropped);
 }
 
 /*
@@ -149,6 +185,8 @@ void *RunChannelOutputBaseThread(void *data)
 	ThreadedChannelOutputBase *output = reinterpret_cast<ThreadedChannelOutputBase*>(data);
 
 	output->OutputThread();
+
+	return NULL;
 }
 
 int ThreadedChannelOutputBase::StartOutputThread(void)
@@ -187,27 +225,13 @@ int ThreadedChannelOutputBase::StopOutputThread(void)
 	if (!m_threadID)
 		return -1;
 
+	pthread_mutex_lock(&m_sendLock);
 	m_runThread = 0;
-
 	pthread_cond_signal(&m_sendCond);
-
-	int loops = 0;
-	// Wait up to 110ms for data to be sent
-	while ((m_dataWaiting) &&
-	       (m_threadIsRunning) &&
-	       (loops++ < 11))
-		usleep(10000);
-
-	pthread_mutex_lock(&m_bufLock);
-
-	if (!m_threadID) {
-		pthread_mutex_unlock(&m_bufLock);
-		return -1;
-	}
+	pthread_mutex_unlock(&m_sendLock);
 
 	pthread_join(m_threadID, NULL);
 	m_threadID = 0;
-	pthread_mutex_unlock(&m_bufLock);
 
 	return 0;
 }
@@ -216,67 +240,31 @@ void ThreadedChannelOutputBase::OutputThread(void)
 {
 	LogDebug(VB_CHANNELOUT, "ThreadedChannelOutputBase::OutputThread()\n");
 
-	long long wakeTime = GetTime();
-	struct timeval  tv;
-	struct timespec ts;
+	std::string name = "fpp-" + m_outputType;
+	SetThreadRole(THREAD_ROLE_OUTPUT_DEVICE, name.c_str());
 
 	m_threadIsRunning = 1;
 	LogDebug(VB_CHANNELOUT, "ThreadedChannelOutputBase thread started\n");
 
 	while (m_runThread) {
-		// Wait for more data
-		pthread_mutex_lock(&m_sendLock);
-		LogExcess(VB_CHANNELOUT, "ThreadedChannelOutputBase thread: sent: %lld, elapsed: %lld\n",
-			GetTime(), GetTime() - wakeTime);
-
-		if (m_useDoubleBuffer)
-			pthread_mutex_lock(&m_bufLock);
-
-		if (m_dataWaiting) {
-			if (m_useDoubleBuffer)
-				pthread_mutex_unlock(&m_bufLock);
-
-			gettimeofday(&tv, NULL);
-			ts.tv_sec = tv.tv_sec;
-			ts.tv_nsec = (tv.tv_usec + 200000) * 1000;
-
-			if (ts.tv_nsec >= 1000000000)
-			{
-				ts.tv_sec  += 1;
-				ts.tv_nsec -= 1000000000;
-			}
-
-			pthread_cond_timedwait(&m_sendCond, &m_sendLock, &ts);
-		} else {
-			if (m_useDoubleBuffer)
-				pthread_mutex_unlock(&m_bufLock);
-
-			pthread_cond_wait(&m_sendCond, &m_sendLock);
+		if (!DataWaiting()) {
+			// Wait for more data
+			pthread_mutex_lock(&m_sendLock);
+			m_threadWaiting = 1;
+			while ((m_runThread) && (!DataWaiting()))
+				pthread_cond_wait(&m_sendCond, &m_sendLock);
+			m_threadWaiting = 0;
+			pthread_mutex_unlock(&m_sendLock);
+
+			LogExcess(VB_CHANNELOUT, "ThreadedChannelOutputBase thread: woke: %lld\n", GetTime());
 		}
 
-		wakeTime = GetTime();
-		LogExcess(VB_CHANNELOUT, "ThreadedChannelOutputBase thread: woke: %lld\n", GetTime());
-		pthread_mutex_unlock(&m_sendLock);
-
 		if (!m_runThread)
 			continue;
 
-		// See if there is any data waiting to process or if we timed out
-		if (m_useDoubleBuffer)
-			pthread_mutex_lock(&m_bufLock);
-
-		if (m_dataWaiting) {
-			if (m_useDoubleBuffer)
-				pthread_mutex_unlock(&m_bufLock);
-
-			SendOutputBuffer();
-		} else {
-			if (m_useDoubleBuffer)
-				pthread_mutex_unlock(&m_bufLock);
-		}
+		SendOutputBuffer();
 	}
 
 	LogDebug(VB_CHANNELOUT, "ThreadedChannelOutputBase thread complete\n");
 	m_threadIsRunning = 0;
 }
-
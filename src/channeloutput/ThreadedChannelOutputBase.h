@@ -26,6 +26,7 @@
 #ifndef _THREADEDCHANNELOUTPUTBASE_H
 #define _THREADEDCHANNELOUTPUTBASE_H
 
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -48,6 +49,9 @@ class ThreadedChannelOutputBase : public ChannelOutputBase {
 
     virtual int   SendData(unsigned char *channelData)  override;
 
+	virtual void  GetOutputStats(Json::Value &result) override;
+	virtual bool  UsesFrameDiff(void) override { return m_skipUnchangedFrames; }
+
 	void          OutputThread(void);
 
   private:
@@ -60,19 +64,33 @@ class ThreadedChannelOutputBase : public ChannelOutputBase {
 	int           StopOutputThread(void);
 	int           SendOutputBuffer(void);
 
-	unsigned int     m_threadIsRunning;
-	unsigned int     m_runThread;
-	volatile unsigned int     m_dataWaiting;
+	int           DataWaiting(void);
+
+	std::atomic<unsigned int> m_threadIsRunning;
+	std::atomic<unsigned int> m_runThread;
 	unsigned int     m_useDoubleBuffer;
 
+	// Don't hand the thread frames where none of our channels changed
+	unsigned int     m_skipUnchangedFrames;
+
 	pthread_t        m_threadID;
-	pthread_mutex_t  m_bufLock;
 	pthread_mutex_t  m_sendLock;
 	pthread_cond_t   m_sendCond;
 
-	unsigned char   *m_inBuf;
-	unsigned char   *m_outBuf;
-
+	// Triple buffer between SendData() and the output thread.  SendData()
+	// owns m_writeSlot, the output thread owns m_readSlot and the third
+	// slot is in m_latestSlot along with a flag saying whether it holds a
+	// frame that has not been sent yet.  With m_useDoubleBuffer the slots
+	// are our own buffers and SendData() copies into them, otherwise they
+	// just point at the channel data passed to SendData().
+	unsigned char   *m_slots[3];
+	std::atomic<int> m_latestSlot;
+	int              m_writeSlot;
+	int              m_readSlot;
+
+	std::atomic<int>          m_threadWaiting;
+	std::atomic<unsigned int> m_framesDropped;
+	std::atomic<unsigned int> m_framesUnchanged;
 };
 
 #endif /* #ifndef _CHANNELOUTPUTBASE_H */
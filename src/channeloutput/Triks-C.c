@@ -37,6 +37,7 @@
 #include "log.h"
 #include "settings.h"
 #include "serialutil.h"
+#include "Threads.h"
 
 #include "Triks-C.h"
 
@@ -98,6 +99,8 @@ void *RunTriksCOutputThread(void *data)
 {
 	LogDebug(VB_CHANNELOUT, "RunTriksCOutputThread()\n");
 
+	SetThreadRole(THREAD_ROLE_OUTPUT_DEVICE, "fpp-Triks-C");
+
 	long long wakeTime = GetTime();
 	long long lastProcTime = 0;
 	long long frameTime = 0;
@@ -28,6 +28,10 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <ifaddrs.h>
+#include <linux/net_tstamp.h>
+#include <netinet/udp.h>
+
+#include <algorithm>
 
 #include "UDPOutput.h"
 #include "log.h"
@@ -35,11 +39,50 @@
 
 #include "common.h"
 #include "settings.h"
+#include "Threads.h"
 
 #include "E131.h"
 #include "DDP.h"
 #include "ArtNet.h"
 
+// Packets due within this many us are sent together, with SO_TXTIME the
+// kernel holds them until their send time so we can batch further ahead
+#define UDP_TX_BATCH_TIME    250
+#define UDP_TX_TXTIME_LEAD   2000
+#define UDP_TX_LATE_TIME     1000
+
+#define UDP_TX_SLOT_INDEX    0x3
+#define UDP_TX_NEW_FRAME     0x4
+
+#define UDP_TX_CMSG_WORDS    (CMSG_SPACE(sizeof(uint64_t)) / sizeof(uint64_t))
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT          103
+#endif
+
+// Older kernels allow 64 segments per send and the whole send has to fit
+// in one IP datagram
+#define UDP_GSO_MAX_SEGMENTS 64
+#define UDP_GSO_MAX_BYTES    65000
+#define UDP_GSO_CMSG_WORDS   ((CMSG_SPACE(sizeof(uint16_t)) + sizeof(uint64_t) - 1) / sizeof(uint64_t))
+
+static size_t MessageLength(const struct mmsghdr &msg) {
+    size_t len = 0;
+    for (int i = 0; i < msg.msg_hdr.msg_iovlen; i++) {
+        len += msg.msg_hdr.msg_iov[i].iov_len;
+    }
+    return len;
+}
+
+static bool SameDestination(const struct mmsghdr &a, const struct mmsghdr &b) {
+    if (!a.msg_hdr.msg_name || !b.msg_hdr.msg_name) {
+        return false;
+    }
+    const struct sockaddr_in *sa = (const struct sockaddr_in *)a.msg_hdr.msg_name;
+    const struct sockaddr_in *sb = (const struct sockaddr_in *)b.msg_hdr.msg_name;
+    return (sa->sin_addr.s_addr == sb->sin_addr.s_addr) && (sa->sin_port == sb->sin_port);
+}
+
 
 UDPOutputData::UDPOutputData(const Json::Value &config)
 :  valid(true) {
@@ -55,11 +98,19 @@ UDPOutputData::~UDPOutputData() {
 
 
 UDPOutput::UDPOutput(unsigned int startChannel, unsigned int channelCount)
-    : pingThread(nullptr), rebuildOutputLists(false)
+    : ChannelOutputBase(startChannel, channelCount),
+      skipUnchanged(false), keepAliveTime(1000000),
+      packetsSent(0), packetsSkipped(0),
+      txThread(nullptr), txRunning(false), txLatestSlot(2),
+      txWriteSlot(0), txReadSlot(1), txSendFailed(false),
+      txPacing(0), txTime(false), frameInterval(25000), lastQueued(0),
+      gso(false), gsoSends(0), sendPackets(0), sendTime(0),
+      pingThread(nullptr), rebuildOutputLists(false)
 {
     sendSocket = -1;
 }
 UDPOutput::~UDPOutput() {
+    StopTxThread();
     runDisabledPings = false;
     for (auto a : outputs) {
         delete a;
@@ -68,6 +119,11 @@ UDPOutput::~UDPOutput() {
 
 int UDPOutput::Init(Json::Value config) {
     enabled = config["enabled"].asInt();
+
+    skipUnchanged = getSettingInt("SkipUnchangedUniverses");
+    if (getSettingInt("UniverseKeepAlive") > 0) {
+        keepAliveTime = getSettingInt("UniverseKeepAlive") * 1000LL;
+    }
     for (int i = 0; i < config["universes"].size(); i++) {
         Json::Value s = config["universes"][i];
         int type = s["type"].asInt();
@@ -126,9 +182,27 @@ int UDPOutput::Init(Json::Value config) {
     
     InitNetwork();
     PingControllers();
+
+    if (getSettingInt("UDPSegmentOffload")) {
+        // probe for kernel support, the NIC doesn't need to support it as
+        // the kernel segments in software if needed
+        int size = 0;
+        socklen_t len = sizeof(size);
+        if (getsockopt(sendSocket, SOL_UDP, UDP_SEGMENT, &size, &len) == 0) {
+            gso = true;
+        } else {
+            LogWarn(VB_CHANNELOUT, "UDP segmentation offload is not supported by this kernel: %s\n",
+                    strerror(errno));
+        }
+    }
+
+    if (enabled && getSettingInt("UDPTransmitThread")) {
+        StartTxThread();
+    }
     return ChannelOutputBase::Init(config);
 }
 int  UDPOutput::Close() {
+    StopTxThread();
     return ChannelOutputBase::Close();
 }
 void UDPOutput::PrepData(unsigned char *channelData) {
@@ -152,9 +226,27 @@ void  UDPOutput::GetRequiredChannelRange(int &min, int & max) {
 }
 
 int UDPOutput::SendMessages(int socket, std::vector<struct mmsghdr> &sendmsgs) {
+    if (sendmsgs.empty()) {
+        return 0;
+    }
+    return SendMessages(socket, &sendmsgs[0], sendmsgs.size());
+}
+int UDPOutput::SendMessages(int socket, struct mmsghdr *msgs, int msgCount) {
+    if (socket != sendSocket) {
+        return SendMMsg(socket, msgs, msgCount);
+    }
+
+    long long start = GetMonotonicTime();
+    int outputCount = gso ? SendSegmented(socket, msgs, msgCount)
+                          : SendMMsg(socket, msgs, msgCount);
+    if (outputCount > 0) {
+        sendTime.fetch_add(GetMonotonicTime() - start, std::memory_order_relaxed);
+        sendPackets.fetch_add(outputCount, std::memory_order_relaxed);
+    }
+    return outputCount;
+}
+int UDPOutput::SendMMsg(int socket, struct mmsghdr *msgs, int msgCount) {
     errno = 0;
-    struct mmsghdr *msgs = &sendmsgs[0];
-    int msgCount = sendmsgs.size();
     if (msgCount == 0) {
         return 0;
     }
@@ -162,14 +254,117 @@ int UDPOutput::SendMessages(int socket, std::vector<struct mmsghdr> &sendmsgs) {
     int oc = sendmmsg(socket, msgs, msgCount, 0);
     int outputCount = oc;
     while (oc > 0 && outputCount != msgCount) {
-        int oc = sendmmsg(sendSocket, &msgs[outputCount], msgCount - outputCount, 0);
-        if (oc >= 0) {
+        oc = sendmmsg(socket, &msgs[outputCount], msgCount - outputCount, 0);
+        if (oc > 0) {
             outputCount += oc;
         }
     }
     return outputCount;
 }
 
+/*
+ * Merge runs of packets to the same address into UDP_SEGMENT sends.  The
+ * kernel cuts the payload back into gso_size packets so every packet in a
+ * run has to be the same size apart from the last, which is how DDP splits
+ * a controller's channels and how E1.31/ArtNet universes of the same size
+ * line up.  Packets with their own control messages (SO_TXTIME) are sent
+ * as they are.  Returns the number of the original messages sent.
+ */
+int UDPOutput::SendSegmented(int socket, struct mmsghdr *msgs, int msgCount) {
+    int iovCount = 0;
+    for (int m = 0; m < msgCount; m++) {
+        iovCount += msgs[m].msg_hdr.msg_iovlen;
+    }
+
+    // sized up front, the merged messages point into these
+    gsoMsgs.clear();
+    gsoCounts.clear();
+    gsoIovs.clear();
+    gsoIovs.reserve(iovCount);
+    gsoControl.resize(msgCount * UDP_GSO_CMSG_WORDS);
+
+    for (int m = 0; m < msgCount; ) {
+        size_t segSize = MessageLength(msgs[m]);
+        size_t total = segSize;
+        int last = m + 1;
+
+        if (!msgs[m].msg_hdr.msg_control) {
+            bool shortSeen = false;
+            while ((last < msgCount) && ((last - m) < UDP_GSO_MAX_SEGMENTS) && !shortSeen) {
+                size_t len = MessageLength(msgs[last]);
+                if (msgs[last].msg_hdr.msg_control || !SameDestination(msgs[m], msgs[last])
+                    || (len > segSize) || ((total + len) > UDP_GSO_MAX_BYTES)) {
+                    break;
+                }
+                shortSeen = len < segSize;
+                total += len;
+                last++;
+            }
+        }
+
+        if ((last - m) == 1) {
+            gsoMsgs.push_back(msgs[m]);
+        } else {
+            struct mmsghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_hdr.msg_name = msgs[m].msg_hdr.msg_name;
+            msg.msg_hdr.msg_namelen = msgs[m].msg_hdr.msg_namelen;
+            msg.msg_hdr.msg_iov = gsoIovs.data() + gsoIovs.size();
+            for (int i = m; i < last; i++) {
+                for (int v = 0; v < msgs[i].msg_hdr.msg_iovlen; v++) {
+                    gsoIovs.push_back(msgs[i].msg_hdr.msg_iov[v]);
+                }
+            }
+            msg.msg_hdr.msg_iovlen = gsoIovs.data() + gsoIovs.size() - msg.msg_hdr.msg_iov;
+
+            struct cmsghdr *cm = (struct cmsghdr *)&gsoControl[gsoMsgs.size() * UDP_GSO_CMSG_WORDS];
+            cm->cmsg_level = SOL_UDP;
+            cm->cmsg_type = UDP_SEGMENT;
+            cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t size = segSize;
+            memcpy(CMSG_DATA(cm), &size, sizeof(size));
+            msg.msg_hdr.msg_control = cm;
+            msg.msg_hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+
+            gsoMsgs.push_back(msg);
+        }
+        gsoCounts.push_back(last - m);
+        m = last;
+    }
+
+    int sent = std::max(SendMMsg(socket, gsoMsgs.data(), gsoMsgs.size()), 0);
+    int outputCount = 0;
+    for (int i = 0; i < sent; i++) {
+        outputCount += gsoCounts[i];
+        if (gsoCounts[i] > 1) {
+            gsoSends.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    if ((sent < gsoMsgs.size()) && (gsoCounts[sent] > 1)
+        && ((errno == EIO) || (errno == EINVAL) || (errno == ENOPROTOOPT))) {
+        // the device or route can't do it (EIO is no checksum offload),
+        // go back to sending each packet on its own
+        LogWarn(VB_CHANNELOUT, "UDP segmentation offload failed, disabling it: %s\n", strerror(errno));
+        gso = false;
+        int more = SendMMsg(socket, msgs + outputCount, msgCount - outputCount);
+        if (more > 0) {
+            outputCount += more;
+        }
+    }
+    return outputCount;
+}
+
+bool UDPOutput::MessageChanged(struct mmsghdr &msg, unsigned char *channelData) {
+    // the channel data is always the last iovec
+    struct iovec &iov = msg.msg_hdr.msg_iov[msg.msg_hdr.msg_iovlen - 1];
+    long offset = (unsigned char *)iov.iov_base - channelData;
+    if (!iov.iov_base || offset < 0) {
+        return true;
+    }
+    return ChannelsChanged(offset, iov.iov_len);
+}
+
 int UDPOutput::SendData(unsigned char *channelData) {
     if (rebuildOutputLists) {
         RebuildOutputMessageLists();
@@ -178,15 +373,52 @@ int UDPOutput::SendData(unsigned char *channelData) {
     if ((udpMsgs.size() == 0 && broadcastMsgs.size() == 0) || !enabled) {
         return 0;
     }
+
+    if (txSendFailed) {
+        // the transmit thread couldn't send everything, see what is still online
+        txSendFailed = false;
+        PingControllers();
+    }
+
+    std::vector<struct mmsghdr> *msgs = &udpMsgs;
+    if (skipUnchanged) {
+        long long now = GetMonotonicTime();
+        bool groupSent = false;
+        sendMsgs.clear();
+        sendMsgIndex.clear();
+        for (int m = 0; m < udpMsgs.size(); m++) {
+            UDPMessageInfo &info = udpMsgInfo[m];
+            if (info.groupStart == m) {
+                groupSent = false;
+            }
+            if ((now - info.lastSent) >= keepAliveTime
+                || (info.push && groupSent)
+                || MessageChanged(udpMsgs[m], channelData)) {
+                sendMsgs.push_back(udpMsgs[m]);
+                sendMsgIndex.push_back(m);
+                info.lastSent = now;
+                groupSent = true;
+            }
+        }
+        msgs = &sendMsgs;
+        packetsSkipped.fetch_add(udpMsgs.size() - sendMsgs.size(), std::memory_order_relaxed);
+    }
+    packetsSent.fetch_add(msgs->size(), std::memory_order_relaxed);
+
+    if (txThread) {
+        QueueTxFrame(*msgs, skipUnchanged ? &sendMsgIndex : nullptr);
+        return 1;
+    }
+
     std::chrono::high_resolution_clock clock;
     auto t1 = clock.now();
-    int outputCount = SendMessages(sendSocket, udpMsgs);
+    int outputCount = SendMessages(sendSocket, *msgs);
     auto t2 = clock.now();
     long diff = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
-    if ((outputCount != udpMsgs.size()) || (diff > 100)) {
+    if ((outputCount != msgs->size()) || (diff > 100)) {
         //failed to send all messages or it took more than 100ms to send them
         LogErr(VB_CHANNELOUT, "sendmmsg() failed for UDP output (output count: %d/%d   time: %u ms) with error: %d   %s\n",
-               outputCount, udpMsgs.size(), diff,
+               outputCount, msgs->size(), diff,
                errno,
                strerror(errno));
         
@@ -201,6 +433,7 @@ int UDPOutput::SendData(unsigned char *channelData) {
 }
 
 void DoPingThread(UDPOutput *output) {
+    SetThreadRole(THREAD_ROLE_NETWORK, "fpp-udpping");
     output->BackgroundThreadPing();
 }
 void UDPOutput::BackgroundThreadPing() {
@@ -293,11 +526,22 @@ void UDPOutput::RebuildOutputMessageLists() {
 
     rebuildOutputLists = false;
     udpMsgs.clear();
+    udpMsgInfo.clear();
     broadcastMsgs.clear();
     for (auto a : outputs) {
         if (a->valid && a->active) {
+            int first = udpMsgs.size();
             a->CreateMessages(udpMsgs);
             a->CreateBroadcastMessages(broadcastMsgs);
+
+            // new messages are sent on the next frame whether they changed or not
+            for (int m = first; m < udpMsgs.size(); m++) {
+                UDPMessageInfo info = { first, false, 0, GetControllerStats(udpMsgs[m]) };
+                udpMsgInfo.push_back(info);
+            }
+            if ((udpMsgs.size() > first) && a->HasPushMessage()) {
+                udpMsgInfo.back().push = true;
+            }
         }
     }
     //add any sync packets or whatever that are needed
@@ -321,6 +565,300 @@ void UDPOutput::RebuildOutputMessageLists() {
         pingThread = new std::thread(DoPingThread, this);
     }
 }
+void UDPOutput::GetOutputStats(Json::Value &result) {
+    result["packetsSent"] = (Json::UInt64)packetsSent.load(std::memory_order_relaxed);
+
+    // transmit cost per packet, compare with UDPSegmentOffload on and off
+    uint64_t packets = sendPackets.load(std::memory_order_relaxed);
+    result["sendNsPerPacket"] = packets ?
+        (Json::UInt64)(sendTime.load(std::memory_order_relaxed) * 1000 / packets) : 0;
+    if (gso) {
+        result["segmentedSends"] = (Json::UInt64)gsoSends.load(std::memory_order_relaxed);
+    }
+    if (skipUnchanged) {
+        result["packetsSkipped"] = (Json::UInt64)packetsSkipped.load(std::memory_order_relaxed);
+    }
+
+    if (txThread) {
+        std::unique_lock<std::mutex> lock(controllersLock);
+        Json::Value list;
+        for (auto &c : controllers) {
+            Json::Value controller;
+            controller["packets"] = (Json::UInt64)c.second.packets.load(std::memory_order_relaxed);
+            controller["dropped"] = (Json::UInt64)c.second.dropped.load(std::memory_order_relaxed);
+            controller["late"] = (Json::UInt64)c.second.late.load(std::memory_order_relaxed);
+            list[c.first] = controller;
+        }
+        result["pacingWindowUs"] = (Json::UInt64)(frameInterval * txPacing / 100);
+        result["controllers"] = list;
+    }
+}
+
+UDPControllerStats *UDPOutput::GetControllerStats(const struct mmsghdr &msg) {
+    std::string address = "unknown";
+    if (msg.msg_hdr.msg_name && (msg.msg_hdr.msg_namelen >= sizeof(struct sockaddr_in))) {
+        address = inet_ntoa(((struct sockaddr_in *)msg.msg_hdr.msg_name)->sin_addr);
+    }
+
+    std::unique_lock<std::mutex> lock(controllersLock);
+    auto it = controllers.find(address);
+    if (it == controllers.end()) {
+        UDPControllerStats &c = controllers[address];
+        c.packets = 0;
+        c.dropped = 0;
+        c.late = 0;
+        return &c;
+    }
+    return &it->second;
+}
+
+/*
+ * Asynchronous transmit.  SendData() copies the frame's packets into a
+ * UDPTxFrame and returns, the transmit thread then spreads each
+ * controller's packets evenly over UDPPacing percent of the frame interval
+ * so neither the controllers nor the switches in between see the whole
+ * frame as one line rate burst.  With UDPTxTime the kernel (fq or etf
+ * qdisc) times each packet's departure and we only need to wake up every
+ * UDP_TX_TXTIME_LEAD us.
+ */
+void DoTxThread(UDPOutput *output) {
+    output->TxThread();
+}
+void UDPOutput::StartTxThread() {
+    txPacing = std::min(std::max(getSettingInt("UDPPacing"), 0), 100);
+
+#ifdef SO_TXTIME
+    if (getSettingInt("UDPTxTime")) {
+        struct sock_txtime cfg;
+        memset(&cfg, 0, sizeof(cfg));
+        cfg.clockid = CLOCK_MONOTONIC;
+        if (setsockopt(sendSocket, SOL_SOCKET, SO_TXTIME, &cfg, sizeof(cfg)) == 0) {
+            txTime = true;
+        } else {
+            LogWarn(VB_CHANNELOUT, "Unable to enable SO_TXTIME, pacing packets from the transmit thread: %s\n",
+                    strerror(errno));
+        }
+    }
+#else
+    if (getSettingInt("UDPTxTime")) {
+        LogWarn(VB_CHANNELOUT, "SO_TXTIME is not supported, pacing packets from the transmit thread\n");
+    }
+#endif
+
+    LogDebug(VB_CHANNELOUT, "Starting UDP transmit thread, pacing %d%%%s\n",
+             txPacing, txTime ? " with SO_TXTIME" : "");
+
+    txRunning = true;
+    txThread = new std::thread(DoTxThread, this);
+}
+void UDPOutput::StopTxThread() {
+    if (!txThread) {
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(txLock);
+        txRunning = false;
+        txCond.notify_all();
+    }
+    txThread->join();
+    delete txThread;
+    txThread = nullptr;
+}
+void UDPOutput::QueueTxFrame(std::vector<struct mmsghdr> &msgs, std::vector<int> *msgIndex) {
+    long long now = GetMonotonicTime();
+    if (lastQueued) {
+        // smooth it so one late frame doesn't squash the window
+        long long interval = now - lastQueued;
+        if ((interval > 0) && (interval < 200000)) {
+            frameInterval = ((frameInterval * 7) + interval) / 8;
+        }
+    }
+    lastQueued = now;
+
+    int dataCount = msgs.size();
+    int count = dataCount + broadcastMsgs.size();
+    if (!count) {
+        return;
+    }
+
+    UDPTxFrame &f = txFrames[txWriteSlot];
+    f.queued = now;
+    f.broadcastStart = dataCount;
+    f.msgs.resize(count);
+    f.iovs.resize(count);
+    f.sendTime.resize(count);
+    f.controllers.resize(count);
+    f.msgIndex.resize(count);
+    f.control.resize(txTime ? (dataCount * UDP_TX_CMSG_WORDS) : 0);
+
+    // Each controller gets its packets evenly spaced through the window,
+    // offset by a different phase per controller so single packet
+    // controllers are spread out too.
+    long long window = frameInterval * txPacing / 100;
+    int controllerCount = 0;
+    for (int m = 0; m < dataCount; m++) {
+        int idx = msgIndex ? (*msgIndex)[m] : m;
+        udpMsgInfo[idx].controller->txCount = 0;
+    }
+    for (int m = 0; m < dataCount; m++) {
+        int idx = msgIndex ? (*msgIndex)[m] : m;
+        UDPControllerStats *c = udpMsgInfo[idx].controller;
+        if (!c->txCount) {
+            c->txIndex = 0;
+            c->txPhase = controllerCount++;
+        }
+        c->txCount++;
+    }
+    txOrder.resize(dataCount);
+    for (int m = 0; m < dataCount; m++) {
+        int idx = msgIndex ? (*msgIndex)[m] : m;
+        UDPControllerStats *c = udpMsgInfo[idx].controller;
+        double slot = c->txIndex++ + (c->txPhase / controllerCount);
+        txOrder[m] = std::pair<long long, int>(window * slot / c->txCount, m);
+    }
+    std::sort(txOrder.begin(), txOrder.end());
+
+    size_t bytes = 0;
+    for (auto &msg : msgs) {
+        bytes += MessageLength(msg);
+    }
+    for (auto &msg : broadcastMsgs) {
+        bytes += MessageLength(msg);
+    }
+    f.data.resize(bytes);
+
+    // copy each packet into one contiguous buffer
+    unsigned char *data = f.data.data();
+    for (int m = 0; m < count; m++) {
+        struct mmsghdr *src;
+        if (m < dataCount) {
+            int o = txOrder[m].second;
+            src = &msgs[o];
+            f.msgIndex[m] = msgIndex ? (*msgIndex)[o] : o;
+            f.controllers[m] = udpMsgInfo[f.msgIndex[m]].controller;
+            f.sendTime[m] = txOrder[m].first;
+        } else {
+            src = &broadcastMsgs[m - dataCount];
+            f.msgIndex[m] = -1;
+            f.controllers[m] = nullptr;
+            f.sendTime[m] = window;
+        }
+
+        struct iovec &iov = f.iovs[m];
+        iov.iov_base = data;
+        for (int i = 0; i < src->msg_hdr.msg_iovlen; i++) {
+            memcpy(data, src->msg_hdr.msg_iov[i].iov_base, src->msg_hdr.msg_iov[i].iov_len);
+            data += src->msg_hdr.msg_iov[i].iov_len;
+        }
+        iov.iov_len = data - (unsigned char *)iov.iov_base;
+
+        struct mmsghdr &msg = f.msgs[m];
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_hdr.msg_name = src->msg_hdr.msg_name;
+        msg.msg_hdr.msg_namelen = src->msg_hdr.msg_namelen;
+        msg.msg_hdr.msg_iov = &iov;
+        msg.msg_hdr.msg_iovlen = 1;
+
+#ifdef SO_TXTIME
+        if (txTime && (m < dataCount)) {
+            struct cmsghdr *cm = (struct cmsghdr *)&f.control[m * UDP_TX_CMSG_WORDS];
+            cm->cmsg_level = SOL_SOCKET;
+            cm->cmsg_type = SCM_TXTIME;
+            cm->cmsg_len = CMSG_LEN(sizeof(uint64_t));
+            msg.msg_hdr.msg_control = cm;
+            msg.msg_hdr.msg_controllen = CMSG_SPACE(sizeof(uint64_t));
+        }
+#endif
+    }
+
+    int prev = txLatestSlot.exchange(txWriteSlot | UDP_TX_NEW_FRAME);
+    txWriteSlot = prev & UDP_TX_SLOT_INDEX;
+
+    if (prev & UDP_TX_NEW_FRAME) {
+        // the thread never started on the last frame, count its packets
+        // as dropped and make sure any that changed go out with the next
+        UDPTxFrame &dropped = txFrames[txWriteSlot];
+        for (int m = 0; m < dropped.broadcastStart; m++) {
+            dropped.controllers[m]->dropped.fetch_add(1, std::memory_order_relaxed);
+            if (dropped.msgIndex[m] < udpMsgInfo.size()) {
+                udpMsgInfo[dropped.msgIndex[m]].lastSent = 0;
+            }
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(txLock);
+    txCond.notify_one();
+}
+void UDPOutput::SendTxFrame(UDPTxFrame &f) {
+    long long lead = txTime ? UDP_TX_TXTIME_LEAD : UDP_TX_BATCH_TIME;
+    int m = 0;
+
+    while (m < f.broadcastStart) {
+        long long now = GetMonotonicTime();
+
+        // if a newer frame is waiting then get the rest of this one out now
+        bool flush = (txLatestSlot & UDP_TX_NEW_FRAME) || !txRunning;
+        if (!flush && ((f.queued + f.sendTime[m]) > (now + lead))) {
+            std::unique_lock<std::mutex> lock(txLock);
+            if (!(txLatestSlot & UDP_TX_NEW_FRAME) && txRunning) {
+                txCond.wait_until(lock, std::chrono::steady_clock::time_point(
+                    std::chrono::microseconds(f.queued + f.sendTime[m] - lead)));
+            }
+            continue;
+        }
+
+        int last = m;
+        while ((last < f.broadcastStart) &&
+               (flush || ((f.queued + f.sendTime[last]) <= (now + lead)))) {
+#ifdef SO_TXTIME
+            if (txTime) {
+                uint64_t txtime = std::max(f.queued + f.sendTime[last], now) * 1000ULL;
+                memcpy(CMSG_DATA((struct cmsghdr *)f.msgs[last].msg_hdr.msg_control),
+                       &txtime, sizeof(txtime));
+            }
+#endif
+            last++;
+        }
+
+        int sent = std::max(SendMessages(sendSocket, &f.msgs[m], last - m), 0);
+        for (int i = m; i < last; i++) {
+            if (i < (m + sent)) {
+                f.controllers[i]->packets.fetch_add(1, std::memory_order_relaxed);
+                if ((now - (f.queued + f.sendTime[i])) > UDP_TX_LATE_TIME) {
+                    f.controllers[i]->late.fetch_add(1, std::memory_order_relaxed);
+                }
+            } else {
+                f.controllers[i]->dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        if (sent != (last - m)) {
+            LogDebug(VB_CHANNELOUT, "sendmmsg() failed on UDP transmit thread (%d/%d): %s\n",
+                     sent, last - m, strerror(errno));
+            txSendFailed = true;
+        }
+        m = last;
+    }
+
+    SendMessages(broadcastSocket, &f.msgs[f.broadcastStart], f.msgs.size() - f.broadcastStart);
+}
+void UDPOutput::TxThread() {
+    SetThreadRole(THREAD_ROLE_OUTPUT_DEVICE, "fpp-udptx");
+
+    std::unique_lock<std::mutex> lock(txLock);
+    while (txRunning) {
+        if (!(txLatestSlot & UDP_TX_NEW_FRAME)) {
+            txCond.wait(lock);
+            continue;
+        }
+
+        txReadSlot = txLatestSlot.exchange(txReadSlot) & UDP_TX_SLOT_INDEX;
+
+        lock.unlock();
+        SendTxFrame(txFrames[txReadSlot]);
+        lock.lock();
+    }
+}
 void UDPOutput::DumpConfig() {
     ChannelOutputBase::DumpConfig();
     for (auto u : outputs) {
@@ -22,6 +22,9 @@
 #define _IPOUTPUT_H
 
 #include <list>
+#include <atomic>
+#include <condition_variable>
+#include <map>
 #include <vector>
 #include <string>
 #include <thread>
@@ -51,6 +54,10 @@ public:
     // purely broadcast messages sent after the data (sync packets for example)
     virtual void AddPostDataMessages(std::vector<struct mmsghdr> &bMsgs) {}
 
+    // true if the last message from CreateMessages must be sent whenever
+    // any of the others are (DDP's push packet)
+    virtual bool HasPushMessage() { return false; }
+
     virtual void DumpConfig() = 0;
     
     std::string   description;
@@ -63,6 +70,33 @@ public:
 };
 
 
+// Packet counts for one destination address
+typedef struct {
+    std::atomic<uint64_t> packets;
+    std::atomic<uint64_t> dropped;  // send failed or frame replaced before it was sent
+    std::atomic<uint64_t> late;     // sent more than UDP_TX_LATE_TIME after it was due
+
+    // used while building a transmit frame
+    int txCount;
+    int txIndex;
+    double txPhase;
+} UDPControllerStats;
+
+// A frame handed to the transmit thread.  The packets are copied so the
+// channel data can change as soon as SendData() returns.  The data
+// messages are sorted by send time and followed by the broadcast messages.
+typedef struct {
+    std::vector<unsigned char>        data;
+    std::vector<struct mmsghdr>       msgs;
+    std::vector<struct iovec>         iovs;
+    std::vector<uint64_t>             control;   // SCM_TXTIME cmsgs
+    std::vector<long long>            sendTime;  // us after queued
+    std::vector<UDPControllerStats*>  controllers;
+    std::vector<int>                  msgIndex;  // index into udpMsgs
+    int                               broadcastStart;
+    long long                         queued;
+} UDPTxFrame;
+
 class UDPOutput : public ChannelOutputBase {
 public:
     UDPOutput(unsigned int startChannel, unsigned int channelCount);
@@ -76,15 +110,28 @@ public:
     int  SendData(unsigned char *channelData);
     
     void DumpConfig(void);
+    void GetOutputStats(Json::Value &result) override;
+    bool UsesFrameDiff(void) override { return skipUnchanged; }
 
     void BackgroundThreadPing();
+    void TxThread();
 
     virtual void GetRequiredChannelRange(int &min, int & max);
 private:
     int SendMessages(int socket, std::vector<struct mmsghdr> &sendmsgs);
+    int SendMessages(int socket, struct mmsghdr *msgs, int msgCount);
+    int SendMMsg(int socket, struct mmsghdr *msgs, int msgCount);
+    int SendSegmented(int socket, struct mmsghdr *msgs, int msgCount);
     bool InitNetwork();
     void PingControllers();
     void RebuildOutputMessageLists();
+    bool MessageChanged(struct mmsghdr &msg, unsigned char *channelData);
+    UDPControllerStats *GetControllerStats(const struct mmsghdr &msg);
+
+    void StartTxThread();
+    void StopTxThread();
+    void QueueTxFrame(std::vector<struct mmsghdr> &msgs, std::vector<int> *msgIndex);
+    void SendTxFrame(UDPTxFrame &frame);
     
     int sendSocket;
     int broadcastSocket;
@@ -93,6 +140,54 @@ private:
     std::list<UDPOutputData*> outputs;
     std::vector<struct mmsghdr> udpMsgs;
     std::vector<struct mmsghdr> broadcastMsgs;
+
+    // Unchanged messages are only resent every keepAliveTime us
+    typedef struct {
+        int       groupStart;   // first message from the same output
+        bool      push;
+        long long lastSent;
+        UDPControllerStats *controller;
+    } UDPMessageInfo;
+
+    bool skipUnchanged;
+    long long keepAliveTime;
+    std::vector<UDPMessageInfo> udpMsgInfo;
+    std::vector<struct mmsghdr> sendMsgs;
+    std::vector<int> sendMsgIndex;
+    std::atomic<uint64_t> packetsSent;
+    std::atomic<uint64_t> packetsSkipped;
+
+    // keyed by address, entries are never removed so pointers stay valid
+    std::mutex controllersLock;
+    std::map<std::string, UDPControllerStats> controllers;
+
+    // Asynchronous transmit, frames are passed to the transmit thread
+    // through a triple buffer like ThreadedChannelOutputBase
+    std::thread *txThread;
+    std::atomic<bool> txRunning;
+    std::mutex txLock;
+    std::condition_variable txCond;
+    UDPTxFrame txFrames[3];
+    std::atomic<int> txLatestSlot;
+    int txWriteSlot;
+    int txReadSlot;
+    std::atomic<bool> txSendFailed;
+    int txPacing;                   // percent of the frame interval
+    bool txTime;                    // SO_TXTIME is enabled on sendSocket
+    long long frameInterval;
+    long long lastQueued;
+    std::vector<std::pair<long long, int>> txOrder;
+
+    // UDP_SEGMENT (GSO) sends, runs of packets to the same address are
+    // merged into one send and split up again by the kernel
+    std::atomic<bool> gso;
+    std::vector<struct mmsghdr> gsoMsgs;
+    std::vector<struct iovec> gsoIovs;
+    std::vector<uint64_t> gsoControl;
+    std::vector<int> gsoCounts;
+    std::atomic<uint64_t> gsoSends;
+    std::atomic<uint64_t> sendPackets;
+    std::atomic<uint64_t> sendTime;
     
     std::thread *pingThread;
     volatile bool runDisabledPings;
@@ -69,6 +69,7 @@ VirtualDisplayOutput::VirtualDisplayOutput(unsigned int startChannel,
 
 	m_maxChannels = FPPD_MAX_CHANNELS;
 	m_useDoubleBuffer = 1;
+	m_skipUnchangedFrames = 1;
 }
 
 /*
@@ -29,9 +29,13 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <atomic>
+#include <condition_variable>
 #include <fstream>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 
 #include "channeloutput.h"
 #include "DebugOutput.h"
@@ -41,6 +45,7 @@
 #include "DDP.h"
 #include "E131.h"
 #include "FBMatrix.h"
+#include "FrameDiff.h"
 #include "FBVirtualDisplay.h"
 #include "FPD.h"
 #include "GenericSerial.h"
@@ -49,6 +54,7 @@
 #include "Sequence.h"
 #include "settings.h"
 #include "LOR.h"
+#include "OutputMetrics.h"
 #include "SPInRF24L01.h"
 #include "RHL_DVI_E131.h"
 #include "USBDMX.h"
@@ -59,6 +65,7 @@
 #include "GPIO.h"
 #include "GPIO595.h"
 #include "common.h"
+#include "Threads.h"
 
 #ifdef USE_X11ChannelOutputs
 #  include "X11Matrix.h"
@@ -104,6 +111,41 @@ static int LoadOutputProcessors(void);
 
 OutputProcessors         outputProcessors;
 
+// Per output PrepData/SendData timings in microseconds.  Updated by
+// whichever thread ran the output, read by the http API.
+class ChannelOutputTiming {
+  public:
+	std::string           type;
+	FrameTimeHistogram    prepTimes;
+	FrameTimeHistogram    sendTimes;
+
+	void Reset(const std::string &t) {
+		type = t;
+		prepTimes.Reset();
+		sendTimes.Reset();
+	}
+};
+static ChannelOutputTiming channelOutputTimings[FPPD_MAX_CHANNEL_OUTPUTS];
+
+// When ChannelOutputThreads is set PrepData and SendData for outputs that
+// are not marked as ordered are spread over a pool of worker threads.  The
+// output thread runs the ordered outputs, helps with the rest and then
+// waits for all of them before returning so each frame is fully
+// prepped/sent before the next step starts.
+static std::vector<int>         parallelOutputs;
+static std::vector<int>         orderedOutputs;
+static std::vector<std::thread> outputWorkers;
+static std::mutex               outputDispatchLock; // one frame step at a time
+static std::mutex               outputWorkLock;
+static std::condition_variable  outputWorkSignal;
+static std::condition_variable  outputWorkDoneSignal;
+static unsigned int             outputWorkGeneration = 0;
+static int                      outputWorkNext = 0;
+static int                      outputWorkRemaining = 0;
+static bool                     outputWorkPrep = false;
+static unsigned char           *outputWorkData = NULL;
+static bool                     outputWorkersStop = false;
+
 static std::vector<std::pair<uint32_t, uint32_t>> outputRanges;
 const std::vector<std::pair<uint32_t, uint32_t>> GetOutputRanges() {
     if (outputRanges.empty()) {
@@ -267,6 +309,7 @@ int InitializeChannelOutputs(void) {
 	{
 		channelOutputs[i].startChannel = getSettingInt("FPDStartChannelOffset");
 		channelOutputs[i].outputOld = &FPDOutput;
+		channelOutputTimings[i].Reset("FPD");
 
 		if (FPDOutput.open("", &channelOutputs[i].privData)) {
 			channelOutputs[i].channelCount = channelOutputs[i].outputOld->maxChannels(channelOutputs[i].privData);
@@ -350,6 +393,8 @@ int InitializeChannelOutputs(void) {
 
 				channelOutputs[i].startChannel = start;
 				channelOutputs[i].channelCount = count;
+				channelOutputs[i].ordered = outputs[c]["ordered"].asInt();
+				channelOutputTimings[i].Reset(type);
 
 				// First some Channel Outputs enabled everythwere
 				if (type == "LEDPanelMatrix") {
@@ -506,6 +551,13 @@ int InitializeChannelOutputs(void) {
 
 	LogDebug(VB_CHANNELOUT, "%d Channel Outputs configured\n", channelOutputCount);
 
+	for (i = 0; i < channelOutputCount; i++) {
+		if (channelOutputs[i].ordered)
+			orderedOutputs.push_back(i);
+		else
+			parallelOutputs.push_back(i);
+	}
+
 	LoadOutputProcessors();
     int m1, m2;
     outputProcessors.GetRequiredChannelRange(m1, m2);
@@ -529,6 +581,20 @@ int InitializeChannelOutputs(void) {
 
     LogInfo(VB_CHANNELOUT, "Determined range needed %d - %d\n", minimumNeededChannel, maximumNeededChannel);
 
+    // the frame diff costs a compare and copy of every frame so it is
+    // only kept when an output skips unchanged data
+    bool diffNeeded = false;
+    for (i = 0; i < channelOutputCount; i++) {
+        if (channelOutputs[i].output && channelOutputs[i].output->UsesFrameDiff())
+            diffNeeded = true;
+    }
+    if (diffNeeded) {
+        // the range is rounded up so may run a few channels past the buffer
+        uint32_t diffCount = std::min(outputRanges[0].second,
+                                      (uint32_t)FPPD_MAX_CHANNELS - outputRanges[0].first);
+        InitFrameDiff(outputRanges[0].first, diffCount);
+    }
+
 	return 1;
 }
 
@@ -549,15 +615,187 @@ void ResetChannelOutputFrameNumber(void) {
 }
 
 
-int PrepareChannelData(char *channelData) {
-    outputProcessors.ProcessData((unsigned char *)channelData);
-    FPPChannelOutputInstance *inst;
-    for (int i = 0; i < channelOutputCount; i++) {
-        inst = &channelOutputs[i];
-        if (inst->output) {
-            inst->output->PrepData((unsigned char *)channelData);
+static void PrepOutput(int i, unsigned char *channelData) {
+    FPPChannelOutputInstance *inst = &channelOutputs[i];
+    if (!inst->output)
+        return;
+
+    long long start = GetTime();
+    inst->output->PrepData(channelData);
+
+    channelOutputTimings[i].prepTimes.Record(GetTime() - start);
+}
+
+static void SendOutput(int i, const char *channelData) {
+    FPPChannelOutputInstance *inst = &channelOutputs[i];
+    long long start = GetTime();
+    if (inst->outputOld) {
+        inst->outputOld->send(
+                inst->privData,
+                channelData + inst->startChannel,
+                inst->channelCount < (FPPD_MAX_CHANNELS - inst->startChannel) ? inst->channelCount : (FPPD_MAX_CHANNELS - inst->startChannel));
+    } else if (inst->output) {
+        inst->output->SendData((unsigned char *)(channelData + inst->startChannel));
+    } else {
+        return;
+    }
+
+    channelOutputTimings[i].sendTimes.Record(GetTime() - start);
+}
+
+/*
+ * Claim and run parallel outputs from the current batch until none are
+ * left.  Must be called with outputWorkLock held.  Outputs are claimed
+ * under the lock so a late worker can't claim from the next batch.
+ */
+static void RunParallelOutputs(std::unique_lock<std::mutex> &lock) {
+    while (outputWorkNext < parallelOutputs.size()) {
+        int i = parallelOutputs[outputWorkNext++];
+        bool prep = outputWorkPrep;
+        unsigned char *channelData = outputWorkData;
+        lock.unlock();
+
+        if (prep)
+            PrepOutput(i, channelData);
+        else
+            SendOutput(i, (const char *)channelData);
+
+        lock.lock();
+        if (!--outputWorkRemaining)
+            outputWorkDoneSignal.notify_all();
+    }
+}
+
+static void ChannelOutputWorker(void) {
+    SetThreadRole(THREAD_ROLE_OUTPUT_WORKER, "fpp-outworker");
+
+    unsigned int generation = 0;
+    std::unique_lock<std::mutex> lock(outputWorkLock);
+    while (!outputWorkersStop) {
+        if (generation == outputWorkGeneration) {
+            outputWorkSignal.wait(lock);
+            continue;
         }
+        generation = outputWorkGeneration;
+        RunParallelOutputs(lock);
     }
+}
+
+static void StartChannelOutputWorkers(void) {
+    // Off unless asked for, not every output is safe to run alongside
+    // the others.  The output thread does its share of the work so it
+    // counts as one of the threads.
+    int threads = 1;
+    if (!strcmp(getSetting("ChannelOutputThreads"), "auto"))
+        threads = std::thread::hardware_concurrency();
+    else if (getSettingInt("ChannelOutputThreads") > 1)
+        threads = getSettingInt("ChannelOutputThreads");
+    if (threads > parallelOutputs.size())
+        threads = parallelOutputs.size();
+
+    outputWorkersStop = false;
+    for (int t = 1; t < threads; t++)
+        outputWorkers.push_back(std::thread(ChannelOutputWorker));
+
+    LogDebug(VB_CHANNELOUT, "Using %d threads for %d parallel Channel Outputs\n",
+        (int)outputWorkers.size() + 1, (int)parallelOutputs.size());
+}
+
+static void StopChannelOutputWorkers(void) {
+    std::unique_lock<std::mutex> lock(outputWorkLock);
+    outputWorkersStop = true;
+    lock.unlock();
+    outputWorkSignal.notify_all();
+
+    for (auto &t : outputWorkers)
+        t.join();
+    outputWorkers.clear();
+}
+
+/*
+ * Run PrepData or SendData for every output on the worker pool
+ */
+static void RunChannelOutputs(bool prep, unsigned char *channelData) {
+    if (outputWorkers.empty()) {
+        // single threaded, everything in config order
+        for (int i = 0; i < channelOutputCount; i++) {
+            if (prep)
+                PrepOutput(i, channelData);
+            else
+                SendOutput(i, (const char *)channelData);
+        }
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(outputWorkLock);
+    outputWorkPrep = prep;
+    outputWorkData = channelData;
+    outputWorkRemaining = parallelOutputs.size();
+    outputWorkNext = 0;
+    outputWorkGeneration++;
+    lock.unlock();
+    outputWorkSignal.notify_all();
+
+    for (auto i : orderedOutputs) {
+        if (prep)
+            PrepOutput(i, channelData);
+        else
+            SendOutput(i, (const char *)channelData);
+    }
+
+    lock.lock();
+    RunParallelOutputs(lock);
+    while (outputWorkRemaining)
+        outputWorkDoneSignal.wait(lock);
+}
+
+/*
+ * Run PrepData or SendData for every output, returning once all are done.
+ * SendBlankingData() can get here from other threads while the output
+ * thread is running so only one caller runs the outputs at a time.
+ */
+static void DispatchChannelOutputs(bool prep, unsigned char *channelData) {
+    std::unique_lock<std::mutex> dispatchLock(outputDispatchLock);
+
+    // The frame diff is shared by all the callers too.  It is only read by
+    // SendData so the compare against the last frame sent, the sends and
+    // the clear all happen under the one lock, a blank sent from another
+    // thread can't land between them.
+    if (!prep)
+        UpdateFrameDiff(channelData);
+
+    RunChannelOutputs(prep, channelData);
+
+    if (!prep)
+        ClearFrameDiff();
+}
+
+/*
+ * Run the output processors and then PrepData for all the outputs
+ */
+int PrepareChannelData(char *channelData) {
+    ProcessChannelData(channelData);
+    PrepareChannelOutputs(channelData);
+    return 0;
+}
+
+/*
+ * Run the output processors over the channel data
+ */
+int ProcessChannelData(char *channelData) {
+    long long start = GetTime();
+    outputProcessors.ProcessData((unsigned char *)channelData);
+    RecordFrameStage(FRAME_STAGE_PROCESSORS, GetTime() - start);
+    return 0;
+}
+
+/*
+ * Let the outputs prepare their data for the next SendData
+ */
+int PrepareChannelOutputs(char *channelData) {
+    long long start = GetTime();
+    DispatchChannelOutputs(true, (unsigned char *)channelData);
+    RecordFrameStage(FRAME_STAGE_PREP, GetTime() - start);
     return 0;
 }
 
@@ -565,9 +803,15 @@ int PrepareChannelData(char *channelData) {
  *
  */
 int SendChannelData(const char *channelData) {
-	int i = 0;
-	FPPChannelOutputInstance *inst;
+	SendChannelOutputs(channelData);
+	AdvanceChannelOutputFrame();
+	return 0;
+}
 
+/*
+ * Send the channel data to all the outputs without advancing the frame
+ */
+int SendChannelOutputs(const char *channelData) {
 	if (logMask & VB_CHANNELDATA) {
         uint32_t minimumNeededChannel = GetOutputRanges()[0].first;
         char buf[128];
@@ -575,25 +819,21 @@ int SendChannelData(const char *channelData) {
 		HexDump(buf, &channelData[minimumNeededChannel], 16);
 	}
 
-    for (i = 0; i < channelOutputCount; i++) {
-        inst = &channelOutputs[i];
-        if (inst->outputOld) {
-            inst->outputOld->send(
-                    inst->privData,
-                    channelData + inst->startChannel,
-                    inst->channelCount < (FPPD_MAX_CHANNELS - inst->startChannel) ? inst->channelCount : (FPPD_MAX_CHANNELS - inst->startChannel));
-        } else if (inst->output) {
-            inst->output->SendData((unsigned char *)(channelData + inst->startChannel));
-        }
-    }
-
+    long long start = GetTime();
+    DispatchChannelOutputs(false, (unsigned char *)channelData);
+    RecordFrameStage(FRAME_STAGE_SEND, GetTime() - start);
+    return 0;
+}
 
+/*
+ * Move on to the next output frame
+ */
+void AdvanceChannelOutputFrame(void) {
 	channelOutputFrame++;
 
 	// Reset channelOutputFrame every week @ 50ms timing
 	if (channelOutputFrame > 12096000)
 		channelOutputFrame = 0;
-    return 0;
 }
 
 /*
@@ -608,6 +848,9 @@ void StartOutputThreads(void) {
 			(channelOutputs[i].outputOld->startThread))
 			channelOutputs[i].outputOld->startThread(channelOutputs[i].privData);
 	}
+
+	if (outputWorkers.empty())
+		StartChannelOutputWorkers();
 }
 
 /*
@@ -617,6 +860,8 @@ void StopOutputThreads(void) {
 	FPPChannelOutputInstance *output;
 	int i = 0;
 
+	StopChannelOutputWorkers();
+
 	for (i = 0; i < channelOutputCount; i++) {
 		if ((channelOutputs[i].outputOld) &&
 			(channelOutputs[i].outputOld->stopThread))
@@ -624,12 +869,51 @@ void StopOutputThreads(void) {
 	}
 }
 
+/*
+ * Per output timings for the http API
+ */
+void GetChannelOutputTimings(Json::Value &result) {
+	Json::Value outputs(Json::arrayValue);
+
+	for (int i = 0; i < channelOutputCount; i++) {
+		ChannelOutputTiming &t = channelOutputTimings[i];
+		Json::Value output;
+
+		output["index"] = i;
+		output["type"] = t.type;
+		output["startChannel"] = channelOutputs[i].startChannel + 1;
+		output["channelCount"] = channelOutputs[i].channelCount;
+		output["ordered"] = channelOutputs[i].ordered ? true : false;
+		t.prepTimes.GetJSON(output["prepTimes"]);
+		t.sendTimes.GetJSON(output["sendTimes"]);
+		if (channelOutputs[i].output)
+			channelOutputs[i].output->GetOutputStats(output);
+
+		outputs.append(output);
+	}
+
+	result["outputThreads"] = (int)outputWorkers.size() + 1;
+	result["outputs"] = outputs;
+}
+
+/*
+ * Clear the per output timings, along with ResetOutputMetrics()
+ */
+void ResetChannelOutputTimings(void) {
+	for (int i = 0; i < channelOutputCount; i++) {
+		channelOutputTimings[i].prepTimes.Reset();
+		channelOutputTimings[i].sendTimes.Reset();
+	}
+}
+
 /*
  *
  */
 int CloseChannelOutputs(void) {
 	int i = 0;
 
+	StopChannelOutputWorkers();
+
 	for (i = 0; i < channelOutputCount; i++) {
 		if (channelOutputs[i].outputOld)
 			channelOutputs[i].outputOld->close(channelOutputs[i].privData);
@@ -646,6 +930,11 @@ int CloseChannelOutputs(void) {
             channelOutputs[i].output = NULL;
         }
     }
+
+    parallelOutputs.clear();
+    orderedOutputs.clear();
+
+    CloseFrameDiff();
 }
 
 
@@ -30,6 +30,8 @@
 #include <vector>
 #include <stdint.h>
 
+#include <jsoncpp/json/json.h>
+
 #define FPPD_MAX_CHANNEL_OUTPUTS   64
 
 class ChannelOutputBase;
@@ -52,6 +54,7 @@ typedef struct fppChannelOutputInstance {
 	FPPChannelOutput *outputOld;
 	ChannelOutputBase *output;
 	void             *privData;
+	int               ordered;  // run in config order on the output thread
 } FPPChannelOutputInstance;
 
 extern char            channelData[];
@@ -62,12 +65,18 @@ extern OutputProcessors outputProcessors;
 
 int  InitializeChannelOutputs(void);
 int  PrepareChannelData(char *channelData);
+int  ProcessChannelData(char *channelData);
+int  PrepareChannelOutputs(char *channelData);
 int  SendChannelData(const char *channelData);
+int  SendChannelOutputs(const char *channelData);
+void AdvanceChannelOutputFrame(void);
 int  CloseChannelOutputs(void);
 void SetChannelOutputFrameNumber(int frameNumber);
 void ResetChannelOutputFrameNumber(void);
 void StartOutputThreads(void);
 void StopOutputThreads(void);
+void GetChannelOutputTimings(Json::Value &result);
+void ResetChannelOutputTimings(void);
 
 const std::vector<std::pair<uint32_t, uint32_t>> GetOutputRanges();
 
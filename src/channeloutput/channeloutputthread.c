@@ -28,24 +28,29 @@
 #include <signal.h>
 #include <stdio.h>
 #include <string.h>
-#include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 
+#include <atomic>
+
 #include "channeloutput.h"
 #include "common.h"
+#include "e131bridge.h"
 #include "effects.h"
 #include "fppd.h"
 #include "log.h"
 #include "MultiSync.h"
+#include "OutputMetrics.h"
 #include "PixelOverlay.h"
 #include "Sequence.h"
 #include "settings.h"
+#include "Threads.h"
 
 /* used by external sync code */
 int   RefreshRate = 20;
 int   DefaultLightDelay = 0;
 int   LightDelay = 0;
-volatile int FrameSkip = 0;
+std::atomic<int> FrameSkip(0);
 int   MasterFramesPlayed = -1;
 int   OutputFrames = 1;
 float mediaOffset = 0.0;
@@ -56,8 +61,32 @@ int       RunThread = 0;
 int       ThreadIsRunning = 0;
 
 
+// outputThreadLock is only held around the wait for the next frame so a
+// forced frame can't slip in between checking ForceOutput and waiting
+pthread_once_t   outputThreadLockOnce = PTHREAD_ONCE_INIT;
 pthread_mutex_t  outputThreadLock;
 pthread_cond_t   outputThreadCond;
+std::atomic<int> ForceOutput(0);
+
+/*
+ * Pipelined output.  The sequence read thread reads frames ahead, the
+ * process thread reads and processes frame N+1 (effects, overlays, output
+ * processors) into another channel data buffer while the output thread
+ * preps and sends frame N.  The frame time is then the slowest of the
+ * stages instead of the sum of them.
+ */
+int              PipelineOutput = 0;
+pthread_t        ProcessThreadID;
+pthread_mutex_t  processThreadLock;
+pthread_cond_t   processThreadCond;
+int              RunProcessThread = 0;
+int              ProcessRequested = 0;
+unsigned long    processFrame = 0;      // frame and skip taken by the output
+int              processFrameSkip = 0;  // thread for each process request
+char            *processSeqData = NULL; // buffer the process thread processed
+long long        processStartTime = 0;
+long long        processReadTime = 0;
+long long        processEndTime = 0;
 
 
 /* prototypes for functions below */
@@ -86,12 +115,144 @@ void EnableChannelOutput(void) {
 	OutputFrames = 1;
 }
 
+/*
+ * Set up the output thread lock and condition.  This runs once, the lock
+ * is used from other threads while the output thread is waiting on it.
+ */
+static void InitChannelOutputThreadLock(void) {
+    // The frame deadlines are on the monotonic clock so they do not move
+    // when NTP or the user sets the time
+    pthread_condattr_t condAttr;
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+
+    pthread_mutex_init(&outputThreadLock, NULL);
+    pthread_cond_init(&outputThreadCond, &condAttr);
+    pthread_condattr_destroy(&condAttr);
+}
+
 void ForceChannelOutputNow(void) {
     LogDebug(VB_CHANNELOUT, "ForceChannelOutputNow()\n");
+    pthread_once(&outputThreadLockOnce, InitChannelOutputThreadLock);
+    pthread_mutex_lock(&outputThreadLock);
+    ForceOutput = 1;
     pthread_cond_signal(&outputThreadCond);
+    pthread_mutex_unlock(&outputThreadLock);
+}
+
+
+
+/*
+ * Read the next frame and process it.  frame and frameSkip are taken by
+ * the output thread as the process thread can't safely read them.  Returns
+ * the processed buffer, which is the one to send.
+ */
+char *ReadAndProcessNextFrame(int prepOutputs, unsigned long frame, int frameSkip,
+	long long *readTime)
+{
+	long long startTime = GetMonotonicTime();
+
+	if (getFPPmode() != BRIDGE_MODE) {
+		if (frameSkip) {
+			CountSkippedFrames(frameSkip);
+			sequence->SeekSequenceFile(frame + frameSkip + 1);
+		}
+		sequence->ReadSequenceData();
+	} else {
+		sequence->ReadBridgeData();
+	}
+
+	*readTime = GetMonotonicTime();
+	RecordFrameStage(FRAME_STAGE_READ, *readTime - startTime);
+	return sequence->ProcessSequenceData(1000.0 * frame / RefreshRate, 1, prepOutputs);
 }
 
+/*
+ * Process stage of the pipelined output loop
+ */
+void *RunChannelProcessThread(void *data)
+{
+	(void)data;
+
+	SetThreadRole(THREAD_ROLE_PROCESS, "fpp-process");
+
+	pthread_mutex_lock(&processThreadLock);
+	while (RunProcessThread) {
+		if (!ProcessRequested) {
+			pthread_cond_wait(&processThreadCond, &processThreadLock);
+			continue;
+		}
+		unsigned long frame = processFrame;
+		int frameSkip = processFrameSkip;
+		pthread_mutex_unlock(&processThreadLock);
+
+		long long readTime;
+		long long startTime = GetMonotonicTime();
+		char *seqData = ReadAndProcessNextFrame(0, frame, frameSkip, &readTime);
+		long long endTime = GetMonotonicTime();
+
+		pthread_mutex_lock(&processThreadLock);
+		processSeqData = seqData;
+		processStartTime = startTime;
+		processReadTime = readTime;
+		processEndTime = endTime;
+		ProcessRequested = 0;
+		pthread_cond_broadcast(&processThreadCond);
+	}
+	pthread_mutex_unlock(&processThreadLock);
+
+	return NULL;
+}
+
+void StartProcessThread(void)
+{
+	pthread_mutex_init(&processThreadLock, NULL);
+	pthread_cond_init(&processThreadCond, NULL);
+
+	RunProcessThread = 1;
+	ProcessRequested = 0;
+	if (pthread_create(&ProcessThreadID, NULL, &RunChannelProcessThread, NULL)) {
+		LogErr(VB_CHANNELOUT, "ERROR creating channel process thread, not pipelining output\n");
+		RunProcessThread = 0;
+		PipelineOutput = 0;
+	}
+}
+
+void StopProcessThread(void)
+{
+	pthread_mutex_lock(&processThreadLock);
+	RunProcessThread = 0;
+	pthread_cond_broadcast(&processThreadCond);
+	pthread_mutex_unlock(&processThreadLock);
+
+	pthread_join(ProcessThreadID, NULL);
+	pthread_cond_destroy(&processThreadCond);
+	pthread_mutex_destroy(&processThreadLock);
+}
+
+void StartProcessingNextFrame(void)
+{
+	pthread_mutex_lock(&processThreadLock);
+	processFrame = channelOutputFrame;
+	processFrameSkip = FrameSkip.exchange(0);
+	ProcessRequested = 1;
+	pthread_cond_broadcast(&processThreadCond);
+	pthread_mutex_unlock(&processThreadLock);
+}
+
+char *WaitForNextFrame(long long *readTime, long long *processTime)
+{
+	pthread_mutex_lock(&processThreadLock);
+	while (ProcessRequested)
+		pthread_cond_wait(&processThreadCond, &processThreadLock);
+
+	char *seqData = processSeqData;
+	*readTime = processReadTime - processStartTime;
+	*processTime = processEndTime - processReadTime;
+	pthread_mutex_unlock(&processThreadLock);
 
+	return seqData;
+}
 
 /*
  * Main loop in channel output thread
@@ -101,20 +262,27 @@ void *RunChannelOutputThread(void *data)
 	(void)data;
 
 	static long long lastStatTime = 0;
+	long long lastStartTime = 0;
 	long long startTime;
 	long long sendTime;
 	long long readTime;
     long long processTime;
 	int onceMore = 0;
 	struct timespec ts;
-    struct timeval tv;
 	int syncFrameCounter = 99; //set high so first frame sends sync immediately
+	char *nextSeqData = NULL; // buffer processed for the next frame
 
 	LogDebug(VB_CHANNELOUT, "RunChannelOutputThread() starting\n");
 
+	SetThreadRole(THREAD_ROLE_OUTPUT, "fpp-output");
+
 	ThreadIsRunning = 1;
     StartOutputThreads();
 
+	PipelineOutput = getSettingInt("PipelineChannelOutput");
+	if (PipelineOutput)
+		StartProcessThread();
+
 	if ((getFPPmode() == REMOTE_MODE) &&
 		(!IsEffectRunning()) &&
 		(!UsingMemoryMapInput()) &&
@@ -134,10 +302,30 @@ void *RunChannelOutputThread(void *data)
 			RunThread = 0;
 	}
 
-    pthread_mutex_lock(&outputThreadLock);
+	// Frame schedule.  Frame N of the schedule is due at
+	// clockBase + N * clockStep + clockCorrection, where the correction is
+	// the sum of the MultiSync adjustments (LightDelay - DefaultLightDelay)
+	// made since clockBase.  Working the deadline out from the frame count
+	// means wakeup latency and rounding never accumulate into drift.
+	long long clockBase = 0;
+	long long clockFrames = 0;
+	long long clockCorrection = 0;
+	int       clockStep = 0;
+	long long deadline = 0;
+	long long lastDeadline = 0;
+	long long jitter = 0;
 
 	while (RunThread) {
-		startTime = GetTime();
+		startTime = GetMonotonicTime();
+		if (lastStartTime)
+			RecordFrameStage(FRAME_STAGE_INTERVAL, startTime - lastStartTime);
+		if (deadline && lastDeadline) {
+			jitter = (startTime - lastStartTime) - (deadline - lastDeadline);
+			if (jitter < 0)
+				jitter = -jitter;
+			RecordFrameStage(FRAME_STAGE_JITTER, jitter);
+		}
+		lastStartTime = startTime;
 
 		if ((getFPPmode() == MASTER_MODE) &&
 			(sequence->IsSequenceRunning())) {
@@ -155,11 +343,17 @@ void *RunChannelOutputThread(void *data)
 			}
 		}
 
+        char *seqData = NULL;
         if (OutputFrames) {
-            if (!sequence->isDataProcessed()) {
+            if ((getFPPmode() == BRIDGE_MODE) && (Bridge_FrameLatched())) {
+                // a sync packet or push latched a frame since the last
+                // read, send it now instead of on the next frame
+                sequence->ReadBridgeData();
+            }
+            if (!sequence->isDataProcessed() || !nextSeqData) {
                 //first time through or immediately after sequence load, the data might not be
                 //processed yet, need to do it
-                sequence->ProcessSequenceData(1000.0 * channelOutputFrame / RefreshRate, 1);
+                nextSeqData = sequence->ProcessSequenceData(1000.0 * channelOutputFrame / RefreshRate, 1, !PipelineOutput);
             }
             if (getFPPmode() == REMOTE_MODE && !IsEffectRunning()) {
                 // Sleep about 1 seconds waiting for the master
@@ -169,23 +363,34 @@ void *RunChannelOutputThread(void *data)
                     loops++;
                 }
             }
-			sequence->SendSequenceData();
-        }
-
-		sendTime = GetTime();
-
-        if (getFPPmode() != BRIDGE_MODE) {
-            if (FrameSkip) {
-                sequence->SeekSequenceFile(channelOutputFrame + FrameSkip + 1);
-                FrameSkip = 0;
+            if (PipelineOutput) {
+                // the next frame is read into a different buffer so hold
+                // on to this one and move the frame counter on before the
+                // read sets it from the sequence
+                seqData = nextSeqData;
+                AdvanceChannelOutputFrame();
+            } else {
+                sequence->SendSequenceData(nextSeqData, 0);
             }
-            sequence->ReadSequenceData();
         }
 
-        readTime = GetTime();
-		sequence->ProcessSequenceData(1000.0 * channelOutputFrame / RefreshRate, 1);
-
-		processTime = GetTime();
+        if (PipelineOutput) {
+            StartProcessingNextFrame();
+            if (seqData)
+                sequence->SendSequenceData(seqData, 1);
+            sendTime = GetMonotonicTime();
+
+            long long readDuration, processDuration;
+            nextSeqData = WaitForNextFrame(&readDuration, &processDuration);
+
+            // report the time each stage took
+            readTime = sendTime + readDuration;
+            processTime = readTime + processDuration;
+        } else {
+            sendTime = GetMonotonicTime();
+            nextSeqData = ReadAndProcessNextFrame(1, channelOutputFrame, FrameSkip.exchange(0), &readTime);
+            processTime = GetMonotonicTime();
+        }
 
 		if ((sequence->IsSequenceRunning()) ||
 			(IsEffectRunning()) ||
@@ -197,7 +402,12 @@ void *RunChannelOutputThread(void *data)
             // REMOTE mode keeps looping a few extra times before we blank
             onceMore = (getFPPmode() == REMOTE_MODE) ? 8 : 1;
 
-            int sleepTime = LightDelay - (processTime - startTime);
+            long long workTime = GetMonotonicTime() - startTime;
+            int sleepTime = LightDelay - workTime;
+            RecordFrameStage(FRAME_STAGE_WORK, workTime);
+            if (sleepTime < 0)
+                CountLateFrame();
+
 			if ((channelOutputFrame <= 1) || (sleepTime <= 0) || (startTime > (lastStatTime + 1000000))) {
 				if (sleepTime < 0)
 					sleepTime = 0;
@@ -205,12 +415,12 @@ void *RunChannelOutputThread(void *data)
                     lastStatTime = startTime;
                 }
 				LogDebug(VB_CHANNELOUT,
-                         "Output Thread: Loop: %dus, Send: %lldus, Read: %lldus, Process: %lldus, Sleep: %dus, FrameNum: %ld\n",
+                         "Output Thread: Loop: %dus, Send: %lldus, Read: %lldus, Process: %lldus, Sleep: %dus, Jitter: %lldus, FrameNum: %ld\n",
 					LightDelay,
                     sendTime - startTime,
 					readTime - sendTime,
                     processTime - readTime, 
-                    sleepTime, channelOutputFrame);
+                    sleepTime, jitter, channelOutputFrame);
 			}
 		}
 		else
@@ -223,28 +433,53 @@ void *RunChannelOutputThread(void *data)
 				RunThread = 0;
 		}
 
-		// Calculate how long we need to nanosleep()
-		long dt = (LightDelay - (GetTime() - startTime)) * 1000;
-		if (dt > 0)
-		{
-			gettimeofday(&tv, NULL);
-			ts.tv_sec = tv.tv_sec;
-			ts.tv_nsec = tv.tv_usec * 1000 + dt;
-
-			if (ts.tv_nsec >= 1000000000)
-			{
-				ts.tv_sec  += 1;
-				ts.tv_nsec -= 1000000000;
-			}
+		// Work out when the next frame is due, starting a new schedule
+		// the first time through and when the frame rate changes
+		if ((!clockBase) || (clockStep != DefaultLightDelay)) {
+			clockBase = startTime;
+			clockFrames = 0;
+			clockCorrection = 0;
+			clockStep = DefaultLightDelay;
+		}
 
-			if (pthread_cond_timedwait(&outputThreadCond, &outputThreadLock, &ts) != ETIMEDOUT) {
-				LogDebug(VB_CHANNELOUT, "Forced output\n");
-			}
-        }
+		clockFrames++;
+		clockCorrection += LightDelay - DefaultLightDelay;
+
+		lastDeadline = deadline;
+		deadline = clockBase + (clockFrames * clockStep) + clockCorrection;
+
+		long long now = GetMonotonicTime();
+		if (deadline < (now - clockStep)) {
+			// More than a frame behind, start over from the next frame
+			// instead of sending a burst of frames to catch up
+			clockBase = 0;
+			deadline = 0;
+		} else if ((deadline > now) && (!ForceOutput)) {
+			ts.tv_sec = deadline / 1000000;
+			ts.tv_nsec = (deadline % 1000000) * 1000;
+
+			int rc = 0;
+			pthread_mutex_lock(&outputThreadLock);
+			while ((rc != ETIMEDOUT) && (!ForceOutput))
+				rc = pthread_cond_timedwait(&outputThreadCond, &outputThreadLock, &ts);
+			pthread_mutex_unlock(&outputThreadLock);
+
+			if (rc == ETIMEDOUT)
+				RecordFrameStage(FRAME_STAGE_OVERSHOOT, GetMonotonicTime() - deadline);
+		}
+
+		if (ForceOutput.exchange(0)) {
+			LogDebug(VB_CHANNELOUT, "Forced output\n");
+
+			// the forced frame starts a new schedule
+			clockBase = 0;
+			deadline = 0;
+		}
 	}
 
+	if (PipelineOutput)
+		StopProcessThread();
 	StopOutputThreads();
-    pthread_mutex_unlock(&outputThreadLock);
 
 	ThreadIsRunning = 0;
 
@@ -268,18 +503,6 @@ void SetChannelOutputRefreshRate(int rate)
 int StartChannelOutputThread(void)
 {
 	LogDebug(VB_CHANNELOUT, "StartChannelOutputThread()\n");
-    
-    pthread_mutex_init(&outputThreadLock, NULL);
-    pthread_cond_init(&outputThreadCond, NULL);
-
-	int E131BridgingInterval = getSettingInt("E131BridgingInterval");
-
-	if ((getFPPmode() == BRIDGE_MODE) && (E131BridgingInterval))
-		DefaultLightDelay = E131BridgingInterval * 1000;
-	else
-		DefaultLightDelay = 1000000 / RefreshRate;
-
-	LightDelay = DefaultLightDelay;
 
 	if (ChannelOutputThreadIsRunning())
 	{
@@ -292,6 +515,18 @@ int StartChannelOutputThread(void)
 		}
 	}
 
+	pthread_once(&outputThreadLockOnce, InitChannelOutputThreadLock);
+	ForceOutput = 0;
+
+	int E131BridgingInterval = getSettingInt("E131BridgingInterval");
+
+	if ((getFPPmode() == BRIDGE_MODE) && (E131BridgingInterval))
+		DefaultLightDelay = E131BridgingInterval * 1000;
+	else
+		DefaultLightDelay = 1000000 / RefreshRate;
+
+	LightDelay = DefaultLightDelay;
+
 	int mediaOffsetInt = getSettingInt("mediaOffset");
 	if (mediaOffsetInt)
 		mediaOffset = (float)mediaOffsetInt * 0.001;
@@ -19,6 +19,7 @@
 #include <cmath>
 
 #include "BrightnessOutputProcessor.h"
+#include "OutputKernels.h"
 #include "log.h"
 
 BrightnessOutputProcessor::BrightnessOutputProcessor(const Json::Value &config) {
@@ -57,7 +58,5 @@ BrightnessOutputProcessor::~BrightnessOutputProcessor() {
 }
 
 void BrightnessOutputProcessor::ProcessData(unsigned char *channelData) const {
-    for (int x = 0; x < count; x++) {
-        channelData[start + x] = table[channelData[start + x]];
-    }
+    ApplyValueMap(channelData + start, count, table);
 }
@@ -34,6 +34,12 @@ public:
         max = start + count - 1;
     }
 
+    virtual const unsigned char *GetValueMap(int &s, int &c) const {
+        s = start;
+        c = count;
+        return table;
+    }
+
 protected:
     int start;
     int count;
@@ -18,6 +18,7 @@
 #include <string.h>
 
 #include "ColorOrderOutputProcessor.h"
+#include "OutputKernels.h"
 #include "log.h"
 
 ColorOrderOutputProcessor::ColorOrderOutputProcessor(const Json::Value &config) {
@@ -29,6 +30,15 @@ ColorOrderOutputProcessor::ColorOrderOutputProcessor(const Json::Value &config)
     LogInfo(VB_CHANNELOUT, "Color Order:   %d-%d => %d\n",
             start, start + (count*3) - 1,
             order);
+
+    switch (order) {
+        case 132: colorOrder = kColorOrderRBG; break;
+        case 213: colorOrder = kColorOrderGRB; break;
+        case 231: colorOrder = kColorOrderGBR; break;
+        case 312: colorOrder = kColorOrderBRG; break;
+        case 321: colorOrder = kColorOrderBGR; break;
+        default:  colorOrder = kColorOrderRGB; break;
+    }
     
     //channel numbers need to be 0 based
     --start;
@@ -39,34 +49,5 @@ ColorOrderOutputProcessor::~ColorOrderOutputProcessor() {
 }
 
 void ColorOrderOutputProcessor::ProcessData(unsigned char *channelData) const {
-    int cur = start;
-    for (int x = 0; x < count; x++, cur += 3) {
-        int a = channelData[cur];
-        int b = channelData[cur + 1];
-        int c = channelData[cur + 2];
-        switch (order) {
-            case 132:
-                channelData[cur + 1] = c;
-                channelData[cur + 2] = b;
-                break;
-            case 213:
-                channelData[cur] = b;
-                channelData[cur + 1] = a;
-                break;
-            case 231:
-                channelData[cur] = b;
-                channelData[cur + 1] = c;
-                channelData[cur + 2] = a;
-                break;
-            case 312:
-                channelData[cur] = c;
-                channelData[cur + 1] = a;
-                channelData[cur + 2] = b;
-                break;
-            case 321:
-                channelData[cur] = c;
-                channelData[cur + 2] = a;
-                break;
-        }
-    }
+    ReorderRGB(channelData + start, channelData + start, count, colorOrder);
 }
@@ -19,6 +19,7 @@
 #define _COLORORDEROUTPUTPROCESSOR_H
 
 #include "OutputProcessor.h"
+#include "ColorOrder.h"
 
 class ColorOrderOutputProcessor : public OutputProcessor {
 public:
@@ -38,6 +39,7 @@ protected:
     int start;
     int count;
     int order;
+    FPPColorOrder colorOrder;
 };
 
 #endif
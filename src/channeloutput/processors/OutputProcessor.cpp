@@ -14,6 +14,8 @@
  *   You should have received a copy of the GNU General Public License
  *   along with this program; if not, see <http://www.gnu.org/licenses/>.
  */
+#include <thread>
+
 #include "OutputProcessor.h"
 
 #include "RemapOutputProcessor.h"
@@ -23,22 +25,47 @@
 #include "log.h"
 
 
-OutputProcessors::OutputProcessors() {
+OutputProcessors::OutputProcessors() : current(new ProcessorSet()), readEpoch(0) {
+    readers[0] = 0;
+    readers[1] = 0;
 }
 OutputProcessors::~OutputProcessors() {
-    for (OutputProcessor *a : processors) {
+    ProcessorSet *set = current.load();
+    for (OutputProcessor *a : set->processors) {
         delete a;
     }
-    processors.clear();
+    delete set;
 }
 
 void OutputProcessors::ProcessData(unsigned char *channelData) const {
-    std::lock_guard<std::mutex> lock(processorsLock);
-    for (OutputProcessor *a : processors) {
-        if (a->isActive()) {
-            a->ProcessData(channelData);
+    // Edits wait for frames counted in readers to finish before freeing
+    // the set they replaced, so the set can't go away while we use it
+    int epoch = readEpoch.load();
+    readers[epoch]++;
+    current.load()->plan.execute(channelData);
+    readers[epoch]--;
+}
+
+// Must be called with processorsLock held
+void OutputProcessors::publish(const std::list<OutputProcessor*> &processors) {
+    ProcessorSet *set = new ProcessorSet();
+    set->processors = processors;
+    set->plan.compile(set->processors);
+
+    ProcessorSet *old = current.exchange(set);
+
+    // Frames that start from here on see the new set.  A frame still using
+    // the old one may be counted under either epoch, so flip the epoch and
+    // wait for the count of the one new frames no longer use to drain,
+    // twice.  New frames never hold up the wait.
+    for (int x = 0; x < 2; x++) {
+        int epoch = readEpoch.load();
+        readEpoch.store(epoch ^ 1);
+        while (readers[epoch].load()) {
+            std::this_thread::yield();
         }
     }
+    delete old;
 }
 
 void OutputProcessors::addProcessor(OutputProcessor*p) {
@@ -46,37 +73,61 @@ void OutputProcessors::addProcessor(OutputProcessor*p) {
         return;
     }
     std::lock_guard<std::mutex> lock(processorsLock);
+    std::list<OutputProcessor*> processors = current.load()->processors;
     processors.push_back(p);
+    publish(processors);
 }
 void OutputProcessors::removeProcessor(OutputProcessor*p) {
     std::lock_guard<std::mutex> lock(processorsLock);
+    std::list<OutputProcessor*> processors = current.load()->processors;
     processors.remove(p);
+    publish(processors);
 }
 void OutputProcessors::removeAll() {
     std::lock_guard<std::mutex> lock(processorsLock);
-    for (OutputProcessor *a : processors) {
+    std::list<OutputProcessor*> old = current.load()->processors;
+    publish(std::list<OutputProcessor*>());
+    for (OutputProcessor *a : old) {
         delete a;
     }
-    processors.clear();
 }
 
 void OutputProcessors::loadFromJSON(const Json::Value &config, bool clear) {
-    if (clear) {
-        removeAll();
-    }
+    std::list<OutputProcessor*> added;
     for( Json::Value::const_iterator itr = config.begin() ; itr != config.end() ; itr++ ) {
         std::string name = itr.key().asString();
         if (name == "outputProcessors") {
             Json::Value val = *itr;
             if (val.isArray()) {
                 for (int x = 0; x < val.size(); x++) {
-                    addProcessor(create(val[x]));
+                    OutputProcessor *p = create(val[x]);
+                    if (p) {
+                        added.push_back(p);
+                    }
                 }
             } else {
-                addProcessor(create(val));
+                OutputProcessor *p = create(val);
+                if (p) {
+                    added.push_back(p);
+                }
             }
         }
     }
+
+    // swap in the whole new config at once
+    std::lock_guard<std::mutex> lock(processorsLock);
+    std::list<OutputProcessor*> old;
+    std::list<OutputProcessor*> processors;
+    if (clear) {
+        old = current.load()->processors;
+    } else {
+        processors = current.load()->processors;
+    }
+    processors.splice(processors.end(), added);
+    publish(processors);
+    for (OutputProcessor *a : old) {
+        delete a;
+    }
 }
 OutputProcessor *OutputProcessors::create(const Json::Value &config) {
     std::string type = config["type"].asString();
@@ -97,7 +148,7 @@ OutputProcessor *OutputProcessors::create(const Json::Value &config) {
 
 OutputProcessor *OutputProcessors::find(std::function<bool(OutputProcessor*)> f) const {
     std::lock_guard<std::mutex> lock(processorsLock);
-    for (OutputProcessor *a : processors) {
+    for (OutputProcessor *a : current.load()->processors) {
         if (f(a)) {
             return a;
         }
@@ -109,7 +160,8 @@ void OutputProcessors::GetRequiredChannelRange(int &min, int & max) {
     min = FPPD_MAX_CHANNELS;
     max = 0;
     int m1, m2;
-    for (OutputProcessor *a : processors) {
+    std::lock_guard<std::mutex> lock(processorsLock);
+    for (OutputProcessor *a : current.load()->processors) {
         a->GetRequiredChannelRange(m1, m2);
         min = std::min(min, m1);
         max = std::max(max, m2);
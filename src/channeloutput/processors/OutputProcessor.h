@@ -21,10 +21,12 @@
 #include <string>
 #include <list>
 #include <mutex>
+#include <atomic>
 #include <functional>
 #include <jsoncpp/json/json.h>
 
 #include "../../Sequence.h"
+#include "OutputProcessorPlan.h"
 
 class OutputProcessor {
 public:
@@ -44,6 +46,13 @@ public:
     virtual void GetRequiredChannelRange(int &min, int & max) {
         min = 0; max = FPPD_MAX_CHANNELS;
     }
+
+    // Processors that only replace each channel's value using a lookup
+    // table return the table and the (0 based) channel range it applies
+    // to so they can be merged into an OutputProcessorPlan
+    virtual const unsigned char *GetValueMap(int &start, int &count) const {
+        return nullptr;
+    }
 protected:
     std::string description;
     bool active;
@@ -66,11 +75,23 @@ public:
     
     void GetRequiredChannelRange(int &min, int & max);
 protected:
+    // The processors and the plan compiled from them.  A set is never
+    // changed once it is published, edits build a new set and swap it in
+    // so ProcessData never has to wait on an edit.
+    class ProcessorSet {
+    public:
+        std::list<OutputProcessor*> processors;
+        OutputProcessorPlan plan;
+    };
+
     void removeAll();
+    void publish(const std::list<OutputProcessor*> &processors);
     OutputProcessor *create(const Json::Value &config);
     
-    mutable std::mutex processorsLock;
-    std::list<OutputProcessor*> processors;
+    mutable std::mutex processorsLock; // serializes edits
+    std::atomic<ProcessorSet*> current;
+    std::atomic<int> readEpoch;
+    mutable std::atomic<int> readers[2]; // frames running, per readEpoch
 };
 
 #endif /* #ifndef _OUTPUTPROCESSOR_H */
@@ -0,0 +1,201 @@
+/*
+ *   OutputProcessorPlan class for Falcon Player (FPP)
+ *
+ *   The Falcon Player (FPP) is free software; you can redistribute it
+ *   and/or modify it under the terms of the GNU General Public License
+ *   as published by the Free Software Foundation; either version 2 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string.h>
+#include <algorithm>
+
+#include "OutputProcessorPlan.h"
+#include "OutputProcessor.h"
+#include "RemapOutputProcessor.h"
+#include "OutputKernels.h"
+#include "log.h"
+
+OutputProcessorPlan::OutputProcessorPlan() {
+}
+OutputProcessorPlan::~OutputProcessorPlan() {
+}
+
+void OutputProcessorPlan::compile(const std::list<OutputProcessor*> &processors) {
+    steps.clear();
+    tables.clear();
+
+    std::vector<ValueMap> maps;
+    for (OutputProcessor *p : processors) {
+        if (!p->isActive()) {
+            continue;
+        }
+
+        ValueMap m;
+        m.table = p->GetValueMap(m.start, m.count);
+        if (m.table) {
+            if (m.count > 0) {
+                maps.push_back(m);
+            }
+            continue;
+        }
+
+        // anything else has to see the result of the maps before it
+        compileValueMaps(maps);
+        maps.clear();
+
+        if (p->getType() == OutputProcessor::REMAP && ((RemapOutputProcessor*)p)->getReverse() == 0) {
+            RemapOutputProcessor *rp = (RemapOutputProcessor*)p;
+            for (int l = 0; l < rp->getLoops(); l++) {
+                addCopy(rp->getSourceChannel(), rp->getDestChannel() + (l * rp->getCount()), rp->getCount());
+            }
+        } else {
+            Step s;
+            memset(&s, 0, sizeof(s));
+            s.type = Step::PROCESSOR;
+            s.processor = p;
+            steps.push_back(s);
+        }
+    }
+    compileValueMaps(maps);
+
+    LogDebug(VB_CHANNELOUT, "Compiled %d output processors into %d steps using %d value tables\n",
+             (int)processors.size(), (int)steps.size(), (int)tables.size());
+}
+
+// Applying the tables for every map covering a channel, in order, is the
+// same as applying the composition of those tables once.  Split the
+// channels at every map boundary so each piece is covered by the same set
+// of maps and compose the tables for each piece.
+void OutputProcessorPlan::compileValueMaps(const std::vector<ValueMap> &maps) {
+    if (maps.empty()) {
+        return;
+    }
+
+    std::vector<int> bounds;
+    for (auto &m : maps) {
+        bounds.push_back(m.start);
+        bounds.push_back(m.start + m.count);
+    }
+    std::sort(bounds.begin(), bounds.end());
+    bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+
+    size_t firstStep = steps.size();
+    unsigned char table[256];
+    for (int b = 0; (b + 1) < bounds.size(); b++) {
+        int start = bounds[b];
+        int end = bounds[b + 1];
+
+        bool covered = false;
+        for (int x = 0; x < 256; x++) {
+            table[x] = x;
+        }
+        for (auto &m : maps) {
+            if (m.start <= start && end <= (m.start + m.count)) {
+                for (int x = 0; x < 256; x++) {
+                    table[x] = m.table[table[x]];
+                }
+                covered = true;
+            }
+        }
+        if (!covered) {
+            continue;
+        }
+
+        Step s;
+        memset(&s, 0, sizeof(s));
+        s.start = start;
+        s.count = end - start;
+        s.type = Step::FILL;
+        s.value = table[0];
+        for (int x = 1; x < 256; x++) {
+            if (table[x] != table[0]) {
+                s.type = Step::MAP;
+                s.value = addTable(table);
+                break;
+            }
+        }
+
+        // pieces next to each other with the same result are one step
+        if (steps.size() > firstStep) {
+            Step &last = steps.back();
+            if ((last.type == s.type) && (last.value == s.value)
+                && ((last.start + last.count) == s.start)) {
+                last.count += s.count;
+                continue;
+            }
+        }
+        steps.push_back(s);
+    }
+}
+
+void OutputProcessorPlan::addCopy(int src, int dst, int count) {
+    if (count <= 0) {
+        return;
+    }
+    if (!steps.empty()) {
+        // extend the previous copy if this one continues it and doing both
+        // at once can't change what either of them reads
+        Step &last = steps.back();
+        if ((last.type == Step::COPY)
+            && ((last.source + last.count) == src)
+            && ((last.start + last.count) == dst)) {
+            int mSrcEnd = src + count;
+            int mDstEnd = dst + count;
+            bool readsLastDest = (src < (last.start + last.count)) && (last.start < mSrcEnd);
+            bool overlaps = (last.source < mDstEnd) && (last.start < mSrcEnd);
+            if (!readsLastDest && !overlaps) {
+                last.count += count;
+                return;
+            }
+        }
+    }
+
+    Step s;
+    memset(&s, 0, sizeof(s));
+    s.type = Step::COPY;
+    s.source = src;
+    s.start = dst;
+    s.count = count;
+    steps.push_back(s);
+}
+
+int OutputProcessorPlan::addTable(const unsigned char *table) {
+    for (int x = 0; x < tables.size(); x++) {
+        if (!memcmp(&tables[x][0], table, 256)) {
+            return x;
+        }
+    }
+    tables.push_back(std::vector<unsigned char>(table, table + 256));
+    return tables.size() - 1;
+}
+
+void OutputProcessorPlan::execute(unsigned char *channelData) const {
+    for (const Step &s : steps) {
+        switch (s.type) {
+            case Step::FILL:
+                memset(channelData + s.start, s.value, s.count);
+                break;
+            case Step::MAP:
+                ApplyValueMap(channelData + s.start, s.count, &tables[s.value][0]);
+                break;
+            case Step::COPY:
+                if (s.count > 1) {
+                    memcpy(channelData + s.start, channelData + s.source, s.count);
+                } else {
+                    channelData[s.start] = channelData[s.source];
+                }
+                break;
+            case Step::PROCESSOR:
+                s.processor->ProcessData(channelData);
+                break;
+        }
+    }
+}
@@ -0,0 +1,71 @@
+/*
+ *   OutputProcessorPlan class for Falcon Player (FPP)
+ *
+ *   The Falcon Player (FPP) is free software; you can redistribute it
+ *   and/or modify it under the terms of the GNU General Public License
+ *   as published by the Free Software Foundation; either version 2 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _OUTPUTPROCESSORPLAN_H
+#define _OUTPUTPROCESSORPLAN_H
+
+#include <list>
+#include <vector>
+
+class OutputProcessor;
+
+// The list of output processors compiled into the steps needed to get the
+// same result.  Runs of processors that just map each channel's value
+// (brightness, set value) are merged into one table per channel range so
+// overlapping ranges are only touched once, and plain remaps become
+// memcpy's with adjacent remaps coalesced into a single copy.  Anything
+// else runs the processor itself.
+class OutputProcessorPlan {
+public:
+    OutputProcessorPlan();
+    ~OutputProcessorPlan();
+
+    void compile(const std::list<OutputProcessor*> &processors);
+    void execute(unsigned char *channelData) const;
+
+    bool empty() const { return steps.empty(); }
+
+private:
+    class ValueMap {
+    public:
+        int start;
+        int count;
+        const unsigned char *table;
+    };
+
+    class Step {
+    public:
+        enum StepType {
+            FILL, MAP, COPY, PROCESSOR
+        };
+        StepType type;
+        int start;          // destination channel
+        int count;
+        int source;         // COPY source channel
+        int value;          // FILL value or MAP table index
+        const OutputProcessor *processor;
+    };
+
+    void compileValueMaps(const std::vector<ValueMap> &maps);
+    void addCopy(int src, int dst, int count);
+    int  addTable(const unsigned char *table);
+
+    std::vector<Step> steps;
+    std::vector<std::vector<unsigned char>> tables;
+};
+
+#endif /* #ifndef _OUTPUTPROCESSORPLAN_H */
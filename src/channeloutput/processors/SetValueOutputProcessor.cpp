@@ -30,6 +30,8 @@ SetValueOutputProcessor::SetValueOutputProcessor(const Json::Value &config) {
             start, start + count - 1,
             value);
     
+    memset(table, value, sizeof(table));
+
     //channel numbers need to be 0 based
     --start;
 }
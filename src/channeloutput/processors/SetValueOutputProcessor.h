@@ -34,10 +34,17 @@ public:
         max = start + count - 1;
     }
 
+    virtual const unsigned char *GetValueMap(int &s, int &c) const {
+        s = start;
+        c = count;
+        return table;
+    }
+
 protected:
     int start;
     int count;
     int value;
+    unsigned char table[256];
 };
 
 #endif
@@ -111,6 +111,9 @@ int RPIWS281xOutput::Init(Json::Value config)
 
 		m_pixels += newString->m_outputChannels / 3;
 
+		if (newString->m_outputChannels > m_stringData.size())
+			m_stringData.resize(newString->m_outputChannels);
+
 		m_strings.push_back(newString);
 	}
 
@@ -180,27 +183,19 @@ void RPIWS281xOutput::GetRequiredChannelRange(int &min, int & max) {
 }
 void RPIWS281xOutput::PrepData(unsigned char *channelData)
 {
-	unsigned char *c = channelData;
-	unsigned int r = 0;
-	unsigned int g = 0;
-	unsigned int b = 0;
-
+	uint8_t *c = NULL;
 	PixelString *ps = NULL;
-	int inCh = 0;
 
 	for (int s = 0; s < m_strings.size(); s++)
 	{
 		ps = m_strings[s];
-		inCh = 0;
+		ps->GatherChannels(m_stringData.data(), channelData);
 
-		for (int p = 0, pix = 0; p < ps->m_outputChannels; pix++)
+		c = m_stringData.data();
+		for (int pix = 0; pix < (ps->m_outputChannels / 3); pix++, c += 3)
 		{
-			r = ps->m_brightnessMaps[p++][channelData[ps->m_outputMap[inCh++]]];
-			g = ps->m_brightnessMaps[p++][channelData[ps->m_outputMap[inCh++]]];
-			b = ps->m_brightnessMaps[p++][channelData[ps->m_outputMap[inCh++]]];
-
 			ledstring[m_ledstringNumber].channel[s].leds[pix] =
-				(r << 16) | (g <<  8) | (b);
+				(c[0] << 16) | (c[1] <<  8) | (c[2]);
 		}
 	}
 }
@@ -63,6 +63,7 @@ class RPIWS281xOutput : public ThreadedChannelOutputBase {
 	int          m_pixels;
 
 	std::vector<PixelString*> m_strings;
+	std::vector<uint8_t>      m_stringData;
 };
 
 #endif
@@ -44,6 +44,7 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <time.h>
 #include <ctype.h>
 #include <unistd.h>
 
@@ -62,6 +63,17 @@ long long GetTime(void)
 	return now_tv.tv_sec * 1000000LL + now_tv.tv_usec;
 }
 
+/*
+ * Get a time in microseconds that only moves forward, for timing things
+ * that must not jump when the wall clock is set
+ */
+long long GetMonotonicTime(void)
+{
+	struct timespec now_ts;
+	clock_gettime(CLOCK_MONOTONIC, &now_ts);
+	return now_ts.tv_sec * 1000000LL + now_ts.tv_nsec / 1000;
+}
+
 /*
  * Check to see if the specified directory exists
  */
@@ -34,10 +34,17 @@
 #include <string.h>
 #include <unistd.h>
 #include <ifaddrs.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <jsoncpp/json/json.h>
 
@@ -51,44 +58,96 @@
 #include "Sequence.h"
 #include "settings.h"
 #include "command.h"
+#include "Threads.h"
 #include "Universe.h"
 
 #define BRIDGE_INVALID_UNIVERSE_INDEX 0xFFFFFF
 
-struct sockaddr_in addr;
-socklen_t addrlen;
-int bridgeSock = -1;
-int ddpSock = -1;
-
-
 #define MAX_MSG 48
 #define BUFSIZE 1500
-struct mmsghdr msgs[MAX_MSG];
-struct iovec iovecs[MAX_MSG];
-unsigned char buffers[MAX_MSG][BUFSIZE+1];
 
+// Each receive thread owns an E1.31 and a DDP socket bound with
+// SO_REUSEPORT so the kernel spreads the unicast senders over the threads.
+// A sender's packets always land on the same socket so its sync packet or
+// push is received after the data it latches.  Multicast data and sync
+// packets go to different groups, so all of the groups are joined on the
+// first thread's E1.31 socket to keep them in order.
+typedef struct {
+	int            index;
+	int            e131Sock;
+	int            ddpSock;
+	int            epollFd;
+	std::thread    thread;
+	long           ddpLastSequence;
+	struct mmsghdr msgs[MAX_MSG];
+	struct iovec   iovecs[MAX_MSG];
+	unsigned char  buffers[MAX_MSG][BUFSIZE+1];
+} BridgeReceiver;
+
+static std::vector<BridgeReceiver *> receivers;
+static int bridgeStopFd = -1;
+static int busyPollUs = 0;
+
+// The receive threads store data into the back buffer.  An E1.31 sync
+// packet or DDP push copies it into a frame slot which is handed to the
+// output thread the same way ThreadedChannelOutputBase hands frames to its
+// thread: the latch owns writeSlot, the output thread owns readSlot and
+// the third slot is in latestSlot along with a new frame flag.  While no
+// sender is synchronizing the output thread latches every frame itself.
+// bufferLock is held by a receive thread while it stores a batch of
+// packets and by the latch, so a frame is never copied mid packet.
+#define SLOT_INDEX     0x3
+#define SLOT_NEW_FRAME 0x4
+
+typedef struct {
+	char          *data;
+	unsigned long  size;
+	long long      syncTime;
+} BridgeFrame;
+
+static char              *backBuffer = NULL;
+static BridgeFrame        frames[3];
+static std::atomic<int>   latestSlot(2);
+static int                writeSlot = 0;
+static int                readSlot = 1;
+static std::mutex         bufferLock;
+static std::atomic<bool>  dataPending(false);
+static std::atomic<long long> lastSyncTime(0);
+static unsigned long      inputChannels = 0;
+static int                syncUniverse = 0;
+static long long          syncTimeoutUs = 1000000;
+
+// Filled in before the receive threads start so lookups are read only
 unsigned int UniverseCache[65536];
 
 
 UniverseEntry InputUniverses[MAX_UNIVERSE_COUNT];
 int InputUniverseCount;
 
-static unsigned long ddpBytesReceived = 0;
-static unsigned long ddpPacketsReceived = 0;
-static unsigned long ddpErrors = 0;
+// Receive counters, updated by all the receive threads
+typedef struct {
+	std::atomic<unsigned long> bytesReceived;
+	std::atomic<unsigned long> packetsReceived;
+	std::atomic<unsigned long> errorPackets;
+	std::atomic<int>           lastSequenceNumber;
+} UniverseStats;
+
+static UniverseStats universeStats[MAX_UNIVERSE_COUNT];
 
-static long ddpLastSequence = 0;
-static long ddpLastChannel = 0;
-static unsigned long ddpMinChannel = 0xFFFFFFF;
-static unsigned long ddpMaxChannel = 0;
+static std::atomic<unsigned long> ddpBytesReceived(0);
+static std::atomic<unsigned long> ddpPacketsReceived(0);
+static std::atomic<unsigned long> ddpErrors(0);
 
-static unsigned long e131Errors = 0;
-static unsigned long e131SyncPackets = 0;
-static UniverseEntry unknownUniverse;
+static std::atomic<unsigned long> ddpMinChannel(0xFFFFFFF);
+static std::atomic<unsigned long> ddpMaxChannel(0);
+
+static std::atomic<unsigned long> e131Errors(0);
+static std::atomic<unsigned long> e131SyncPackets(0);
+static UniverseStats unknownUniverse;
 
 // prototypes for functions below
 bool Bridge_StoreData(char *bridgeBuffer);
-bool Bridge_StoreDDPData(char *bridgeBuffer);
+bool Bridge_StoreDDPData(BridgeReceiver *r, char *bridgeBuffer);
 int Bridge_GetIndexFromUniverseNumber(int universe);
 void InputUniversesPrint();
 
@@ -183,50 +242,223 @@ void LoadInputUniversesFromFile(void)
 	InputUniversesPrint();
 }
 
+/*
+ * Latch everything received so far as the latest frame.  syncTime is the
+ * time the sync/push packet arrived, 0 when latched by the output thread.
+ * The caller must hold bufferLock.
+ */
+static void Bridge_LatchFrame(long long syncTime)
+{
+	// cleared first so data stored during the copy is latched next time
+	dataPending.store(false, std::memory_order_relaxed);
+
+	BridgeFrame &frame = frames[writeSlot];
+	frame.size = std::max(inputChannels, ddpMaxChannel.load(std::memory_order_relaxed));
+	memcpy(frame.data, backBuffer, frame.size);
+	frame.syncTime = syncTime;
+
+	writeSlot = latestSlot.exchange(writeSlot | SLOT_NEW_FRAME) & SLOT_INDEX;
+
+	if (syncTime)
+		lastSyncTime.store(syncTime, std::memory_order_relaxed);
+}
+
+bool Bridge_FrameLatched(void)
+{
+	return latestSlot.load() & SLOT_NEW_FRAME;
+}
+
+long long Bridge_ReadFrame(char *data)
+{
+	if (!backBuffer)
+		return 0;
+
+	// fall back to latching every output frame when the senders are not
+	// sending sync packets or pushes, or have stopped
+	if (dataPending.load(std::memory_order_acquire) &&
+		((GetMonotonicTime() - lastSyncTime.load(std::memory_order_relaxed)) > syncTimeoutUs)) {
+		std::unique_lock<std::mutex> lock(bufferLock);
+		Bridge_LatchFrame(0);
+	}
+
+	if (latestSlot.load() & SLOT_NEW_FRAME)
+		readSlot = latestSlot.exchange(readSlot) & SLOT_INDEX;
+
+	BridgeFrame &frame = frames[readSlot];
+	memcpy(data, frame.data, frame.size);
+
+	long long syncTime = frame.syncTime;
+	frame.syncTime = 0;
+
+	return syncTime;
+}
+
 /*
  * Read data waiting for us
  */
-bool Bridge_ReceiveE131Data(void)
+static bool Bridge_ReceiveE131Data(BridgeReceiver *r)
 {
 //	LogExcess(VB_E131BRIDGE, "Bridge_ReceiveData()\n");
 
-    int msgcnt = recvmmsg(bridgeSock, msgs, MAX_MSG, 0, nullptr);
+    // a short batch means the socket has been emptied
     bool sync = false;
-    while (msgcnt > 0) {
+    int msgcnt;
+    do {
+        msgcnt = recvmmsg(r->e131Sock, r->msgs, MAX_MSG, 0, nullptr);
+        std::unique_lock<std::mutex> lock(bufferLock);
         for (int x = 0; x < msgcnt; x++) {
-            sync |= Bridge_StoreData((char*)buffers[x]);
+            sync |= Bridge_StoreData((char*)r->buffers[x]);
         }
-        msgcnt = recvmmsg(bridgeSock, msgs, MAX_MSG, 0, nullptr);
-    }
+    } while (msgcnt == MAX_MSG);
     return sync;
 }
-bool Bridge_ReceiveDDPData(void)
+static bool Bridge_ReceiveDDPData(BridgeReceiver *r)
 {
     //    LogExcess(VB_E131BRIDGE, "Bridge_ReceiveData()\n");
-    int msgcnt = recvmmsg(ddpSock, msgs, MAX_MSG, 0, nullptr);
     bool sync = false;
-    while (msgcnt > 0) {
+    int msgcnt;
+    do {
+        msgcnt = recvmmsg(r->ddpSock, r->msgs, MAX_MSG, 0, nullptr);
+        std::unique_lock<std::mutex> lock(bufferLock);
         for (int x = 0; x < msgcnt; x++) {
-            sync |= Bridge_StoreDDPData((char*)buffers[x]);
+            sync |= Bridge_StoreDDPData(r, (char*)r->buffers[x]);
         }
-        msgcnt = recvmmsg(ddpSock, msgs, MAX_MSG, 0, nullptr);
-    }
+    } while (msgcnt == MAX_MSG);
     return sync;
 }
 
-void Bridge_Initialize(int &eSock, int &dSock)
+static void Bridge_ReceiveThread(BridgeReceiver *r)
 {
-	LogExcess(VB_E131BRIDGE, "Bridge_Initialize()\n");
+    char name[16];
+    snprintf(name, sizeof(name), "fpp-bridgerx%d", r->index);
+    SetThreadRole(THREAD_ROLE_BRIDGE_INPUT, name);
+    PinThreadInRole(THREAD_ROLE_BRIDGE_INPUT, r->index);
+
+    struct epoll_event events[3];
+    long long lastPacket = 0;
+
+    while (true) {
+        // spin on the sockets for a while after a packet when busy polling
+        int timeout = -1;
+        if (busyPollUs && ((GetMonotonicTime() - lastPacket) < busyPollUs))
+            timeout = 0;
+
+        int count = epoll_wait(r->epollFd, events, 3, timeout);
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+
+            LogErr(VB_E131BRIDGE, "Bridge receive epoll_wait() failed: %s\n", strerror(errno));
+            break;
+        }
+
+        bool push = false;
+        for (int i = 0; i < count; i++) {
+            int fd = events[i].data.fd;
+            if (fd == bridgeStopFd)
+                return;
+
+            if (fd == r->e131Sock)
+                push |= Bridge_ReceiveE131Data(r);
+            else if (fd == r->ddpSock)
+                push |= Bridge_ReceiveDDPData(r);
+        }
 
-    // prepare the msg receive buffers
-    memset(msgs, 0, sizeof(msgs));
-    for (int i = 0; i < MAX_MSG; i++) {
-        iovecs[i].iov_base         = buffers[i];
-        iovecs[i].iov_len          = BUFSIZE;
-        msgs[i].msg_hdr.msg_iov    = &iovecs[i];
-        msgs[i].msg_hdr.msg_iovlen = 1;
+        if (busyPollUs && count)
+            lastPacket = GetMonotonicTime();
+
+        if (push)
+            ForceChannelOutputNow();
     }
-    
+}
+
+static int Bridge_OpenSocket(int port, const char *type, int bufferSize)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (sock < 0) {
+        LogErr(VB_E131BRIDGE, "e131bridge %s socket failed: %s\n", type, strerror(errno));
+        exit(1);
+    }
+
+    int enable = 1;
+    if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0)
+        LogWarn(VB_E131BRIDGE, "Unable to set SO_REUSEPORT on %s socket: %s\n", type, strerror(errno));
+
+    // SO_RCVBUFFORCE gets past net.core.rmem_max when running as root
+    if ((setsockopt(sock, SOL_SOCKET, SO_RCVBUFFORCE, &bufferSize, sizeof(bufferSize)) < 0) &&
+        (setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize)) < 0))
+        LogWarn(VB_E131BRIDGE, "Unable to set %s receive buffer size: %s\n", type, strerror(errno));
+
+    if (busyPollUs &&
+        (setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &busyPollUs, sizeof(busyPollUs)) < 0))
+        LogWarn(VB_E131BRIDGE, "Unable to set SO_BUSY_POLL on %s socket: %s\n", type, strerror(errno));
+
+    struct sockaddr_in addr;
+    memset((char *)&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    // Bind the socket to address/port
+    if (bind(sock, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        LogErr(VB_E131BRIDGE, "e131bridge %s bind failed: %s\n", type, strerror(errno));
+        exit(1);
+    }
+
+    return sock;
+}
+
+/*
+ * Join the multicast group for a universe on every IPv4 interface
+ */
+static void Bridge_JoinMulticastGroup(int sock, int universe, struct ifaddrs *interfaces)
+{
+	struct ip_mreq mreq;
+	char           strMulticastGroup[16];
+	char           address[16];
+
+	sprintf(strMulticastGroup, "239.255.%d.%d", universe / 256, universe % 256);
+	mreq.imr_multiaddr.s_addr = inet_addr(strMulticastGroup);
+
+	LogInfo(VB_E131BRIDGE, "Adding group %s\n", strMulticastGroup);
+
+    // add group to groups to listen for on eth0 and wlan0 if it exists
+    int multicastJoined = 0;
+    struct ifaddrs *tmp = interfaces;
+    address[0] = 0;
+    //loop through all the interfaces and subscribe to the group
+    while (tmp) {
+        //struct sockaddr_in *sin = (struct sockaddr_in *)tmp->ifa_addr;
+        //strcpy(address, inet_ntoa(sin->sin_addr));
+        if (tmp->ifa_addr && tmp->ifa_addr->sa_family == AF_INET) {
+            GetInterfaceAddress(tmp->ifa_name, address, NULL, NULL);
+            if (strcmp(address, "127.0.0.1")) {
+                LogDebug(VB_E131BRIDGE, "   Adding interface %s - %s\n", tmp->ifa_name, address);
+                mreq.imr_interface.s_addr = inet_addr(address);
+                if (setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+                    LogWarn(VB_E131BRIDGE, "   Could not setup Multicast Group for interface %s\n", tmp->ifa_name);
+                }
+                multicastJoined = 1;
+            }
+        } else if (tmp->ifa_addr && tmp->ifa_addr->sa_family == AF_INET6) {
+            //FIXME for ipv6 multicast
+            //LogDebug(VB_E131BRIDGE, "   Inet6 interface %s\n", tmp->ifa_name);
+        }
+        tmp = tmp->ifa_next;
+    }
+
+	if (!multicastJoined) {
+		LogDebug(VB_E131BRIDGE, "  Binding to default interface\n");
+		mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+		if (setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP,&mreq, sizeof(mreq)) < 0) {
+            LogWarn(VB_E131BRIDGE, "   Could not setup Multicast Group\n");
+		}
+	}
+}
+
+void Bridge_Initialize(void)
+{
+	LogExcess(VB_E131BRIDGE, "Bridge_Initialize()\n");
+
 	/* Initialize our Universe Index lookup cache */
 	for (int i = 0; i < 65536; i++)
 		UniverseCache[i] = BRIDGE_INVALID_UNIVERSE_INDEX;
@@ -234,6 +466,55 @@ void Bridge_Initialize(int &eSock, int &dSock)
 	LoadInputUniversesFromFile();
 	LogInfo(VB_E131BRIDGE, "Universe Count = %d\n",InputUniverseCount);
 	InputUniversesPrint();
+
+	// backwards so the first entry for a universe wins
+	for (int i = InputUniverseCount - 1; i >= 0; i--) {
+		if ((InputUniverses[i].universe >= 0) && (InputUniverses[i].universe < 65536))
+			UniverseCache[InputUniverses[i].universe] = i;
+	}
+
+	inputChannels = 0;
+	for (int i = 0; i < InputUniverseCount; i++) {
+		unsigned long end = InputUniverses[i].startAddress - 1 + InputUniverses[i].size;
+		if (end > inputChannels)
+			inputChannels = end;
+	}
+	if (inputChannels > FPPD_MAX_CHANNELS)
+		inputChannels = FPPD_MAX_CHANNELS;
+
+	// the pages are only touched up to the highest channel received
+	backBuffer = (char *)calloc(1, FPPD_MAX_CHANNELS);
+	for (int i = 0; i < 3; i++) {
+		frames[i].data = (char *)calloc(1, FPPD_MAX_CHANNELS);
+		frames[i].size = 0;
+		frames[i].syncTime = 0;
+	}
+
+	syncUniverse = getSettingInt("BridgeSyncUniverse");
+	if (strlen(getSetting("BridgeSyncTimeout")))
+		syncTimeoutUs = getSettingInt("BridgeSyncTimeout") * 1000LL;
+
+	if (syncUniverse)
+		LogInfo(VB_E131BRIDGE, "Latching bridge frames on E1.31 sync universe %d\n", syncUniverse);
+
+	int threads = getSettingInt("BridgeReceiveThreads");
+	if (threads <= 0) {
+		// auto, half the cores
+		threads = std::thread::hardware_concurrency() / 2;
+		if (threads > 4)
+			threads = 4;
+	}
+	if (threads < 1)
+		threads = 1;
+
+	int bufferSize = 4096 * 1024;
+	if (strlen(getSetting("BridgeReceiveBuffer")))
+		bufferSize = getSettingInt("BridgeReceiveBuffer") * 1024;
+
+	busyPollUs = getSettingInt("BridgeBusyPoll");
+
+	LogInfo(VB_E131BRIDGE, "Using %d bridge receive threads, %dKB receive buffers\n",
+		threads, bufferSize / 1024);
     
     
     // FIXME FIXME FIXME FIXME
@@ -243,209 +524,229 @@ void Bridge_Initialize(int &eSock, int &dSock)
     int i1 = socket(AF_INET, SOCK_DGRAM, 0);
     int i2 = socket(AF_INET, SOCK_DGRAM, 0);
     int i3 = socket(AF_INET, SOCK_DGRAM, 0);
-    
-    ddpSock = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
-    if (ddpSock < 0) {
-        LogDebug(VB_E131BRIDGE, "e131bridge DDP socket failed: %s", strerror(errno));
-        exit(1);
-    }
-    memset((char *)&addr, 0, sizeof(addr));
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    addr.sin_port = htons(DDP_PORT);
-    addrlen = sizeof(addr);
-    // Bind the socket to address/port
-    if (bind(ddpSock, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
-        LogDebug(VB_E131BRIDGE, "e131bridge DDP bind failed: %s", strerror(errno));
-        exit(1);
-    }
-
-	int            UniverseOctet[2];
-	struct ip_mreq mreq;
-	char           strMulticastGroup[16];
-
-	/* set up socket */
-	bridgeSock = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
-	if (bridgeSock < 0) {
-		LogDebug(VB_E131BRIDGE, "e131bridge socket failed: %s", strerror(errno));
-		exit(1);
-	}
 
 	// FIXME, move this to /etc/sysctl.conf or our startup script
 	system("sudo sysctl net/ipv4/igmp_max_memberships=512");
 
-	memset((char *)&addr, 0, sizeof(addr));
-	addr.sin_family = AF_INET;
-	addr.sin_addr.s_addr = htonl(INADDR_ANY);
-	addr.sin_port = htons(E131_DEST_PORT);
-	addrlen = sizeof(addr);
-	// Bind the socket to address/port
-	if (bind(bridgeSock, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
-		LogDebug(VB_E131BRIDGE, "e131bridge bind failed: %s", strerror(errno));
-		exit(1);
+	bridgeStopFd = eventfd(0, EFD_NONBLOCK);
+
+	for (int t = 0; t < threads; t++) {
+		BridgeReceiver *r = new BridgeReceiver;
+
+		r->index = t;
+		r->ddpLastSequence = 0;
+
+		// prepare the msg receive buffers
+		memset(r->msgs, 0, sizeof(r->msgs));
+		for (int i = 0; i < MAX_MSG; i++) {
+			r->iovecs[i].iov_base         = r->buffers[i];
+			r->iovecs[i].iov_len          = BUFSIZE;
+			r->msgs[i].msg_hdr.msg_iov    = &r->iovecs[i];
+			r->msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		r->ddpSock = Bridge_OpenSocket(DDP_PORT, "DDP", bufferSize);
+		r->e131Sock = Bridge_OpenSocket(E131_DEST_PORT, "E1.31", bufferSize);
+
+		// only receive the multicast groups joined on this socket, not
+		// every group joined by any socket
+		int all = 0;
+		if (setsockopt(r->e131Sock, IPPROTO_IP, IP_MULTICAST_ALL, &all, sizeof(all)) < 0)
+			LogWarn(VB_E131BRIDGE, "Unable to clear IP_MULTICAST_ALL: %s\n", strerror(errno));
+
+		r->epollFd = epoll_create1(0);
+
+		struct epoll_event ev;
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.fd = r->e131Sock;
+		epoll_ctl(r->epollFd, EPOLL_CTL_ADD, r->e131Sock, &ev);
+		ev.data.fd = r->ddpSock;
+		epoll_ctl(r->epollFd, EPOLL_CTL_ADD, r->ddpSock, &ev);
+		ev.data.fd = bridgeStopFd;
+		epoll_ctl(r->epollFd, EPOLL_CTL_ADD, bridgeStopFd, &ev);
+
+		receivers.push_back(r);
 	}
+
+	int multicastCount = 0;
+	bool syncGroupJoined = false;
+	int multicastSock = receivers[0]->e131Sock;
     
     //get all the addresses
-    struct ifaddrs *interfaces,*tmp;
+    struct ifaddrs *interfaces;
     getifaddrs(&interfaces);
     
-	char address[16];
-    address[0] = 0;
 	// Join the multicast groups
 	for(int i = 0; i < InputUniverseCount; i++)  {
 		if (InputUniverses[i].type == E131_TYPE_MULTICAST) {
-			UniverseOctet[0] = InputUniverses[i].universe/256;
-			UniverseOctet[1] = InputUniverses[i].universe%256;
-			sprintf(strMulticastGroup, "239.255.%d.%d", UniverseOctet[0],UniverseOctet[1]);
-			mreq.imr_multiaddr.s_addr = inet_addr(strMulticastGroup);
-
-			LogInfo(VB_E131BRIDGE, "Adding group %s\n", strMulticastGroup);
-
-            // add group to groups to listen for on eth0 and wlan0 if it exists
-            int multicastJoined = 0;
-            tmp = interfaces;
-            //loop through all the interfaces and subscribe to the group
-            while (tmp) {
-                //struct sockaddr_in *sin = (struct sockaddr_in *)tmp->ifa_addr;
-                //strcpy(address, inet_ntoa(sin->sin_addr));
-                if (tmp->ifa_addr && tmp->ifa_addr->sa_family == AF_INET) {
-                    GetInterfaceAddress(tmp->ifa_name, address, NULL, NULL);
-                    if (strcmp(address, "127.0.0.1")) {
-                        LogDebug(VB_E131BRIDGE, "   Adding interface %s - %s\n", tmp->ifa_name, address);
-                        mreq.imr_interface.s_addr = inet_addr(address);
-                        if (setsockopt(bridgeSock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
-                            LogWarn(VB_E131BRIDGE, "   Could not setup Multicast Group for interface %s\n", tmp->ifa_name);
-                        }
-                        multicastJoined = 1;
-                    }
-                } else if (tmp->ifa_addr && tmp->ifa_addr->sa_family == AF_INET6) {
-                    //FIXME for ipv6 multicast
-                    //LogDebug(VB_E131BRIDGE, "   Inet6 interface %s\n", tmp->ifa_name);
-                }
-                tmp = tmp->ifa_next;
-            }
+			Bridge_JoinMulticastGroup(multicastSock, InputUniverses[i].universe, interfaces);
+			multicastCount++;
 
-			if (!multicastJoined) {
-				LogDebug(VB_E131BRIDGE, "  Binding to default interface\n");
-				mreq.imr_interface.s_addr = htonl(INADDR_ANY);
-				if (setsockopt(bridgeSock, IPPROTO_IP, IP_ADD_MEMBERSHIP,&mreq, sizeof(mreq)) < 0) {
-                    LogWarn(VB_E131BRIDGE, "   Could not setup Multicast Group\n");
-				}
-			}
+			if (InputUniverses[i].universe == syncUniverse)
+				syncGroupJoined = true;
 		}
 	}
+
+	// multicast senders send the sync packets to the sync universe's group
+	if (multicastCount && syncUniverse && !syncGroupJoined)
+		Bridge_JoinMulticastGroup(multicastSock, syncUniverse, interfaces);
     freeifaddrs(interfaces);
 
 	StartChannelOutputThread();
+
+	for (auto r : receivers)
+		r->thread = std::thread(Bridge_ReceiveThread, r);
     
     if (i1 >= 0) close(i1);
     if (i2 >= 0) close(i2);
     if (i3 >= 0) close(i3);
-
-    eSock = bridgeSock;
-    dSock = ddpSock;
 }
 
 void Bridge_Shutdown(void)
 {
-    close(bridgeSock);
-    close(ddpSock);
-    bridgeSock = -1;
-    ddpSock = -1;
+    uint64_t stop = 1;
+    if (write(bridgeStopFd, &stop, sizeof(stop)) < 0)
+        LogErr(VB_E131BRIDGE, "Unable to stop bridge receive threads: %s\n", strerror(errno));
+
+    for (auto r : receivers) {
+        if (r->thread.joinable())
+            r->thread.join();
+
+        close(r->epollFd);
+        close(r->e131Sock);
+        close(r->ddpSock);
+        delete r;
+    }
+    receivers.clear();
+
+    close(bridgeStopFd);
+    bridgeStopFd = -1;
+
+    for (int i = 0; i < 3; i++) {
+        free(frames[i].data);
+        frames[i].data = NULL;
+    }
+    free(backBuffer);
+    backBuffer = NULL;
 }
 
 bool Bridge_StoreData(char *bridgeBuffer)
 {
     if ((bridgeBuffer[E131_VECTOR_INDEX] == VECTOR_ROOT_E131_DATA) &&
         (bridgeBuffer[E131_START_CODE] == 0x00)) {
-        int universe = ((int)bridgeBuffer[E131_UNIVERSE_INDEX] << 8) + bridgeBuffer[E131_UNIVERSE_INDEX + 1];
+        int universe = ((unsigned char)bridgeBuffer[E131_UNIVERSE_INDEX] << 8) + (unsigned char)bridgeBuffer[E131_UNIVERSE_INDEX + 1];
         int universeIndex = Bridge_GetIndexFromUniverseNumber(universe);
         if(universeIndex != BRIDGE_INVALID_UNIVERSE_INDEX) {
-            int sn = bridgeBuffer[E131_SEQUENCE_INDEX];
-            if (InputUniverses[universeIndex].packetsReceived != 0) {
-                if (InputUniverses[universeIndex].lastSequenceNumber == 255) {
+            UniverseStats &stats = universeStats[universeIndex];
+            int sn = (unsigned char)bridgeBuffer[E131_SEQUENCE_INDEX];
+            int lastSn = stats.lastSequenceNumber.exchange(sn, std::memory_order_relaxed);
+            if (stats.packetsReceived.load(std::memory_order_relaxed) != 0) {
+                if (lastSn == 255) {
                     // some wrap from 255 -> 1 and some from 255 -> 0, spec doesn't say which
                     if (sn != 0 && sn != 1) {
-                        ++InputUniverses[universeIndex].errorPackets;
+                        stats.errorPackets.fetch_add(1, std::memory_order_relaxed);
                     }
-                } else if ((InputUniverses[universeIndex].lastSequenceNumber + 1) != sn) {
-                    ++InputUniverses[universeIndex].errorPackets;
+                } else if ((lastSn + 1) != sn) {
+                    stats.errorPackets.fetch_add(1, std::memory_order_relaxed);
                 }
             }
-            InputUniverses[universeIndex].lastSequenceNumber = sn;
             
-            memcpy((void*)(sequence->m_seqData+InputUniverses[universeIndex].startAddress-1),
+            memcpy((void*)(backBuffer+InputUniverses[universeIndex].startAddress-1),
                    (void*)(bridgeBuffer+E131_HEADER_LENGTH),
                    InputUniverses[universeIndex].size);
-            InputUniverses[universeIndex].bytesReceived += InputUniverses[universeIndex].size;
-            InputUniverses[universeIndex].packetsReceived++;
+            dataPending.store(true, std::memory_order_release);
+            stats.bytesReceived.fetch_add(InputUniverses[universeIndex].size, std::memory_order_relaxed);
+            stats.packetsReceived.fetch_add(1, std::memory_order_relaxed);
         } else {
-            unknownUniverse.packetsReceived++;
+            unknownUniverse.packetsReceived.fetch_add(1, std::memory_order_relaxed);
             int len = bridgeBuffer[16] & 0xF;
             len <<= 8;
             len += bridgeBuffer[17];
-            unknownUniverse.bytesReceived += len;
+            unknownUniverse.bytesReceived.fetch_add(len, std::memory_order_relaxed);
             LogDebug(VB_E131BRIDGE, "Received data packet for unconfigured universe %d\n", universe);
         }
     } else if (bridgeBuffer[E131_VECTOR_INDEX] == VECTOR_ROOT_E131_EXTENDED) {
         if (bridgeBuffer[E131_EXTENDED_PACKET_TYPE_INDEX] == VECTOR_E131_EXTENDED_SYNCHRONIZATION) {
-            e131SyncPackets++;
+            e131SyncPackets.fetch_add(1, std::memory_order_relaxed);
+
+            int universe = ((unsigned char)bridgeBuffer[E131_SYNC_UNIVERSE_INDEX] << 8) + (unsigned char)bridgeBuffer[E131_SYNC_UNIVERSE_INDEX + 1];
+            if (syncUniverse && (universe != syncUniverse))
+                return false;
+
+            Bridge_LatchFrame(GetMonotonicTime());
             return true;
         }
-        e131Errors++;
+        e131Errors.fetch_add(1, std::memory_order_relaxed);
         LogDebug(VB_E131BRIDGE, "Unknown e1.31 extended packet type %d\n", (int)bridgeBuffer[E131_EXTENDED_PACKET_TYPE_INDEX]);
     } else {
-        e131Errors++;
+        e131Errors.fetch_add(1, std::memory_order_relaxed);
         LogDebug(VB_E131BRIDGE, "Unknown e1.31 packet type %d, start code %d\n", (int)bridgeBuffer[E131_VECTOR_INDEX], (int)bridgeBuffer[E131_START_CODE]);
     }
     return false;
 }
 
-bool Bridge_StoreDDPData(char *bridgeBuffer)  {
+bool Bridge_StoreDDPData(BridgeReceiver *r, char *bridgeBuffer)  {
     bool push = false;
     if (bridgeBuffer[3] == 1) {
-        ddpPacketsReceived++;
+        ddpPacketsReceived.fetch_add(1, std::memory_order_relaxed);
         bool tc = bridgeBuffer[0] & DDP_TIMECODE_FLAG;
         push = bridgeBuffer[0] & DDP_PUSH_FLAG;
         
-        unsigned long chan = bridgeBuffer[4];
+        unsigned char *header = (unsigned char *)bridgeBuffer;
+        unsigned long chan = header[4];
         chan <<= 8;
-        chan += bridgeBuffer[5];
+        chan += header[5];
         chan <<= 8;
-        chan += bridgeBuffer[6];
+        chan += header[6];
         chan <<= 8;
-        chan += bridgeBuffer[7];
+        chan += header[7];
         
-        unsigned long len = bridgeBuffer[8] << 8;
-        len += bridgeBuffer[9];
+        unsigned long len = header[8] << 8;
+        len += header[9];
         
+        // a sender's packets all land on the same socket so the sequence
+        // is tracked per receive thread
         int sn = bridgeBuffer[1] & 0xF;
         if (sn) {
             bool isErr = false;
-            if (ddpLastSequence) {
+            if (r->ddpLastSequence) {
                 if (sn == 1) {
-                    if (ddpLastSequence != 15) {
+                    if (r->ddpLastSequence != 15) {
                         isErr = true;
                     }
-                } else if ((sn - 1) != ddpLastSequence) {
+                } else if ((sn - 1) != r->ddpLastSequence) {
                     isErr = true;
                 }
             }
             if (isErr) {
-                ddpErrors++;
-                //printf("%d   %d    %d  %d\n", sn, ddpLastSequence, chan, ddpLastChannel);
+                ddpErrors.fetch_add(1, std::memory_order_relaxed);
             }
-            ddpLastSequence = sn;
-            ddpLastChannel = chan + len;
+            r->ddpLastSequence = sn;
         }
 
-        ddpMinChannel = std::min(ddpMinChannel, chan + 1);
-        ddpMaxChannel = std::max(ddpMaxChannel, chan + len);
+        if ((chan + len) > FPPD_MAX_CHANNELS) {
+            ddpErrors.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        unsigned long minChannel = ddpMinChannel.load(std::memory_order_relaxed);
+        while (((chan + 1) < minChannel) &&
+               !ddpMinChannel.compare_exchange_weak(minChannel, chan + 1, std::memory_order_relaxed)) {
+        }
+        unsigned long maxChannel = ddpMaxChannel.load(std::memory_order_relaxed);
+        while (((chan + len) > maxChannel) &&
+               !ddpMaxChannel.compare_exchange_weak(maxChannel, chan + len, std::memory_order_relaxed)) {
+        }
 
         int offset = tc ? 14 : 10;
-        memcpy(sequence->m_seqData + chan, &bridgeBuffer[offset], len);
+        memcpy(backBuffer + chan, &bridgeBuffer[offset], len);
+        dataPending.store(true, std::memory_order_release);
         
-        ddpBytesReceived += len;
+        ddpBytesReceived.fetch_add(len, std::memory_order_relaxed);
+
+        if (push)
+            Bridge_LatchFrame(GetMonotonicTime());
     }
     return push;
 }
@@ -453,23 +754,7 @@ bool Bridge_StoreDDPData(char *bridgeBuffer)  {
 
 inline int Bridge_GetIndexFromUniverseNumber(int universe)
 {
-	int index;
-	int val=BRIDGE_INVALID_UNIVERSE_INDEX;
-
-	if (UniverseCache[universe] != BRIDGE_INVALID_UNIVERSE_INDEX)
-		return UniverseCache[universe];
-
-	for(index=0;index<InputUniverseCount;index++)
-	{
-		if(universe == InputUniverses[index].universe)
-		{
-			val = index;
-			UniverseCache[universe] = index;
-			break;
-		}
-	}
-
-	return val;
+	return UniverseCache[universe];
 }
 
 void ResetBytesReceived()
@@ -478,10 +763,10 @@ void ResetBytesReceived()
 
 	for(i=0;i<InputUniverseCount;i++)
 	{
-		InputUniverses[i].bytesReceived = 0;
-		InputUniverses[i].packetsReceived = 0;
-        InputUniverses[i].errorPackets = 0;
-        InputUniverses[i].lastSequenceNumber = 0;
+		universeStats[i].bytesReceived = 0;
+		universeStats[i].packetsReceived = 0;
+        universeStats[i].errorPackets = 0;
+        universeStats[i].lastSequenceNumber = 0;
 	}
     ddpBytesReceived = 0;
     ddpPacketsReceived = 0;
@@ -536,19 +821,19 @@ Json::Value GetE131UniverseBytesReceived()
 		// FIXME, use to_string on Squeeze
 		//universe["bytesReceived"] = std::to_string(InputUniverses[i].bytesReceived);
 		std::stringstream ss;
-		ss << InputUniverses[i].bytesReceived;
+		ss << universeStats[i].bytesReceived;
 		std::string bytesReceived = ss.str();
 		universe["bytesReceived"] = bytesReceived;
 
 		// FIXME, use to_string on Squeeze
 		//universe["packetsReceived"] = std::to_string(InputUniverses[i].packetsReceived);
 		std::stringstream pr;
-		pr << InputUniverses[i].packetsReceived;
+		pr << universeStats[i].packetsReceived;
 		std::string packetsReceived = pr.str();
 		universe["packetsReceived"] = packetsReceived;
         
         std::stringstream er;
-        er << InputUniverses[i].errorPackets;
+        er << universeStats[i].errorPackets;
         std::string errors = er.str();
         universe["errors"] = errors;
 
@@ -26,13 +26,21 @@
 #ifndef _E131_BRIDGE_H
 #define _E131_BRIDGE_H
 
+#include <jsoncpp/json/json.h>
+
 #include "e131defs.h"
 
-void Bridge_Initialize(int &e131Socket, int &ddpSocket);
-bool Bridge_ReceiveE131Data(void);
-bool Bridge_ReceiveDDPData(void);
+// Starts the E1.31/DDP receive threads, see e131bridge.cpp
+void Bridge_Initialize(void);
 void Bridge_Shutdown(void);
 
+// Received data is latched into a complete frame on an E1.31 sync packet
+// or DDP push.  Bridge_ReadFrame() copies the latest latched frame into
+// data and returns the time of the sync packet that latched it the first
+// time that frame is read, otherwise 0.
+bool      Bridge_FrameLatched(void);
+long long Bridge_ReadFrame(char *data);
+
 void  ResetBytesReceived();
 Json::Value GetE131UniverseBytesReceived();
 
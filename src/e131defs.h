@@ -45,6 +45,7 @@
 
 #define E131_VECTOR_INDEX                21
 #define E131_EXTENDED_PACKET_TYPE_INDEX  43
+#define E131_SYNC_UNIVERSE_INDEX         45
 #define VECTOR_E131_EXTENDED_SYNCHRONIZATION  0x1
 #define VECTOR_ROOT_E131_DATA       0x4
 #define VECTOR_ROOT_E131_EXTENDED   0x8
@@ -46,6 +46,7 @@
 #include "Scheduler.h"
 #include "Sequence.h"
 #include "settings.h"
+#include "Threads.h"
 
 #include <errno.h>
 #include <unistd.h>
@@ -205,6 +206,10 @@ int main(int argc, char *argv[])
 	if (getDaemonize())
 		CreateDaemon();
 
+	// after CreateDaemon() since memory locks are not kept across fork()
+	InitThreads();
+	SetThreadRole(THREAD_ROLE_MAIN, "fppd");
+
 	if (strcmp(getSetting("MQTTHost"),""))
 	{
 		mqtt = new MosquittoClient(getSetting("MQTTHost"), getSettingInt("MQTTPort"), getSetting("MQTTPrefix"));
@@ -292,8 +297,6 @@ void MainLoop(void)
 {
 	int            commandSock = 0;
 	int            controlSock = 0;
-	int            bridgeSock = 0;
-    int            ddpSock = 0;
 	int            prevFPPstatus = FPPstatus;
 	int            sleepms = 50000;
 	fd_set         active_fd_set;
@@ -317,11 +320,7 @@ void MainLoop(void)
 	}
 	else if (getFPPmode() == BRIDGE_MODE)
 	{
-		Bridge_Initialize(bridgeSock, ddpSock);
-		if (bridgeSock)
-			FD_SET (bridgeSock, &active_fd_set);
-                if (ddpSock)
-                    FD_SET (ddpSock, &active_fd_set);
+		Bridge_Initialize();
 	}
 
 	controlSock = multiSync->GetControlSocket();
@@ -359,15 +358,9 @@ void MainLoop(void)
 			}
 		}
 
-        bool pushBridgeData = false;
 		if (commandSock && FD_ISSET(commandSock, &read_fd_set))
 			CommandProc();
 
-		if (bridgeSock && FD_ISSET(bridgeSock, &read_fd_set))
- 			pushBridgeData |= Bridge_ReceiveE131Data();
-        if (ddpSock && FD_ISSET(ddpSock, &read_fd_set))
-            pushBridgeData |= Bridge_ReceiveDDPData();
-
 		if (FD_ISSET(controlSock, &read_fd_set))
 			multiSync->ProcessControlPacket();
 
@@ -439,10 +432,6 @@ void MainLoop(void)
 				playlist->ProcessMedia();
 			}
         }
-        else if (getFPPmode() == BRIDGE_MODE && pushBridgeData)
-        {
-            ForceChannelOutputNow();
-        }
 
 		CheckGPIOInputs();
 	}
@@ -6,6 +6,13 @@
 #include <vector>
 #include <cstring>
 #include <memory>
+#include <algorithm>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
 
 #include <stdio.h>
 #include <inttypes.h>
@@ -41,6 +48,7 @@ int gettimeofday(struct timeval * tp, struct timezone * tzp)
 
 #else
 #include <sys/time.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #endif
 
@@ -72,6 +80,7 @@ template<typename... Args> static void LogDebug(int i, const char *fmt, Args...
 
 #ifndef NO_ZSTD
 #include <zstd.h>
+#include <zdict.h>
 #endif
 #ifndef NO_ZLIB
 #include <zlib.h>
@@ -152,6 +161,70 @@ inline void write4ByteUInt(uint8_t* data, uint32_t v) {
     data[3] = (uint8_t)((v >> 24) & 0xFF);
 }
 
+static const int FSEQ_MMAP_READAHEAD_FRAMES = 20;
+static const int FSEQ_FRAME_POOL_SIZE = 32;
+
+//recycles the buffers used by UncompressedFrameData so playback doesn't
+//need to allocate a new buffer for every frame
+class FSEQFramePool {
+public:
+    FSEQFramePool() : m_bufferSize(0), m_maxFree(FSEQ_FRAME_POOL_SIZE),
+        m_ranges(std::make_shared<const std::vector<std::pair<uint32_t, uint32_t>>>()),
+        m_allocations(0), m_reuses(0) {}
+    ~FSEQFramePool() {
+        for (auto b : m_free) {
+            free(b);
+        }
+    }
+
+    void setLayout(uint32_t bufferSize, const std::vector<std::pair<uint32_t, uint32_t>> &ranges) {
+        std::unique_lock<std::mutex> lock(m_lock);
+        if (bufferSize != m_bufferSize) {
+            for (auto b : m_free) {
+                free(b);
+            }
+            m_free.clear();
+            m_bufferSize = bufferSize;
+        }
+        //frames hold on to the old ranges so they are replaced, never changed
+        m_ranges = std::make_shared<const std::vector<std::pair<uint32_t, uint32_t>>>(ranges);
+    }
+    std::shared_ptr<const std::vector<std::pair<uint32_t, uint32_t>>> ranges() {
+        std::unique_lock<std::mutex> lock(m_lock);
+        return m_ranges;
+    }
+    //size and ranges are set to the layout the buffer was taken for
+    uint8_t *get(uint32_t &size, std::shared_ptr<const std::vector<std::pair<uint32_t, uint32_t>>> &ranges) {
+        std::unique_lock<std::mutex> lock(m_lock);
+        size = m_bufferSize;
+        ranges = m_ranges;
+        if (!m_free.empty()) {
+            uint8_t *b = m_free.back();
+            m_free.pop_back();
+            m_reuses++;
+            return b;
+        }
+        m_allocations++;
+        return (uint8_t*)malloc(m_bufferSize);
+    }
+    void put(uint8_t *b, uint32_t size) {
+        std::unique_lock<std::mutex> lock(m_lock);
+        if (size == m_bufferSize && m_free.size() < m_maxFree) {
+            m_free.push_back(b);
+        } else {
+            free(b);
+        }
+    }
+
+    uint32_t m_bufferSize;
+    uint32_t m_maxFree;
+    std::shared_ptr<const std::vector<std::pair<uint32_t, uint32_t>>> m_ranges;
+    std::vector<uint8_t*> m_free;
+    std::mutex m_lock;
+    uint64_t m_allocations;
+    uint64_t m_reuses;
+};
+
 FSEQFile* FSEQFile::openFSEQFile(const std::string &fn) {
 
     FILE *seqFile = fopen((const char *)fn.c_str(), "rb");
@@ -213,7 +286,15 @@ FSEQFile* FSEQFile::openFSEQFile(const std::string &fn) {
     if (seqVersionMajor == 1) {
         file = new V1FSEQFile(fn, seqFile, header);
     } else if (seqVersionMajor == 2) {
-        file = new V2FSEQFile(fn, seqFile, header);
+        V2FSEQFile *v2 = new V2FSEQFile(fn, seqFile, header);
+        if (!v2->isSupported()) {
+            LogErr(VB_SEQUENCE, "Error opening sequence file: %s. Unsupported FSEQ v%d.%d file\n",
+                   fn.c_str(), seqVersionMajor, seqVersionMinor);
+            //closes seqFile
+            delete v2;
+            return nullptr;
+        }
+        file = v2;
     } else {
         LogErr(VB_SEQUENCE, "Error opening sequence file: %s. Unknown FSEQ version %d-%d\n",
                fn.c_str(), seqVersionMajor, seqVersionMinor);
@@ -262,6 +343,9 @@ FSEQFile::FSEQFile(const std::string &fn)
     m_seqVersionMinor(0),
     m_memoryBuffer(),
     m_seqChanDataOffset(0),
+    m_readAheadFrames(FSEQ_MMAP_READAHEAD_FRAMES),
+    m_willNeedFrame(0),
+    m_framePool(std::make_shared<FSEQFramePool>()),
     m_memoryBufferPos(0)
 {
     if (fn == "-memory-") {
@@ -300,6 +384,9 @@ FSEQFile::FSEQFile(const std::string &fn, FILE *file, const std::vector<uint8_t>
     : m_filename(fn),
     m_seqFile(file),
     m_uniqueId(0),
+    m_readAheadFrames(FSEQ_MMAP_READAHEAD_FRAMES),
+    m_willNeedFrame(0),
+    m_framePool(std::make_shared<FSEQFramePool>()),
     m_memoryBuffer(),
     m_memoryBufferPos(0)
 {
@@ -324,6 +411,8 @@ FSEQFile::FSEQFile(const std::string &fn, FILE *file, const std::vector<uint8_t>
     }
 }
 FSEQFile::~FSEQFile() {
+    //frames that are still around keep the mapping alive until they are deleted
+    m_mappedFile.reset();
     if (m_seqFile) {
         fclose(m_seqFile);
     }
@@ -371,6 +460,113 @@ void FSEQFile::preload(uint64_t pos, uint64_t size) {
 #endif
 }
 
+class FSEQMappedFile {
+public:
+    FSEQMappedFile(uint8_t *data, uint64_t size) : m_data(data), m_size(size),
+        m_ranges(std::make_shared<const std::vector<std::pair<uint32_t, uint32_t>>>()),
+        m_packed(false), m_frameSize(0) {}
+    ~FSEQMappedFile() {
+#ifndef _MSC_VER
+        munmap(m_data, m_size);
+#endif
+    }
+
+    uint8_t *m_data;
+    uint64_t m_size;
+
+    //the channel ranges to copy out of each frame.  Packed ranges are stored
+    //one after another in the frame (sparse v2 files), otherwise the range
+    //start is the offset into the frame.  Frames hold on to the ranges so
+    //they are replaced, never changed.
+    std::shared_ptr<const std::vector<std::pair<uint32_t, uint32_t>>> m_ranges;
+    bool m_packed;
+    uint32_t m_frameSize;
+};
+
+class MappedFrameData : public FSEQFile::FrameData {
+public:
+    MappedFrameData(uint32_t frame, const std::shared_ptr<FSEQMappedFile> &file, const uint8_t *data)
+    : FrameData(frame), m_file(file), m_data(data), m_ranges(file->m_ranges),
+      m_packed(file->m_packed), m_frameSize(file->m_frameSize) {
+    }
+    virtual ~MappedFrameData() {
+    }
+
+    virtual void readFrame(uint8_t *data) {
+        uint32_t offset = 0;
+        for (auto &rng : *m_ranges) {
+            if (m_packed) {
+                memcpy(&data[rng.first], &m_data[offset], rng.second);
+                offset += rng.second;
+            } else if (rng.first < m_frameSize) {
+                memcpy(&data[rng.first], &m_data[rng.first], rng.second);
+            }
+        }
+    }
+
+    std::shared_ptr<FSEQMappedFile> m_file;
+    const uint8_t *m_data;
+    std::shared_ptr<const std::vector<std::pair<uint32_t, uint32_t>>> m_ranges;
+    bool m_packed;
+    uint32_t m_frameSize;
+};
+
+bool FSEQFile::mapFile() {
+#ifdef _MSC_VER
+    return false;
+#else
+    if (m_seqFile == nullptr || m_seqFileSize == 0) {
+        return false;
+    }
+    void *data = mmap(nullptr, m_seqFileSize, PROT_READ, MAP_SHARED, fileno(m_seqFile), 0);
+    if (data == MAP_FAILED) {
+        LogDebug(VB_SEQUENCE, "Could not mmap %s, reading frames from the file instead\n", m_filename.c_str());
+        return false;
+    }
+    madvise(data, m_seqFileSize, MADV_SEQUENTIAL);
+    m_mappedFile = std::make_shared<FSEQMappedFile>((uint8_t*)data, m_seqFileSize);
+    return true;
+#endif
+}
+
+void FSEQFile::setMappedRanges(const std::vector<std::pair<uint32_t, uint32_t>> &ranges, bool packed) {
+    if (m_mappedFile) {
+        m_mappedFile->m_ranges = std::make_shared<const std::vector<std::pair<uint32_t, uint32_t>>>(ranges);
+        m_mappedFile->m_packed = packed;
+        m_mappedFile->m_frameSize = m_seqChannelCount;
+    }
+}
+
+FrameData *FSEQFile::getMappedFrame(uint32_t frame, uint64_t offset, uint32_t frameSize) {
+    if (!m_mappedFile || (offset + frameSize) > m_mappedFile->m_size) {
+        return nullptr;
+    }
+#ifndef _MSC_VER
+    //ask the kernel to start loading the next batch of frames once we are
+    //half way through the previous batch
+    if (m_readAheadFrames > 0) {
+        if (frame > m_willNeedFrame || (frame + m_readAheadFrames) < m_willNeedFrame) {
+            //seek, start over at this frame
+            m_willNeedFrame = frame;
+        }
+        if ((frame + m_readAheadFrames / 2) >= m_willNeedFrame) {
+            uint64_t start = offset + (uint64_t)(m_willNeedFrame - frame) * m_seqChannelCount;
+            uint64_t end = offset + (uint64_t)m_readAheadFrames * m_seqChannelCount;
+            if (end > m_mappedFile->m_size) {
+                end = m_mappedFile->m_size;
+            }
+            uint64_t pageSize = sysconf(_SC_PAGESIZE);
+            start -= start % pageSize;
+            if (end > start) {
+                madvise(m_mappedFile->m_data + start, end - start, MADV_WILLNEED);
+            }
+            m_willNeedFrame = frame + m_readAheadFrames;
+        }
+    }
+#endif
+    return new MappedFrameData(frame, m_mappedFile, m_mappedFile->m_data + offset);
+}
+
 void FSEQFile::parseVariableHeaders(const std::vector<uint8_t> &header, int start) {
     while (start < header.size() - 5) {
         int len = read2ByteUInt(&header[start]);
@@ -479,6 +675,8 @@ V1FSEQFile::V1FSEQFile(const std::string &fn, FILE *file, const std::vector<uint
     struct stat stats;
     fstat(fileno(file), &stats);
     m_uniqueId = stats.st_mtime;
+
+    mapFile();
 }
 
 V1FSEQFile::~V1FSEQFile() {
@@ -488,27 +686,43 @@ V1FSEQFile::~V1FSEQFile() {
 class UncompressedFrameData : public FSEQFile::FrameData {
 public:
     UncompressedFrameData(uint32_t frame,
-                          uint32_t sz,
-                          const std::vector<std::pair<uint32_t, uint32_t>> &ranges)
-    : FrameData(frame), m_ranges(ranges) {
-        m_data = (uint8_t*)malloc(sz);
+                          const std::shared_ptr<FSEQFramePool> &pool)
+    : FrameData(frame), m_pool(pool) {
+        m_data = m_pool->get(m_size, m_ranges);
     }
     virtual ~UncompressedFrameData() {
-        free(m_data);
+        //the buffer goes back to the pool for the next frame
+        m_pool->put(m_data, m_size);
     }
 
     virtual void readFrame(uint8_t *data) {
         uint32_t offset = 0;
-        for (auto &rng : m_ranges) {
+        for (auto &rng : *m_ranges) {
             uint32_t toRead = rng.second;
             memcpy(&data[rng.first], &m_data[offset], toRead);
             offset += toRead;
         }
     }
 
+    std::shared_ptr<FSEQFramePool> m_pool;
+    uint32_t m_size;
     uint8_t *m_data;
-    std::vector<std::pair<uint32_t, uint32_t>> m_ranges;
+    std::shared_ptr<const std::vector<std::pair<uint32_t, uint32_t>>> m_ranges;
 };
+
+void FSEQFile::setFramePoolSize(int frames) {
+    std::unique_lock<std::mutex> lock(m_framePool->m_lock);
+    m_framePool->m_maxFree = frames;
+}
+uint64_t FSEQFile::getFramePoolAllocations() const {
+    std::unique_lock<std::mutex> lock(m_framePool->m_lock);
+    return m_framePool->m_allocations;
+}
+uint64_t FSEQFile::getFramePoolReuses() const {
+    std::unique_lock<std::mutex> lock(m_framePool->m_lock);
+    return m_framePool->m_reuses;
+}
+
 void V1FSEQFile::prepareRead(const std::vector<std::pair<uint32_t, uint32_t>> &ranges) {
     m_rangesToRead = ranges;
     m_dataBlockSize = 0;
@@ -521,6 +735,8 @@ void V1FSEQFile::prepareRead(const std::vector<std::pair<uint32_t, uint32_t>> &r
         }
         m_dataBlockSize += toRead;
     }
+    setMappedRanges(m_rangesToRead, false);
+    m_framePool->setLayout(m_dataBlockSize, m_rangesToRead);
     FrameData *f = getFrame(0);
     if (f) {
         delete f;
@@ -537,14 +753,19 @@ FrameData *V1FSEQFile::getFrame(uint32_t frame) {
     offset *= frame;
     offset += m_seqChanDataOffset;
 
-    UncompressedFrameData *data = new UncompressedFrameData(frame, m_dataBlockSize, m_rangesToRead);
+    FrameData *mapped = getMappedFrame(frame, offset, m_seqChannelCount);
+    if (mapped) {
+        return mapped;
+    }
+
+    UncompressedFrameData *data = new UncompressedFrameData(frame, m_framePool);
     if (seek(offset, SEEK_SET)) {
         LogErr(VB_SEQUENCE, "Failed to seek to proper offset for channel data for frame %d! %" PRIu64 "\n", frame, offset);
         return data;
     }
     uint32_t sz = 0;
     //read the ranges into the buffer
-    for (auto &rng : data->m_ranges) {
+    for (auto &rng : *data->m_ranges) {
         if (rng.first < m_seqChannelCount) {
             int toRead = rng.second;
             uint64_t doffset = offset;
@@ -575,10 +796,23 @@ uint32_t V1FSEQFile::getMaxChannel() const {
 }
 
 static const int V2FSEQ_HEADER_SIZE = 32;
+//files that older players would play as garbage are written as v2.2, which
+//those players refuse, and files newer than this reader knows are refused
+static const int V2FSEQ_FEATURE_VERSION_MINOR = 2;
+static const int V2FSEQ_MAX_VERSION_MINOR = 2;
+//'ei' variable header, 4 byte block count + 8 byte offset of the index
+static const int V2FSEQ_EXTENDED_INDEX_HEADER_SIZE = 12;
+//'cs' variable header, 4 byte stripe size in channels
+static const int V2FSEQ_STRIPE_HEADER_SIZE = 4;
+//'zd' variable header holds the dictionary, the whole header has to fit
+//within the 16 bit channel data offset
+static const int V2FSEQ_MAX_DICTIONARY_SIZE = 32 * 1024;
 #if !defined(NO_ZLIB) || !defined(NO_ZSTD)
 static const int V2FSEQ_OUT_BUFFER_SIZE = 1024*1024; //1M output buffer
 static const int V2FSEQ_OUT_BUFFER_FLUSH_SIZE = 900 * 1024; //90% full, flush it
 #endif
+static const int V2FSEQ_READAHEAD_BLOCKS = 2;
+static const uint64_t V2FSEQ_READAHEAD_MEMORY = 64 * 1024 * 1024; //64M of decompressed blocks
 
 class V2Handler {
 public:
@@ -597,6 +831,10 @@ public:
     virtual void addFrame(uint32_t frame, const uint8_t *data) = 0;
     virtual void finalize() = 0;
 
+    virtual void setReadAhead(int blocks, uint64_t memoryLimit) {}
+    virtual void setCompressionThreads(int threads) {}
+    virtual void setStripesNeeded(const std::vector<bool> &stripes) {}
+
     int seek(uint64_t location, int origin) {
         return m_file->seek(location, origin);
     }
@@ -612,6 +850,12 @@ public:
     void preload(uint64_t pos, uint64_t size) {
         m_file->preload(pos, size);
     }
+    FrameData *getMappedFrame(uint32_t frame, uint64_t offset, uint32_t frameSize) {
+        return m_file->getMappedFrame(frame, offset, frameSize);
+    }
+    const std::shared_ptr<FSEQFramePool> &framePool() {
+        return m_file->m_framePool;
+    }
 
     V2FSEQFile *m_file;
     uint64_t   m_seqChanDataOffset;
@@ -626,10 +870,14 @@ public:
     virtual uint32_t computeMaxBlocks() override {return 0;}
 
     virtual FrameData *getFrame(uint32_t frame) override {
-        UncompressedFrameData *data = new UncompressedFrameData(frame, m_file->m_dataBlockSize, m_file->m_rangesToRead);
         uint64_t offset = m_file->getChannelCount();
         offset *= frame;
         offset += m_seqChanDataOffset;
+        FrameData *mapped = getMappedFrame(frame, offset, m_file->getChannelCount());
+        if (mapped) {
+            return mapped;
+        }
+        UncompressedFrameData *data = new UncompressedFrameData(frame, framePool());
         if (seek(offset, SEEK_SET)) {
             LogErr(VB_SEQUENCE, "Failed to seek to proper offset for channel data! %" PRIu64 "\n", offset);
             return data;
@@ -637,7 +885,7 @@ public:
         if (m_file->m_sparseRanges.empty()) {
             uint32_t sz = 0;
             //read the ranges into the buffer
-            for (auto &rng : data->m_ranges) {
+            for (auto &rng : *data->m_ranges) {
                 if (rng.first < m_file->getChannelCount()) {
                     int toRead = rng.second;
                     uint64_t doffset = offset;
@@ -673,12 +921,16 @@ public:
 };
 class V2CompressedHandler : public V2Handler {
 public:
-    V2CompressedHandler(V2FSEQFile *f) : V2Handler(f), m_maxBlocks(0), m_curBlock(99999), m_framesPerBlock(0), m_curFrameInBlock(0) {
+    V2CompressedHandler(V2FSEQFile *f) : V2Handler(f), m_maxBlocks(0), m_curBlock(99999), m_framesPerBlock(0), m_curFrameInBlock(0),
+        m_readAheadBlocks(V2FSEQ_READAHEAD_BLOCKS), m_readAheadMemory(V2FSEQ_READAHEAD_MEMORY),
+        m_blocksMemory(0), m_shutdown(false), m_compressionThreads(1), m_blocksStarted(0) {
         if (!m_file->m_frameOffsets.empty()) {
             m_maxBlocks = m_file->m_frameOffsets.size() - 1;
         }
     }
-    virtual ~V2CompressedHandler() {}
+    virtual ~V2CompressedHandler() {
+        stopDecodeThreads();
+    }
 
     virtual uint32_t computeMaxBlocks() override {
         if (m_maxBlocks > 0) {
@@ -688,6 +940,23 @@ public:
         uint64_t datasize = m_file->getChannelCount() * m_file->getNumFrames();
         uint64_t numBlocks = datasize;
         numBlocks /= (64*2014); //at least 64K per block
+        if (m_file->hasExtendedBlockIndex()) {
+            //the extended index has no limit on the number of blocks, keep
+            //each block to about a second of data so a seek never needs to
+            //decompress more than that to reach any frame
+            if (numBlocks < 1) {
+                numBlocks = 1;
+            }
+            m_framesPerBlock = m_file->getNumFrames() / numBlocks;
+            uint32_t framesPerSecond = 1000 / (m_file->getStepTime() ? m_file->getStepTime() : 50);
+            if (m_framesPerBlock > framesPerSecond) m_framesPerBlock = framesPerSecond;
+            if (m_framesPerBlock < 1) m_framesPerBlock = 1;
+            m_curFrameInBlock = 0;
+            // first block is going to be smaller, so add some blocks
+            m_maxBlocks = m_file->getNumFrames() / m_framesPerBlock + 3;
+            m_curBlock = 0;
+            return m_maxBlocks;
+        }
         if (numBlocks > 255) {
             //need a lot of blocks, use as many as we can
             numBlocks = 255;
@@ -718,6 +987,17 @@ public:
     virtual void finalize() override {
         uint64_t curr = tell();
         uint64_t off = V2FSEQ_HEADER_SIZE;
+        if (m_file->hasExtendedBlockIndex()) {
+            //the index goes after the channel data, the 'ei' variable
+            //header then records where it is and how many blocks it has
+            uint8_t buf[12];
+            write4ByteUInt(buf, m_file->m_frameOffsets.size());
+            write4ByteUInt(&buf[4], curr & 0xFFFFFFFF);
+            write4ByteUInt(&buf[8], curr >> 32);
+            seek(m_file->m_extendedIndexPos, SEEK_SET);
+            write(buf, 12);
+            off = curr;
+        }
         seek(off, SEEK_SET);
         int count = m_file->m_frameOffsets.size();
         m_file->m_frameOffsets.push_back(std::pair<uint32_t, uint64_t>(99999999, curr));
@@ -734,15 +1014,534 @@ public:
             //printf("%d    %d: %d\n", x, frame, len);
         }
         m_file->m_frameOffsets.pop_back();
-        seek(curr, SEEK_SET);
+        if (!m_file->hasExtendedBlockIndex()) {
+            seek(curr, SEEK_SET);
+        }
+    }
+
+    virtual void setReadAhead(int blocks, uint64_t memoryLimit) override {
+        std::unique_lock<std::mutex> lock(m_blockLock);
+        m_readAheadBlocks = blocks < 0 ? 0 : blocks;
+        m_readAheadMemory = memoryLimit;
+    }
+
+    virtual void setCompressionThreads(int threads) override {
+        if (threads <= 0) {
+            threads = std::thread::hardware_concurrency();
+        }
+        m_compressionThreads = threads < 1 ? 1 : threads;
+    }
+
+    virtual FrameData *getFrame(uint32_t frame) override {
+        if (m_file->m_frameOffsets.size() < 2) {
+            return nullptr;
+        }
+        std::shared_ptr<DecodedBlock> block = getBlock(findBlock(frame));
+
+        uint64_t fidx = frame - m_file->m_frameOffsets[block->block].first;
+        fidx *= m_file->getChannelCount();
+        //the frame points into the decompressed block so the ranges are
+        //copied once, straight into the channel data, by readFrame
+        return new BlockFrameData(frame, block, &block->data[fidx], framePool(),
+                                  m_file->getChannelCount(), !m_file->m_sparseRanges.empty());
+    }
+
+protected:
+    //decompress a full compression block from in into out, out is
+    //sized to hold every frame in the block.  Called from the decode
+    //threads so implementations cannot use any shared decompression state
+    virtual void decompressBlock(uint32_t block,
+                                 const uint8_t *in, uint64_t inLen,
+                                 uint8_t *out, uint64_t outLen) = 0;
+
+    //compress all the frame data for a block in one go.  Called from the
+    //compression threads, the output must be identical to what addFrame
+    //writes for the same frames so files don't depend on the thread count
+    virtual void compressBlock(const uint8_t *in, uint64_t inLen,
+                               std::vector<uint8_t> &out) = 0;
+
+    //must be called from the subclass destructor so the decode and
+    //compression threads are not running while the subclass is torn down
+    void stopDecodeThreads() {
+        std::unique_lock<std::mutex> lock(m_blockLock);
+        m_shutdown = true;
+        m_decodeQueue.clear();
+        lock.unlock();
+        m_decodeSignal.notify_all();
+        for (auto t : m_decodeThreads) {
+            t->join();
+            delete t;
+        }
+        m_decodeThreads.clear();
+
+        std::unique_lock<std::mutex> clock(m_compressLock);
+        m_compressQueue.clear();
+        clock.unlock();
+        m_compressSignal.notify_all();
+        for (auto t : m_compressThreads) {
+            t->join();
+            delete t;
+        }
+        m_compressThreads.clear();
+    }
+
+    //if we hit the max per block OR we're in the first block and hit frame #10
+    //we'll start a new block.  We want the first block to be small so startup is
+    //quicker and we can get the first few frames as fast as possible.
+    bool isBlockFull(uint32_t blocksStarted) {
+        return (m_curBlock == 0 && m_curFrameInBlock == 10)
+            || (m_curFrameInBlock == m_framesPerBlock && blocksStarted < m_maxBlocks);
+    }
+
+    //frames are collected into full blocks before compressing when using
+    //multiple threads or when each block is split into stripes
+    bool compressByBlock() const {
+        return m_compressionThreads > 1 || m_file->isStriped();
+    }
+
+    //called after a block has been decompressed so subclasses can
+    //post-process the frame data
+    virtual void blockDecoded(uint8_t *data, uint64_t len) {}
+
+    //With multiple compression threads, the frames for a block are collected
+    //and the full block is handed to a compression thread.  Compressed blocks
+    //are written out in order as they complete.
+    void addBlockFrame(uint32_t frame, const uint8_t *data) {
+        if (!m_curCompressJob) {
+            m_curCompressJob = std::make_shared<CompressJob>(frame);
+            m_blocksStarted++;
+            if (m_framesPerBlock) {
+                m_curCompressJob->in.reserve((uint64_t)m_framesPerBlock * m_file->getChannelCount());
+            }
+        }
+        std::vector<uint8_t> &in = m_curCompressJob->in;
+        if (m_file->m_sparseRanges.empty()) {
+            in.insert(in.end(), data, data + m_file->getChannelCount());
+        } else {
+            for (auto &a : m_file->m_sparseRanges) {
+                in.insert(in.end(), &data[a.first], &data[a.first + a.second]);
+            }
+        }
+        m_curFrameInBlock++;
+        if (isBlockFull(m_blocksStarted)) {
+            queueCompressJob();
+            m_curFrameInBlock = 0;
+            m_curBlock++;
+        }
+    }
+    void finishBlocks() {
+        if (m_curFrameInBlock) {
+            queueCompressJob();
+            m_curFrameInBlock = 0;
+            m_curBlock++;
+        }
+        writeCompressedBlocks(0);
+    }
+
+private:
+    class DecodedBlock {
+    public:
+        DecodedBlock(uint32_t b, uint64_t sz) : block(b), data(nullptr), size(sz), ready(false) {}
+        ~DecodedBlock() {
+            if (data) {
+                free(data);
+            }
+        }
+
+        uint32_t block;
+        uint8_t *data;
+        uint64_t size;
+        bool     ready;
+        std::vector<bool> stripesNeeded;
+    };
+
+    //a frame within a decompressed block.  Holding the block keeps it
+    //alive until the frame is done even if it has been dropped from the
+    //block cache.
+    class BlockFrameData : public FSEQFile::FrameData {
+    public:
+        BlockFrameData(uint32_t frame, const std::shared_ptr<DecodedBlock> &block, const uint8_t *data,
+                       const std::shared_ptr<FSEQFramePool> &pool, uint32_t frameSize, bool packed)
+        : FrameData(frame), m_block(block), m_data(data),
+          m_ranges(pool->ranges()), m_frameSize(frameSize), m_packed(packed) {
+        }
+        virtual ~BlockFrameData() {
+        }
+
+        virtual void readFrame(uint8_t *data) override {
+            uint32_t offset = 0;
+            for (auto &rng : *m_ranges) {
+                if (m_packed) {
+                    memcpy(&data[rng.first], &m_data[offset], rng.second);
+                    offset += rng.second;
+                } else if (rng.first < m_frameSize) {
+                    memcpy(&data[rng.first], &m_data[rng.first], rng.second);
+                }
+            }
+        }
+
+        std::shared_ptr<DecodedBlock> m_block;
+        const uint8_t *m_data;
+        std::shared_ptr<const std::vector<std::pair<uint32_t, uint32_t>>> m_ranges;
+        uint32_t m_frameSize;
+        bool m_packed;
+    };
+
+    class CompressJob {
+    public:
+        CompressJob(uint32_t f) : startFrame(f), done(false) {}
+
+        uint32_t startFrame;
+        std::vector<uint8_t> in;
+        std::vector<uint8_t> out;
+        bool done;
+    };
+
+    void queueCompressJob() {
+        std::unique_lock<std::mutex> lock(m_compressLock);
+        m_compressJobs.push_back(m_curCompressJob);
+        m_compressQueue.push_back(m_curCompressJob);
+        m_curCompressJob.reset();
+        while (m_compressThreads.size() < m_compressionThreads) {
+            m_compressThreads.push_back(new std::thread(&V2CompressedHandler::compressThread, this));
+        }
+        lock.unlock();
+        m_compressSignal.notify_one();
+
+        //keep the threads busy, but don't buffer the entire file in memory
+        writeCompressedBlocks(m_compressionThreads * 2);
+    }
+    //write the completed blocks at the front of the list, waiting for blocks
+    //to complete while there are more than maxPending blocks outstanding
+    void writeCompressedBlocks(uint32_t maxPending) {
+        std::unique_lock<std::mutex> lock(m_compressLock);
+        while (!m_compressJobs.empty()) {
+            std::shared_ptr<CompressJob> job = m_compressJobs.front();
+            if (!job->done) {
+                if (m_compressJobs.size() <= maxPending) {
+                    return;
+                }
+                m_compressDoneSignal.wait(lock);
+                continue;
+            }
+            m_compressJobs.pop_front();
+            lock.unlock();
+            m_file->m_frameOffsets.push_back(std::pair<uint32_t, uint64_t>(job->startFrame, tell()));
+            write(&job->out[0], job->out.size());
+            lock.lock();
+        }
+    }
+    uint32_t stripeCount() {
+        return (m_file->getChannelCount() + m_file->m_stripeSize - 1) / m_file->m_stripeSize;
+    }
+    //A striped block starts with a table of the compressed length of each
+    //stripe followed by the stripes.  Each stripe is the data for its
+    //channels from every frame in the block compressed on its own.
+    void compressStripes(const std::vector<uint8_t> &in, std::vector<uint8_t> &out) {
+        uint32_t cc = m_file->getChannelCount();
+        uint32_t stripeSize = m_file->m_stripeSize;
+        uint32_t stripes = stripeCount();
+        uint64_t frames = in.size() / cc;
+
+        out.assign(stripes * 4, 0);
+        std::vector<uint8_t> stripe;
+        std::vector<uint8_t> compressed;
+        for (uint32_t s = 0; s < stripes; s++) {
+            uint32_t start = s * stripeSize;
+            uint32_t width = std::min(stripeSize, cc - start);
+            stripe.resize(frames * width);
+            for (uint64_t f = 0; f < frames; f++) {
+                memcpy(&stripe[f * width], &in[f * cc + start], width);
+            }
+            compressBlock(&stripe[0], stripe.size(), compressed);
+            write4ByteUInt(&out[s * 4], compressed.size());
+            out.insert(out.end(), compressed.begin(), compressed.end());
+        }
+    }
+    void compressThread() {
+        std::unique_lock<std::mutex> lock(m_compressLock);
+        while (!m_shutdown) {
+            if (m_compressQueue.empty()) {
+                m_compressSignal.wait(lock);
+                continue;
+            }
+            std::shared_ptr<CompressJob> job = m_compressQueue.front();
+            m_compressQueue.pop_front();
+            lock.unlock();
+            if (m_file->isStriped()) {
+                compressStripes(job->in, job->out);
+            } else {
+                compressBlock(&job->in[0], job->in.size(), job->out);
+            }
+            std::vector<uint8_t>().swap(job->in);
+            lock.lock();
+            job->done = true;
+            m_compressDoneSignal.notify_all();
+        }
+    }
+
+    uint32_t findBlock(uint32_t frame) {
+        //m_frameOffsets is sorted by frame and ends with a sentinel entry
+        auto it = std::upper_bound(m_file->m_frameOffsets.begin(), m_file->m_frameOffsets.end() - 1, frame,
+                                   [](uint32_t f, const std::pair<uint32_t, uint64_t> &a) { return f < a.first; });
+        if (it == m_file->m_frameOffsets.begin()) {
+            return 0;
+        }
+        return (it - m_file->m_frameOffsets.begin()) - 1;
+    }
+    uint64_t blockDataSize(uint32_t block) {
+        uint32_t endFrame = m_file->m_frameOffsets[block + 1].first;
+        if (endFrame > m_file->getNumFrames()) {
+            endFrame = m_file->getNumFrames();
+        }
+        uint64_t numFrames = endFrame - m_file->m_frameOffsets[block].first;
+        return numFrames * m_file->getChannelCount();
+    }
+
+    //assumes m_blockLock is held
+    std::shared_ptr<DecodedBlock> queueBlock(uint32_t block) {
+        std::shared_ptr<DecodedBlock> b = std::make_shared<DecodedBlock>(block, blockDataSize(block));
+        b->stripesNeeded = m_stripesNeeded;
+        m_blocks[block] = b;
+        m_blocksMemory += b->size;
+        m_decodeQueue.push_back(b);
+        return b;
+    }
+
+    virtual void setStripesNeeded(const std::vector<bool> &stripes) override {
+        //blocks already decoded may be missing stripes that are now needed
+        std::unique_lock<std::mutex> lock(m_blockLock);
+        m_stripesNeeded = stripes;
+        m_blocks.clear();
+        m_decodeQueue.clear();
+        m_blocksMemory = 0;
+    }
+
+    std::shared_ptr<DecodedBlock> getBlock(uint32_t block) {
+        std::unique_lock<std::mutex> lock(m_blockLock);
+        if (block != m_curBlock) {
+            //drop everything that is not the new block or in the read ahead
+            //window after it.  Blocks still being decoded are held by the
+            //decode thread until it finishes with them.
+            m_curBlock = block;
+            for (auto it = m_blocks.begin(); it != m_blocks.end(); ) {
+                if (it->first < block || it->first > (block + m_readAheadBlocks)) {
+                    m_blocksMemory -= it->second->size;
+                    m_decodeQueue.remove(it->second);
+                    it = m_blocks.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        std::shared_ptr<DecodedBlock> cur;
+        auto it = m_blocks.find(block);
+        if (it == m_blocks.end()) {
+            cur = queueBlock(block);
+        } else {
+            cur = it->second;
+        }
+
+        uint32_t numBlocks = m_file->m_frameOffsets.size() - 1;
+        for (uint32_t b = block + 1; b <= (block + m_readAheadBlocks) && b < numBlocks; b++) {
+            if (m_blocks.find(b) == m_blocks.end()) {
+                if ((m_blocksMemory + blockDataSize(b)) > m_readAheadMemory) {
+                    break;
+                }
+                queueBlock(b);
+            }
+        }
+
+        if (!cur->ready) {
+            auto qit = std::find(m_decodeQueue.begin(), m_decodeQueue.end(), cur);
+            if (qit != m_decodeQueue.end()) {
+                //none of the decode threads have gotten to it yet, decode it
+                //here so we don't wait behind the read ahead blocks
+                m_decodeQueue.erase(qit);
+                startDecodeThreads();
+                lock.unlock();
+                m_decodeSignal.notify_all();
+                loadBlock(cur.get());
+                lock.lock();
+                cur->ready = true;
+            } else {
+                startDecodeThreads();
+                lock.unlock();
+                m_decodeSignal.notify_all();
+                lock.lock();
+                while (!cur->ready) {
+                    m_blockDecodedSignal.wait(lock);
+                }
+            }
+        } else if (!m_decodeQueue.empty()) {
+            startDecodeThreads();
+            lock.unlock();
+            m_decodeSignal.notify_all();
+        }
+        return cur;
     }
 
+    void loadBlock(DecodedBlock *b) {
+        if (m_file->isStriped()) {
+            loadStripedBlock(b);
+            return;
+        }
+        uint64_t offset = m_file->m_frameOffsets[b->block].second;
+        uint64_t len = m_file->m_frameOffsets[b->block + 1].second;
+        len -= offset;
+        uint8_t *in = (uint8_t*)malloc(len);
+
+        std::unique_lock<std::mutex> lock(m_fileLock);
+        seek(offset, SEEK_SET);
+        uint64_t bread = read(in, len);
+        if (b->block < m_file->m_frameOffsets.size() - 2) {
+            //let the kernel know that we'll likely need the next block in the near future
+            uint64_t len2 = m_file->m_frameOffsets[b->block + 2].second;
+            len2 -= m_file->m_frameOffsets[b->block + 1].second;
+            preload(tell(), len2);
+        }
+        lock.unlock();
+        if (bread != len) {
+            LogErr(VB_SEQUENCE, "Failed to read channel data for block %d!   Needed to read %" PRIu64 " but read %d\n", b->block, len, (int)bread);
+        }
+
+        //zeroed so a short read or a decode error gives dark channels
+        //instead of whatever was in the heap
+        b->data = (uint8_t*)calloc(1, b->size);
+        decompressBlock(b->block, in, bread, b->data, b->size);
+        free(in);
+        blockDecoded(b->data, b->size);
+    }
+
+    //only read and decompress the stripes of the block that contain
+    //channels that are needed, the rest of the block data is left zeroed
+    void loadStripedBlock(DecodedBlock *b) {
+        uint64_t offset = m_file->m_frameOffsets[b->block].second;
+        uint64_t len = m_file->m_frameOffsets[b->block + 1].second;
+        len -= offset;
+        uint32_t cc = m_file->getChannelCount();
+        uint32_t stripeSize = m_file->m_stripeSize;
+        uint32_t stripes = stripeCount();
+        uint64_t frames = b->size / cc;
+        b->data = (uint8_t*)calloc(1, b->size);
+
+        std::vector<uint8_t> table(stripes * 4);
+        std::unique_lock<std::mutex> lock(m_fileLock);
+        seek(offset, SEEK_SET);
+        uint64_t bread = read(&table[0], table.size());
+        lock.unlock();
+        if (bread != table.size()) {
+            LogErr(VB_SEQUENCE, "Failed to read stripe table for block %d\n", b->block);
+            return;
+        }
+        std::vector<uint64_t> stripeOffsets(stripes + 1);
+        stripeOffsets[0] = table.size();
+        for (uint32_t s = 0; s < stripes; s++) {
+            stripeOffsets[s + 1] = stripeOffsets[s] + read4ByteUInt(&table[s * 4]);
+        }
+        if (stripeOffsets[stripes] > len) {
+            LogErr(VB_SEQUENCE, "Invalid stripe table for block %d\n", b->block);
+            return;
+        }
+
+        std::vector<uint8_t> in;
+        std::vector<uint8_t> stripe;
+        uint32_t s = 0;
+        while (s < stripes) {
+            if (!b->stripesNeeded.empty() && !b->stripesNeeded[s]) {
+                s++;
+                continue;
+            }
+            //read runs of needed stripes with a single read
+            uint32_t end = s + 1;
+            while (end < stripes && (b->stripesNeeded.empty() || b->stripesNeeded[end])) {
+                end++;
+            }
+            uint32_t runStart = s;
+            uint64_t runLen = stripeOffsets[end] - stripeOffsets[runStart];
+            in.resize(runLen);
+            lock.lock();
+            seek(offset + stripeOffsets[runStart], SEEK_SET);
+            bread = runLen ? read(&in[0], runLen) : 0;
+            lock.unlock();
+            if (bread != runLen) {
+                LogErr(VB_SEQUENCE, "Failed to read channel data for block %d!   Needed to read %" PRIu64 " but read %d\n", b->block, runLen, (int)bread);
+            }
+
+            for (; s < end; s++) {
+                uint32_t start = s * stripeSize;
+                uint32_t width = std::min(stripeSize, cc - start);
+                stripe.assign(frames * width, 0);
+                decompressBlock(b->block, &in[stripeOffsets[s] - stripeOffsets[runStart]],
+                                stripeOffsets[s + 1] - stripeOffsets[s], &stripe[0], stripe.size());
+                for (uint64_t f = 0; f < frames; f++) {
+                    memcpy(&b->data[f * cc + start], &stripe[f * width], width);
+                }
+            }
+        }
+        blockDecoded(b->data, b->size);
+    }
 
+    //assumes m_blockLock is held
+    void startDecodeThreads() {
+        int count = m_readAheadBlocks;
+        int cores = std::thread::hardware_concurrency();
+        if (cores > 0 && count > cores) {
+            count = cores;
+        }
+        while (m_decodeThreads.size() < count && !m_shutdown) {
+            m_decodeThreads.push_back(new std::thread(&V2CompressedHandler::decodeThread, this));
+        }
+    }
+    void decodeThread() {
+        std::unique_lock<std::mutex> lock(m_blockLock);
+        while (!m_shutdown) {
+            if (m_decodeQueue.empty()) {
+                m_decodeSignal.wait(lock);
+                continue;
+            }
+            std::shared_ptr<DecodedBlock> b = m_decodeQueue.front();
+            m_decodeQueue.pop_front();
+            lock.unlock();
+            loadBlock(b.get());
+            lock.lock();
+            b->ready = true;
+            m_blockDecodedSignal.notify_all();
+        }
+    }
+
+public:
     // for compressed files, this is the compression data
     uint32_t m_framesPerBlock;
     uint32_t m_curFrameInBlock;
     uint32_t m_curBlock;
     uint32_t m_maxBlocks;
+
+private:
+    //background decompression of the blocks following the current block
+    int      m_readAheadBlocks;
+    uint64_t m_readAheadMemory;
+    uint64_t m_blocksMemory;
+    std::atomic<bool> m_shutdown;
+    std::map<uint32_t, std::shared_ptr<DecodedBlock>> m_blocks;
+    std::list<std::shared_ptr<DecodedBlock>> m_decodeQueue;
+    std::vector<bool> m_stripesNeeded;
+    std::vector<std::thread*> m_decodeThreads;
+    std::mutex m_blockLock;
+    std::mutex m_fileLock;
+    std::condition_variable m_decodeSignal;
+    std::condition_variable m_blockDecodedSignal;
+
+    //parallel compression while writing
+    int      m_compressionThreads;
+    uint32_t m_blocksStarted;
+    std::shared_ptr<CompressJob> m_curCompressJob;
+    std::list<std::shared_ptr<CompressJob>> m_compressJobs;
+    std::list<std::shared_ptr<CompressJob>> m_compressQueue;
+    std::vector<std::thread*> m_compressThreads;
+    std::mutex m_compressLock;
+    std::condition_variable m_compressSignal;
+    std::condition_variable m_compressDoneSignal;
 };
 
 #ifndef NO_ZSTD
@@ -750,86 +1549,87 @@ class V2ZSTDCompressionHandler : public V2CompressedHandler {
 public:
     V2ZSTDCompressionHandler(V2FSEQFile *f) : V2CompressedHandler(f),
     m_cctx(nullptr),
-    m_dctx(nullptr)
+    m_cdict(nullptr),
+    m_ddict(nullptr)
     {
         m_outBuffer.pos = 0;
         m_outBuffer.size = V2FSEQ_OUT_BUFFER_SIZE;
         m_outBuffer.dst = malloc(m_outBuffer.size);
-        m_inBuffer.src = nullptr;
-        m_inBuffer.size = 0;
-        m_inBuffer.pos = 0;
     }
     virtual ~V2ZSTDCompressionHandler() {
+        stopDecodeThreads();
         free(m_outBuffer.dst);
-        if (m_inBuffer.src != nullptr) {
-            free((void*)m_inBuffer.src);
-        }
-        if (m_dctx) {
+        if (m_cctx) {
             ZSTD_freeCStream(m_cctx);
         }
-        if (m_dctx) {
-            ZSTD_freeDStream(m_dctx);
+        if (m_cdict) {
+            ZSTD_freeCDict(m_cdict);
+        }
+        if (m_ddict) {
+            ZSTD_freeDDict(m_ddict);
         }
     }
     virtual uint8_t getCompressionType() override { return 1;}
 
-    virtual FrameData *getFrame(uint32_t frame) override {
-        if (m_curBlock > 256 || (frame < m_file->m_frameOffsets[m_curBlock].first) || (frame >= m_file->m_frameOffsets[m_curBlock + 1].first)) {
-            //frame is not in the current block
-            m_curBlock = 0;
-            while (frame >= m_file->m_frameOffsets[m_curBlock + 1].first) {
-                m_curBlock++;
-            }
-            if (m_dctx == nullptr) {
-                m_dctx = ZSTD_createDStream();
-            }
-            ZSTD_initDStream(m_dctx);
-            seek(m_file->m_frameOffsets[m_curBlock].second, SEEK_SET);
-
-            uint64_t len = m_file->m_frameOffsets[m_curBlock + 1].second;
-            len -= m_file->m_frameOffsets[m_curBlock].second;
-            if (m_inBuffer.src) {
-                free((void*)m_inBuffer.src);
-            }
-            m_inBuffer.src = malloc(len);
-            m_inBuffer.pos = 0;
-            m_inBuffer.size = len;
-            int bread = read((void*)m_inBuffer.src, len);
-            if (bread != len) {
-                LogErr(VB_SEQUENCE, "Failed to read channel data for frame %d!   Needed to read %" PRIu64 " but read %d\n", frame, len, (int)bread);
-            }
+    //the digested dictionaries are created on first use and then shared,
+    //read only, by all the compression and decode threads
+    const ZSTD_CDict *getCDict() {
+        if (!m_file->hasCompressionDictionary()) {
+            return nullptr;
+        }
+        std::unique_lock<std::mutex> lock(m_dictLock);
+        if (m_cdict == nullptr) {
+            m_cdict = ZSTD_createCDict(&m_file->m_compressionDictionary[0],
+                                       m_file->m_compressionDictionary.size(),
+                                       compressionLevel());
+        }
+        return m_cdict;
+    }
+    const ZSTD_DDict *getDDict() {
+        if (!m_file->hasCompressionDictionary()) {
+            return nullptr;
+        }
+        std::unique_lock<std::mutex> lock(m_dictLock);
+        if (m_ddict == nullptr) {
+            m_ddict = ZSTD_createDDict(&m_file->m_compressionDictionary[0],
+                                       m_file->m_compressionDictionary.size());
+        }
+        return m_ddict;
+    }
+    void initCStream(ZSTD_CStream *cctx) {
+        ZSTD_initCStream(cctx, compressionLevel());
+        const ZSTD_CDict *cdict = getCDict();
+        if (cdict) {
+            ZSTD_CCtx_refCDict(cctx, cdict);
+        }
+    }
+    void initDStream(ZSTD_DStream *dctx) {
+        ZSTD_initDStream(dctx);
+        const ZSTD_DDict *ddict = getDDict();
+        if (ddict) {
+            ZSTD_DCtx_refDDict(dctx, ddict);
+        }
+    }
 
-            if (m_curBlock < m_file->m_frameOffsets.size() - 2) {
-                //let the kernel know that we'll likely need the next block in the near future
-                uint64_t len2 = m_file->m_frameOffsets[m_curBlock + 2].second;
-                len2 -= m_file->m_frameOffsets[m_curBlock+1].second;
-                preload(tell(), len2);
+    virtual void decompressBlock(uint32_t block,
+                                 const uint8_t *in, uint64_t inLen,
+                                 uint8_t *out, uint64_t outLen) override {
+        ZSTD_DStream *dctx = ZSTD_createDStream();
+        initDStream(dctx);
+        ZSTD_inBuffer_s input = { in, inLen, 0 };
+        ZSTD_outBuffer_s output = { out, outLen, 0 };
+        while (input.pos < input.size && output.pos < output.size) {
+            size_t ret = ZSTD_decompressStream(dctx, &output, &input);
+            if (ZSTD_isError(ret)) {
+                LogErr(VB_SEQUENCE, "Failed to decompress block %d: %s\n", block, ZSTD_getErrorName(ret));
+                break;
             }
-
-            free(m_outBuffer.dst);
-            int numFrames = (m_file->m_frameOffsets[m_curBlock + 1].first > m_file->getNumFrames() ? m_file->getNumFrames() :  m_file->m_frameOffsets[m_curBlock + 1].first) - m_file->m_frameOffsets[m_curBlock].first;
-            m_outBuffer.size = numFrames * m_file->getChannelCount();
-            m_outBuffer.dst = malloc(m_outBuffer.size);
-            m_outBuffer.pos = 0;
-            ZSTD_decompressStream(m_dctx, &m_outBuffer, &m_inBuffer);
-        }
-        int fidx = frame - m_file->m_frameOffsets[m_curBlock].first;
-        fidx *= m_file->getChannelCount();
-        uint8_t *fdata = (uint8_t*)m_outBuffer.dst;
-        UncompressedFrameData *data = new UncompressedFrameData(frame, m_file->m_dataBlockSize, m_file->m_rangesToRead);
-        if (!m_file->m_sparseRanges.empty()) {
-            memcpy(data->m_data, &fdata[fidx], m_file->getChannelCount());
-        } else {
-            uint32_t sz = 0;
-            //read the ranges into the buffer
-            for (auto &rng : data->m_ranges) {
-                if (rng.first < m_file->getChannelCount()) {
-                    memcpy(&data->m_data[sz], &fdata[fidx + rng.first], rng.second);
-                    sz += rng.second;
-                }
+            if (ret == 0 && input.pos < input.size) {
+                //end of a zstd frame, there may be more frames in the block
+                initDStream(dctx);
             }
         }
-        return data;
+        ZSTD_freeDStream(dctx);
     }
     void compressData(ZSTD_CStream* m_cctx, ZSTD_inBuffer_s &input, ZSTD_outBuffer_s &output) {
         ZSTD_compressStream(m_cctx, &output, &input);
@@ -850,7 +1650,33 @@ public:
             count += input.pos;
         }
     }
+    int compressionLevel() {
+        int clevel = m_file->m_compressionLevel == -1 ? 10 : m_file->m_compressionLevel;
+        if (clevel < 0 || clevel > 25) {
+            clevel = 10;
+        }
+        return clevel;
+    }
+    virtual void compressBlock(const uint8_t *in, uint64_t inLen,
+                               std::vector<uint8_t> &out) override {
+        ZSTD_CStream *cctx = ZSTD_createCStream();
+        initCStream(cctx);
+        out.resize(ZSTD_compressBound(inLen));
+        ZSTD_inBuffer_s input = { in, inLen, 0 };
+        ZSTD_outBuffer_s output = { &out[0], out.size(), 0 };
+        while (input.pos < input.size) {
+            ZSTD_compressStream(cctx, &output, &input);
+        }
+        while (ZSTD_endStream(cctx, &output) > 0) {
+        }
+        out.resize(output.pos);
+        ZSTD_freeCStream(cctx);
+    }
     virtual void addFrame(uint32_t frame, const uint8_t *data) override {
+        if (compressByBlock()) {
+            addBlockFrame(frame, data);
+            return;
+        }
 
         if (m_cctx == nullptr) {
             m_cctx = ZSTD_createCStream();
@@ -858,11 +1684,7 @@ public:
         if (m_curFrameInBlock == 0) {
             uint64_t offset = tell();
             m_file->m_frameOffsets.push_back(std::pair<uint32_t, uint64_t>(frame, offset));
-            int clevel = m_file->m_compressionLevel == -1 ? 10 : m_file->m_compressionLevel;
-            if (clevel < 0 || clevel > 25) {
-                clevel = 10;
-            }
-            ZSTD_initCStream(m_cctx, clevel);
+            initCStream(m_cctx);
         }
 
         uint8_t *curData = (uint8_t *)data;
@@ -891,11 +1713,7 @@ public:
         }
 
         m_curFrameInBlock++;
-        //if we hit the max per block OR we're in the first block and hit frame #10
-        //we'll start a new block.  We want the first block to be small so startup is
-        //quicker and we can get the first few frames as fast as possible.
-        if ((m_curBlock == 0 && m_curFrameInBlock == 10)
-            || (m_curFrameInBlock == m_framesPerBlock && m_file->m_frameOffsets.size() < m_maxBlocks)) {
+        if (isBlockFull(m_file->m_frameOffsets.size())) {
             while(ZSTD_endStream(m_cctx, &m_outBuffer) > 0) {
                 write(m_outBuffer.dst, m_outBuffer.pos);
                 m_outBuffer.pos = 0;
@@ -907,7 +1725,9 @@ public:
         }
     }
     virtual void finalize() override {
-        if (m_curFrameInBlock) {
+        if (compressByBlock()) {
+            finishBlocks();
+        } else if (m_curFrameInBlock) {
             while(ZSTD_endStream(m_cctx, &m_outBuffer) > 0) {
                 write(m_outBuffer.dst, m_outBuffer.pos);
                 m_outBuffer.pos = 0;
@@ -921,94 +1741,129 @@ public:
     }
 
     ZSTD_CStream* m_cctx;
-    ZSTD_DStream* m_dctx;
     ZSTD_outBuffer_s m_outBuffer;
-    ZSTD_inBuffer_s m_inBuffer;
+    ZSTD_CDict *m_cdict;
+    ZSTD_DDict *m_ddict;
+    std::mutex m_dictLock;
+};
+
+//dst = a ^ b, a word at a time
+static void xorFrameData(uint8_t *dst, const uint8_t *a, const uint8_t *b, uint64_t len) {
+    uint64_t x = 0;
+    for (; (x + 8) <= len; x += 8) {
+        uint64_t wa, wb;
+        memcpy(&wa, &a[x], 8);
+        memcpy(&wb, &b[x], 8);
+        wa ^= wb;
+        memcpy(&dst[x], &wa, 8);
+    }
+    for (; x < len; x++) {
+        dst[x] = a[x] ^ b[x];
+    }
+}
+
+//zstd with each frame stored as the XOR against the previous frame.  Most
+//channels don't change from frame to frame so the deltas are mostly zeros
+//and compress far better.  The first frame of each block is stored as is
+//so blocks can still be decompressed independently.
+class V2ZSTDDeltaCompressionHandler : public V2ZSTDCompressionHandler {
+public:
+    V2ZSTDDeltaCompressionHandler(V2FSEQFile *f) : V2ZSTDCompressionHandler(f) {}
+    virtual ~V2ZSTDDeltaCompressionHandler() {
+        stopDecodeThreads();
+    }
+    virtual uint8_t getCompressionType() override { return 3;}
+
+    virtual void blockDecoded(uint8_t *data, uint64_t len) override {
+        uint64_t frameSize = m_file->getChannelCount();
+        for (uint64_t off = frameSize; (off + frameSize) <= len; off += frameSize) {
+            xorFrameData(&data[off], &data[off], &data[off - frameSize], frameSize);
+        }
+    }
+    virtual void addFrame(uint32_t frame, const uint8_t *data) override {
+        uint32_t frameSize = m_file->getChannelCount();
+        for (auto &a : m_file->m_sparseRanges) {
+            frameSize = std::max(frameSize, a.first + a.second);
+        }
+        if (m_lastFrame.size() != frameSize) {
+            m_lastFrame.resize(frameSize);
+            m_delta.resize(frameSize);
+        }
+        if (m_curFrameInBlock == 0) {
+            memcpy(&m_lastFrame[0], data, frameSize);
+            V2ZSTDCompressionHandler::addFrame(frame, data);
+            return;
+        }
+        xorFrameData(&m_delta[0], data, &m_lastFrame[0], frameSize);
+        memcpy(&m_lastFrame[0], data, frameSize);
+        V2ZSTDCompressionHandler::addFrame(frame, &m_delta[0]);
+    }
+
+    std::vector<uint8_t> m_lastFrame;
+    std::vector<uint8_t> m_delta;
 };
 #endif
 
 #ifndef NO_ZLIB
 class V2ZLIBCompressionHandler : public V2CompressedHandler {
 public:
-    V2ZLIBCompressionHandler(V2FSEQFile *f) : V2CompressedHandler(f), m_stream(nullptr), m_outBuffer(nullptr), m_inBuffer(nullptr) {
+    V2ZLIBCompressionHandler(V2FSEQFile *f) : V2CompressedHandler(f), m_stream(nullptr), m_outBuffer(nullptr) {
     }
     virtual ~V2ZLIBCompressionHandler() {
+        stopDecodeThreads();
         if (m_outBuffer) {
             free(m_outBuffer);
         }
-        if (m_inBuffer) {
-            free(m_inBuffer);
+        if (m_stream) {
+            deflateEnd(m_stream);
+            free(m_stream);
         }
     }
     virtual uint8_t getCompressionType() override { return 2; }
 
-
-    virtual FrameData *getFrame(uint32_t frame) override {
-        if (m_curBlock > 256 || (frame < m_file->m_frameOffsets[m_curBlock].first) || (frame >= m_file->m_frameOffsets[m_curBlock + 1].first)) {
-            //frame is not in the current block
-            m_curBlock = 0;
-            while (frame >= m_file->m_frameOffsets[m_curBlock + 1].first) {
-                m_curBlock++;
-            }
-            seek(m_file->m_frameOffsets[m_curBlock].second, SEEK_SET);
-            uint64_t len = m_file->m_frameOffsets[m_curBlock + 1].second;
-            len -= m_file->m_frameOffsets[m_curBlock].second;
-            if (m_inBuffer) {
-                free(m_inBuffer);
-            }
-            m_inBuffer = (uint8_t*)malloc(len);
-
-            int bread = read((void*)m_inBuffer, len);
-            if (bread != len) {
-                LogErr(VB_SEQUENCE, "Failed to read channel data for frame %d!   Needed to read %" PRIu64 " but read %d\n", frame, len, (int)bread);
-            }
-
-            if (m_curBlock < m_file->m_frameOffsets.size() - 2) {
-                //let the kernel know that we'll likely need the next block in the near future
-                uint64_t len = m_file->m_frameOffsets[m_curBlock + 2].second;
-                len -= m_file->m_frameOffsets[m_curBlock+1].second;
-                preload(tell(), len);
-            }
-
-            if (m_stream == nullptr) {
-                m_stream = (z_stream*)calloc(1, sizeof(z_stream));
-                m_stream->next_in = m_inBuffer;
-                m_stream->avail_in = len;
-                inflateInit(m_stream);
-            }
-            if (m_outBuffer != nullptr) {
-                free(m_outBuffer);
-            }
-            int numFrames = (m_file->m_frameOffsets[m_curBlock + 1].first > m_file->getNumFrames() ? m_file->getNumFrames() :  m_file->m_frameOffsets[m_curBlock + 1].first) - m_file->m_frameOffsets[m_curBlock].first;
-            int outsize = numFrames * m_file->getChannelCount();
-            m_outBuffer = (uint8_t*)malloc(outsize);
-            m_stream->next_out = m_outBuffer;
-            m_stream->avail_out = outsize;
-
-            inflate(m_stream, Z_SYNC_FLUSH);
-            inflateEnd(m_stream);
-            free(m_stream);
-            m_stream = nullptr;
+    virtual void decompressBlock(uint32_t block,
+                                 const uint8_t *in, uint64_t inLen,
+                                 uint8_t *out, uint64_t outLen) override {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        stream.next_in = (uint8_t*)in;
+        stream.avail_in = inLen;
+        inflateInit(&stream);
+        stream.next_out = out;
+        stream.avail_out = outLen;
+        int ret = inflate(&stream, Z_SYNC_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END) {
+            LogErr(VB_SEQUENCE, "Failed to decompress block %d: %d\n", block, ret);
         }
-        int fidx = frame - m_file->m_frameOffsets[m_curBlock].first;
-        fidx *= m_file->getChannelCount();
-        uint8_t *fdata = (uint8_t*)m_outBuffer;
-        UncompressedFrameData *data = new UncompressedFrameData(frame, m_file->m_dataBlockSize, m_file->m_rangesToRead);
-        if (!m_file->m_sparseRanges.empty()) {
-            memcpy(data->m_data, &fdata[fidx], m_file->getChannelCount());
-        } else {
-            uint32_t sz = 0;
-            //read the ranges into the buffer
-            for (auto &rng : data->m_ranges) {
-                if (rng.first < m_file->getChannelCount()) {
-                    memcpy(&data->m_data[sz], &fdata[fidx + rng.first], rng.second);
-                    sz += rng.second;
-                }
-            }
+        inflateEnd(&stream);
+    }
+    int compressionLevel() {
+        int clevel = m_file->m_compressionLevel == -1 ? 3 : m_file->m_compressionLevel;
+        if (clevel < 0 || clevel > 9) {
+            clevel = 3;
         }
-        return data;
+        return clevel;
+    }
+    virtual void compressBlock(const uint8_t *in, uint64_t inLen,
+                               std::vector<uint8_t> &out) override {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        deflateInit(&stream, compressionLevel());
+        out.resize(deflateBound(&stream, inLen));
+        stream.next_in = (uint8_t*)in;
+        stream.avail_in = inLen;
+        stream.next_out = &out[0];
+        stream.avail_out = out.size();
+        while (deflate(&stream, Z_FINISH) == Z_OK) {
+        }
+        out.resize(stream.total_out);
+        deflateEnd(&stream);
     }
     virtual void addFrame(uint32_t frame, const uint8_t *data) override {
+        if (compressByBlock()) {
+            addBlockFrame(frame, data);
+            return;
+        }
         if (m_outBuffer == nullptr) {
             m_outBuffer = (uint8_t*)malloc(V2FSEQ_OUT_BUFFER_SIZE);
         }
@@ -1022,11 +1877,7 @@ public:
             memset(m_stream, 0, sizeof(z_stream));
         }
         if (m_curFrameInBlock == 0) {
-            int clevel = m_file->m_compressionLevel == -1 ? 3 : m_file->m_compressionLevel;
-            if (clevel < 0 || clevel > 9) {
-                clevel = 3;
-            }
-            deflateInit(m_stream, clevel);
+            deflateInit(m_stream, compressionLevel());
             m_stream->next_out = m_outBuffer;
             m_stream->avail_out = V2FSEQ_OUT_BUFFER_SIZE;
         }
@@ -1052,11 +1903,7 @@ public:
             m_stream->avail_out = V2FSEQ_OUT_BUFFER_SIZE;
         }
         m_curFrameInBlock++;
-        //if we hit the max per block OR we're in the first block and hit frame #10
-        //we'll start a new block.  We want the first block to be small so startup is
-        //quicker and we can get the first few frames as fast as possible.
-        if ((m_curBlock == 0 && m_curFrameInBlock == 10)
-            || (m_curFrameInBlock == m_framesPerBlock && m_file->m_frameOffsets.size() < m_maxBlocks)) {
+        if (isBlockFull(m_file->m_frameOffsets.size())) {
 
             while (deflate(m_stream, Z_FINISH) != Z_STREAM_END) {
                 uint64_t sz = V2FSEQ_OUT_BUFFER_SIZE;
@@ -1076,7 +1923,9 @@ public:
         }
     }
     virtual void finalize() override {
-        if (m_curFrameInBlock) {
+        if (compressByBlock()) {
+            finishBlocks();
+        } else if (m_curFrameInBlock) {
             while (deflate(m_stream, Z_FINISH) != Z_STREAM_END) {
                 uint64_t sz = V2FSEQ_OUT_BUFFER_SIZE;
                 sz -= m_stream->avail_out;
@@ -1098,7 +1947,6 @@ public:
 
     z_stream *m_stream;
     uint8_t *m_outBuffer;
-    uint8_t *m_inBuffer;
 };
 #endif
 
@@ -1113,6 +1961,13 @@ void V2FSEQFile::createHandler() {
         LogErr(VB_ALL, "No support for zstd compression");
 #else
         m_handler = new V2ZSTDCompressionHandler(this);
+#endif
+        break;
+    case CompressionType::zstdDelta:
+#ifdef NO_ZSTD
+        LogErr(VB_ALL, "No support for zstd compression");
+#else
+        m_handler = new V2ZSTDDeltaCompressionHandler(this);
 #endif
         break;
     case CompressionType::zlib:
@@ -1132,13 +1987,24 @@ V2FSEQFile::V2FSEQFile(const std::string &fn, CompressionType ct, int cl)
     : FSEQFile(fn),
     m_compressionType(ct),
     m_compressionLevel(cl),
-    m_handler(nullptr)
+    m_extendedIndexPos(0),
+    m_stripeSize(0),
+    m_handler(nullptr),
+    m_supported(true)
 {
     m_seqVersionMajor = 2;
     m_seqVersionMinor = 0;
     createHandler();
 }
+//true if the file uses something a v2.0/v2.1 reader cannot decode
+bool V2FSEQFile::needsFeatureVersion() const {
+    return m_compressionType == CompressionType::zstdDelta || isStriped() || hasCompressionDictionary();
+}
 void V2FSEQFile::writeHeader() {
+    //before anything looks at the version, v2.2 also uses the v2.1 layout
+    if (needsFeatureVersion() && m_seqVersionMinor < V2FSEQ_FEATURE_VERSION_MINOR) {
+        m_seqVersionMinor = V2FSEQ_FEATURE_VERSION_MINOR;
+    }
     if (!m_sparseRanges.empty()) {
         //make sure the sparse ranges fit, and then
         //recalculate the channel count for in the fseq
@@ -1160,7 +2026,7 @@ void V2FSEQFile::writeHeader() {
     header[2] = 'E';
     header[3] = 'Q';
 
-    header[6] = 0; //minor
+    header[6] = m_seqVersionMinor; //minor
     header[7] = 2; //major
 
     // Step Size
@@ -1189,7 +2055,12 @@ void V2FSEQFile::writeHeader() {
     memcpy(&header[24], &m_uniqueId, sizeof(m_uniqueId));
 
     // index size
-    uint32_t maxBlocks = m_handler->computeMaxBlocks() & 0xFF;
+    uint32_t maxBlocks = m_handler->computeMaxBlocks();
+    if (hasExtendedBlockIndex()) {
+        //blocks are in the extended index written after the channel data
+        maxBlocks = 0;
+    }
+    maxBlocks &= 0xFF;
     header[21] = maxBlocks;
 
     int headerSize = V2FSEQ_HEADER_SIZE + maxBlocks * 8 + m_sparseRanges.size() * 6;
@@ -1201,6 +2072,15 @@ void V2FSEQFile::writeHeader() {
     for (auto &a : m_variableHeaders) {
         dataOffset += a.data.size() + 4;
     }
+    if (hasExtendedBlockIndex()) {
+        dataOffset += V2FSEQ_EXTENDED_INDEX_HEADER_SIZE + 4;
+    }
+    if (isStriped()) {
+        dataOffset += V2FSEQ_STRIPE_HEADER_SIZE + 4;
+    }
+    if (hasCompressionDictionary()) {
+        dataOffset += m_compressionDictionary.size() + 4;
+    }
     dataOffset = roundTo4(dataOffset);
     write2ByteUInt(&header[4], dataOffset);
     m_seqChanDataOffset = dataOffset;
@@ -1226,6 +2106,32 @@ void V2FSEQFile::writeHeader() {
         write(buf, 4);
         write(&a.data[0], a.data.size());
     }
+    if (hasExtendedBlockIndex()) {
+        //block count and offset of the index, filled in by finalize
+        uint8_t buf[4 + V2FSEQ_EXTENDED_INDEX_HEADER_SIZE];
+        memset(buf, 0, sizeof(buf));
+        write2ByteUInt(buf, sizeof(buf));
+        buf[2] = 'e';
+        buf[3] = 'i';
+        m_extendedIndexPos = tell() + 4;
+        write(buf, sizeof(buf));
+    }
+    if (isStriped()) {
+        uint8_t buf[4 + V2FSEQ_STRIPE_HEADER_SIZE];
+        write2ByteUInt(buf, sizeof(buf));
+        buf[2] = 'c';
+        buf[3] = 's';
+        write4ByteUInt(&buf[4], m_stripeSize);
+        write(buf, sizeof(buf));
+    }
+    if (hasCompressionDictionary()) {
+        uint8_t buf[4];
+        write2ByteUInt(buf, m_compressionDictionary.size() + 4);
+        buf[2] = 'z';
+        buf[3] = 'd';
+        write(buf, sizeof(buf));
+        write(&m_compressionDictionary[0], m_compressionDictionary.size());
+    }
     uint64_t pos = tell();
     if (pos != dataOffset) {
         char buf[4] = {0,0,0,0};
@@ -1239,7 +2145,10 @@ void V2FSEQFile::writeHeader() {
 V2FSEQFile::V2FSEQFile(const std::string &fn, FILE *file, const std::vector<uint8_t> &header)
 : FSEQFile(fn, file, header),
 m_compressionType(none),
-m_handler(nullptr)
+m_extendedIndexPos(0),
+m_stripeSize(0),
+m_handler(nullptr),
+m_supported(true)
 {
     if (header[0] == 'E') {
         uint32_t modelLen = read4ByteUInt(&header[16]);
@@ -1252,6 +2161,12 @@ m_handler(nullptr)
         //24-31 - timestamp/uuid/identifier
         uint64_t *a = (uint64_t*)&header[24];
         m_uniqueId = *a;
+
+        if (m_seqVersionMinor > V2FSEQ_MAX_VERSION_MINOR) {
+            LogErr(VB_SEQUENCE, "FSEQ v%d.%d is newer than this player supports\n", m_seqVersionMajor, m_seqVersionMinor);
+            m_supported = false;
+            return;
+        }
         
         switch (header[20]) {
             case 0:
@@ -1263,8 +2178,13 @@ m_handler(nullptr)
             case 2:
             m_compressionType = CompressionType::zlib;
             break;
+            case 3:
+            m_compressionType = CompressionType::zstdDelta;
+            break;
             default:
-            LogErr(VB_SEQUENCE, "Unknown compression type: %d", (int)header[32]);
+            LogErr(VB_SEQUENCE, "Unknown compression type: %d\n", (int)header[20]);
+            m_supported = false;
+            return;
         }
         
         uint32_t maxBlocks = header[21];
@@ -1295,10 +2215,92 @@ m_handler(nullptr)
             m_sparseRanges.push_back(std::pair<uint32_t, uint32_t>(st, len));
         }
         parseVariableHeaders(header, hoffset);
+        if (hasExtendedBlockIndex()) {
+            readExtendedBlockIndex();
+        }
+        readCompressionHeaders();
+        if (needsFeatureVersion() && m_seqVersionMinor < V2FSEQ_FEATURE_VERSION_MINOR) {
+            LogErr(VB_SEQUENCE, "FSEQ v%d.%d file uses features that need v%d.%d\n",
+                   m_seqVersionMajor, m_seqVersionMinor, m_seqVersionMajor, V2FSEQ_FEATURE_VERSION_MINOR);
+            m_supported = false;
+        }
+        if (!m_supported) {
+            return;
+        }
+    }
+    if (m_compressionType == CompressionType::none) {
+        mapFile();
     }
 
     createHandler();
 }
+void V2FSEQFile::readCompressionHeaders() {
+    //these are properties of how this file was written, don't let them
+    //get copied into other files via initializeFromFSEQ
+    for (auto it = m_variableHeaders.begin(); it != m_variableHeaders.end(); ) {
+        if (it->code[0] == 'c' && it->code[1] == 's') {
+            if (it->data.size() >= V2FSEQ_STRIPE_HEADER_SIZE) {
+                m_stripeSize = read4ByteUInt(&it->data[0]);
+            }
+            if (m_stripeSize == 0) {
+                //the blocks are striped but we can't tell how
+                LogErr(VB_SEQUENCE, "Invalid compression stripe header\n");
+                m_supported = false;
+            }
+            it = m_variableHeaders.erase(it);
+        } else if (it->code[0] == 'z' && it->code[1] == 'd') {
+            m_compressionDictionary = it->data;
+            if (!hasCompressionDictionary()) {
+                //empty, or not a zstd file, so the blocks can't be decoded
+                LogErr(VB_SEQUENCE, "Invalid compression dictionary header\n");
+                m_supported = false;
+            }
+            it = m_variableHeaders.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+void V2FSEQFile::readExtendedBlockIndex() {
+    for (auto it = m_variableHeaders.begin(); it != m_variableHeaders.end(); ++it) {
+        if (it->code[0] != 'e' || it->code[1] != 'i' || it->data.size() < V2FSEQ_EXTENDED_INDEX_HEADER_SIZE) {
+            continue;
+        }
+        uint32_t count = read4ByteUInt(&it->data[0]);
+        uint64_t indexOffset = read4ByteUInt(&it->data[8]);
+        indexOffset <<= 32;
+        indexOffset |= read4ByteUInt(&it->data[4]);
+        //the index is specific to this file, don't let it get copied
+        //into other files via initializeFromFSEQ
+        m_variableHeaders.erase(it);
+
+        std::vector<uint8_t> index(count * 8);
+        seek(indexOffset, SEEK_SET);
+        uint64_t bread = count ? read(&index[0], index.size()) : 0;
+        if (bread != index.size()) {
+            LogErr(VB_SEQUENCE, "Failed to read extended block index.  Needed to read %d but read %d\n", (int)index.size(), (int)bread);
+            count = bread / 8;
+        }
+        m_frameOffsets.clear();
+        uint64_t offset = m_seqChanDataOffset;
+        for (int x = 0; x < count; x++) {
+            uint32_t frame = read4ByteUInt(&index[x * 8]);
+            uint64_t dlen = read4ByteUInt(&index[x * 8 + 4]);
+            if (dlen > 0) {
+                m_frameOffsets.push_back(std::pair<uint32_t, uint64_t>(frame, offset));
+                offset += dlen;
+            }
+            if (x == 0) {
+                uint64_t doff = m_seqChanDataOffset;
+                preload(doff, dlen);
+            }
+        }
+        m_frameOffsets.push_back(std::pair<uint32_t, uint64_t>(99999999, offset));
+        return;
+    }
+    LogErr(VB_SEQUENCE, "FSEQ v%d.%d file is missing the extended block index\n", m_seqVersionMajor, m_seqVersionMinor);
+}
+
 V2FSEQFile::~V2FSEQFile() {
     if (m_handler) {
         delete m_handler;
@@ -1317,6 +2319,12 @@ void V2FSEQFile::dumpInfo(bool indent) {
     for (auto &a : m_frameOffsets) {
         LogDebug(VB_SEQUENCE, "%s      %d              : %" PRIu64 "\n", ind, a.first, a.second);
     }
+    if (m_stripeSize) {
+        LogDebug(VB_SEQUENCE, "%sstripeSize            : %d\n", ind, m_stripeSize);
+    }
+    if (!m_compressionDictionary.empty()) {
+        LogDebug(VB_SEQUENCE, "%sdictionarySize        : %d\n", ind, (int)m_compressionDictionary.size());
+    }
     LogDebug(VB_SEQUENCE, "%snumRanges             : %d\n", ind, m_sparseRanges.size());
     for (auto &a : m_sparseRanges) {
         LogDebug(VB_SEQUENCE, "%s      Start: %d    Len: %d\n", ind, a.first, a.second);
@@ -1324,6 +2332,77 @@ void V2FSEQFile::dumpInfo(bool indent) {
 }
 
 
+bool V2FSEQFile::trainCompressionDictionary(FSEQFile *src, uint32_t dictSize) {
+    m_compressionDictionary.clear();
+#ifndef NO_ZSTD
+    if (dictSize > V2FSEQ_MAX_DICTIONARY_SIZE) {
+        dictSize = V2FSEQ_MAX_DICTIONARY_SIZE;
+    }
+    uint32_t frameSize = std::max(m_seqChannelCount, src->getMaxChannel() + 1);
+    for (auto &a : m_sparseRanges) {
+        frameSize = std::max(frameSize, a.first + a.second);
+    }
+    std::vector<uint8_t> frame(frameSize);
+    std::vector<uint8_t> prevFrame(frameSize);
+
+    //about 100x the dictionary size in samples spread evenly over the
+    //sequence, each frame cut into 4K pieces for the trainer
+    static const uint32_t SAMPLE_SIZE = 4096;
+    uint64_t wanted = (uint64_t)dictSize * 100;
+    uint32_t numFrames = src->getNumFrames();
+    uint32_t sampleFrames = std::max((uint64_t)1, std::min((uint64_t)numFrames, wanted / frameSize));
+    std::vector<uint8_t> samples;
+    std::vector<size_t> sampleSizes;
+    for (uint32_t s = 0; s < sampleFrames && numFrames; s++) {
+        uint32_t f = (uint64_t)s * numFrames / sampleFrames;
+        FrameData *fdata = src->getFrame(f);
+        if (fdata == nullptr) {
+            continue;
+        }
+        fdata->readFrame(&frame[0]);
+        delete fdata;
+        if (m_compressionType == CompressionType::zstdDelta && f > 0) {
+            //most frames are stored as the XOR with the previous frame
+            fdata = src->getFrame(f - 1);
+            if (fdata) {
+                fdata->readFrame(&prevFrame[0]);
+                delete fdata;
+                for (uint32_t x = 0; x < frameSize; x++) {
+                    frame[x] ^= prevFrame[x];
+                }
+            }
+        }
+        //only the channels actually stored in the file
+        std::vector<std::pair<uint32_t, uint32_t>> ranges = m_sparseRanges;
+        if (ranges.empty()) {
+            ranges.push_back(std::pair<uint32_t, uint32_t>(0, m_seqChannelCount));
+        }
+        for (auto &r : ranges) {
+            for (uint32_t x = 0; x < r.second; x += SAMPLE_SIZE) {
+                uint32_t len = std::min(SAMPLE_SIZE, r.second - x);
+                samples.insert(samples.end(), &frame[r.first + x], &frame[r.first + x] + len);
+                sampleSizes.push_back(len);
+            }
+        }
+    }
+    if (sampleSizes.empty()) {
+        return false;
+    }
+    m_compressionDictionary.resize(dictSize);
+    size_t sz = ZDICT_trainFromBuffer(&m_compressionDictionary[0], dictSize,
+                                      &samples[0], &sampleSizes[0], sampleSizes.size());
+    if (ZDICT_isError(sz)) {
+        LogErr(VB_SEQUENCE, "Could not train compression dictionary: %s\n", ZDICT_getErrorName(sz));
+        m_compressionDictionary.clear();
+        return false;
+    }
+    m_compressionDictionary.resize(sz);
+    return true;
+#else
+    return false;
+#endif
+}
+
 void V2FSEQFile::prepareRead(const std::vector<std::pair<uint32_t, uint32_t>> &ranges) {
     if (m_sparseRanges.empty()) {
         m_rangesToRead = ranges;
@@ -1351,6 +2430,26 @@ void V2FSEQFile::prepareRead(const std::vector<std::pair<uint32_t, uint32_t>> &r
         m_dataBlockSize = m_seqChannelCount;
         m_rangesToRead = m_sparseRanges;
     }
+    if (isStriped() && m_handler) {
+        //sparse files are packed, the ranges to read are the sparse ranges
+        //which cover every stripe anyway
+        uint32_t stripes = (m_seqChannelCount + m_stripeSize - 1) / m_stripeSize;
+        std::vector<bool> stripesNeeded(stripes, !m_sparseRanges.empty());
+        if (m_sparseRanges.empty()) {
+            for (auto &rng : m_rangesToRead) {
+                if (rng.second == 0 || rng.first >= m_seqChannelCount) {
+                    continue;
+                }
+                uint32_t last = (rng.first + rng.second - 1) / m_stripeSize;
+                for (uint32_t x = rng.first / m_stripeSize; x <= last && x < stripes; x++) {
+                    stripesNeeded[x] = true;
+                }
+            }
+        }
+        m_handler->setStripesNeeded(stripesNeeded);
+    }
+    setMappedRanges(m_rangesToRead, !m_sparseRanges.empty());
+    m_framePool->setLayout(m_dataBlockSize, m_rangesToRead);
     FrameData *f = getFrame(0);
     if (f) {
         delete f;
@@ -1370,6 +2469,16 @@ FrameData *V2FSEQFile::getFrame(uint32_t frame) {
     }
     return nullptr;
 }
+void V2FSEQFile::setReadAhead(int blocks, uint64_t memoryLimit) {
+    if (m_handler != nullptr) {
+        m_handler->setReadAhead(blocks, memoryLimit);
+    }
+}
+void V2FSEQFile::setCompressionThreads(int threads) {
+    if (m_handler != nullptr) {
+        m_handler->setCompressionThreads(threads);
+    }
+}
 void V2FSEQFile::addFrame(uint32_t frame,
                           const uint8_t *data) {
     if (m_handler != nullptr) {
@@ -4,6 +4,10 @@
 #include <stdio.h>
 #include <string>
 #include <vector>
+#include <memory>
+
+class FSEQMappedFile;
+class FSEQFramePool;
 
 class FSEQFile {
 public:
@@ -34,7 +38,8 @@ public:
     enum CompressionType {
         none,
         zstd,
-        zlib
+        zlib,
+        zstdDelta  //zstd of each frame XOR'd with the previous frame
     };
 
 protected:
@@ -66,6 +71,23 @@ public:
     //read those frames.
     virtual void prepareRead(const std::vector<std::pair<uint32_t, uint32_t>> &ranges) {}
     
+    //For compressed files, the number of compression blocks to decompress in the
+    //background ahead of the block currently being read and the maximum amount
+    //of memory (in bytes) those decompressed blocks may use.  0 blocks disables
+    //the background decompression.
+    virtual void setReadAhead(int blocks, uint64_t memoryLimit) {}
+
+    //For uncompressed files, the number of frames ahead of the frame being
+    //read that the OS should start loading into the page cache
+    void setReadAheadFrames(int frames) { m_readAheadFrames = frames; }
+
+    //Frame buffers are recycled through a pool, frames is the number of
+    //unused buffers the pool will keep around for reuse.  The counters
+    //report how many buffers had to be allocated vs were reused.
+    void setFramePoolSize(int frames);
+    uint64_t getFramePoolAllocations() const;
+    uint64_t getFramePoolReuses() const;
+
     //For reading data from the fseq file, returns an object can
     //provide the necessary data in a timely fassion for the given frame
     //It may not be used right away and will be deleted at some point in the future
@@ -77,6 +99,10 @@ public:
     virtual void addFrame(uint32_t frame,
                           const uint8_t *data) = 0;
     virtual void finalize();
+
+    //For compressed files, the number of threads used to compress blocks
+    //in parallel while writing.  Must be called before the first addFrame.
+    virtual void setCompressionThreads(int threads) {}
     
     virtual void dumpInfo(bool indent = false);
     
@@ -92,6 +118,7 @@ public:
     void setNumFrames(uint32_t f) { m_seqNumFrames = f; }
     void setStepTime(int st) { m_seqStepTime = st; }
     void setChannelCount(int cc) { m_seqChannelCount = cc; }
+    void setVersionMinor(int v) { m_seqVersionMinor = v; }
     void addVariableHeader(const VariableHeader &header) { m_variableHeaders.push_back(header);}
 
     
@@ -117,8 +144,18 @@ protected:
     uint64_t write(const void * ptr, uint64_t size);
     uint64_t read(void *ptr, uint64_t size);
     void preload(uint64_t pos, uint64_t size);
+
+    //uncompressed files are memory mapped so frames can be copied
+    //straight out of the page cache instead of read into a buffer first
+    bool mapFile();
+    void setMappedRanges(const std::vector<std::pair<uint32_t, uint32_t>> &ranges, bool packed);
+    FrameData *getMappedFrame(uint32_t frame, uint64_t offset, uint32_t frameSize);
+    std::shared_ptr<FSEQMappedFile> m_mappedFile;
+    std::shared_ptr<FSEQFramePool> m_framePool;
     
 private:
+    int           m_readAheadFrames;
+    uint32_t      m_willNeedFrame;
     FILE* volatile  m_seqFile;
     std::vector<uint8_t> m_memoryBuffer;
     uint64_t      m_memoryBufferPos;
@@ -160,6 +197,8 @@ public:
     virtual ~V2FSEQFile();
     
     virtual void prepareRead(const std::vector<std::pair<uint32_t, uint32_t>> &ranges) override;
+    virtual void setReadAhead(int blocks, uint64_t memoryLimit) override;
+    virtual void setCompressionThreads(int threads) override;
     virtual FrameData *getFrame(uint32_t frame) override;
     
     virtual void writeHeader() override;
@@ -171,6 +210,26 @@ public:
 
     virtual uint32_t getMaxChannel() const override;
 
+    //v2.1+ compressed files store the block index after the channel data
+    //so the number of blocks is not limited to 255
+    bool hasExtendedBlockIndex() const { return m_seqVersionMinor >= 1 && m_compressionType != CompressionType::none; }
+    //compressed files may store each block as independently compressed
+    //stripes of m_stripeSize channels so a reader only needs to decompress
+    //the stripes containing the channels it is going to use
+    bool isStriped() const { return m_stripeSize != 0 && m_compressionType != CompressionType::none; }
+    //zstd compressed files may carry a dictionary that every block is
+    //compressed with
+    bool hasCompressionDictionary() const {
+        return !m_compressionDictionary.empty()
+            && (m_compressionType == CompressionType::zstd || m_compressionType == CompressionType::zstdDelta);
+    }
+    //train a compression dictionary from a sample of the frames in src,
+    //must be called before writeHeader
+    bool trainCompressionDictionary(FSEQFile *src, uint32_t dictSize);
+    //false if the file needs a newer reader, openFSEQFile will not
+    //return it
+    bool isSupported() const { return m_supported; }
+
     
     CompressionType m_compressionType;
     int             m_compressionLevel;
@@ -178,11 +237,18 @@ public:
     std::vector<std::pair<uint32_t, uint32_t>> m_rangesToRead;
     std::vector<std::pair<uint32_t, uint64_t>> m_frameOffsets;
     uint32_t m_dataBlockSize;
+    uint64_t m_extendedIndexPos;
+    uint32_t m_stripeSize;
+    std::vector<uint8_t> m_compressionDictionary;
 private:
     
     void createHandler();
+    void readExtendedBlockIndex();
+    void readCompressionHeaders();
+    bool needsFeatureVersion() const;
     
     V2Handler *m_handler;
+    bool m_supported;
     friend class V2Handler;
 };
 
@@ -3,6 +3,10 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+#include <chrono>
 
 #include "fppversion.h"
 #include "log.h"
@@ -16,20 +20,29 @@ void usage(char *appname) {
     printf("   -V                - Print version information\n");
     printf("   -v                - verbose\n");
     printf("   -o OUTPUTFILE     - Filename for Output FSEQ\n");
-    printf("   -f #              - FSEQ Version\n");
-    printf("   -c (none|zstd|zlib) - Compession type\n");
+    printf("   -f #              - FSEQ Version (1, 2, or 2.1 for fine grained compression blocks)\n");
+    printf("   -c (none|zstd|zlib|zstd-delta) - Compession type\n");
     printf("   -l #              - Compession level (-1 for default)\n");
+    printf("   -j #              - Number of threads to compress with (0 for one per core)\n");
+    printf("   -s #              - Compress blocks in stripes of # channels so remotes only decode their channels\n");
+    printf("   -d #              - Train a zstd dictionary of # KB (max 32) from the sequence and store it in the file\n");
     printf("   -r (#-# | #+#)    - Channel Range.  Use - to separate start/end channel\n");
     printf("                            Use + to separate start channel + num channels\n");
     printf("   -n                - No Sparse. -r will only read the range, but the resulting fseq is not sparse.\n");
+    printf("   -b                - Benchmark the compression ratio and decode speed of each compression type\n");
     printf("   -h                - This help output\n");
 }
 const char *outputFilename = nullptr;
 static int fseqVersion = 2;
+static int fseqVersionMinor = 0;
 static int compressionLevel = -1;
+static int compressionThreads = 1;
+static int stripeSize = 0;
+static int dictionarySize = 0;
 static bool verbose = false;
 static std::vector<std::pair<uint32_t, uint32_t>> ranges;
 static bool sparse = true;
+static bool benchmark = false;
 static V2FSEQFile::CompressionType compressionType = V2FSEQFile::CompressionType::zstd;
 
 int parseArguments(int argc, char **argv) {
@@ -46,7 +59,7 @@ int parseArguments(int argc, char **argv) {
             {0,                0,                    0, 0}
         };
         
-        c = getopt_long(argc, argv, "c:l:o:f:r:hVvn", long_options, &option_index);
+        c = getopt_long(argc, argv, "c:l:j:s:d:o:f:r:hVvnb", long_options, &option_index);
         if (c == -1) {
             break;
         }
@@ -73,6 +86,8 @@ int parseArguments(int argc, char **argv) {
                     compressionType = V2FSEQFile::CompressionType::none;
                 } else if (strcmp(optarg, "zlib") == 0) {
                     compressionType = V2FSEQFile::CompressionType::zlib;
+                } else if (strcmp(optarg, "zstd-delta") == 0) {
+                    compressionType = V2FSEQFile::CompressionType::zstdDelta;
                 } else {
                     compressionType = V2FSEQFile::CompressionType::zstd;
                 }
@@ -80,8 +95,22 @@ int parseArguments(int argc, char **argv) {
             case 'l':
                 compressionLevel = strtol(optarg, NULL, 10);
                 break;
-            case 'f':
-                fseqVersion = strtol(optarg, NULL, 10);
+            case 'j':
+                compressionThreads = strtol(optarg, NULL, 10);
+                break;
+            case 's':
+                stripeSize = strtol(optarg, NULL, 10);
+                break;
+            case 'd':
+                dictionarySize = strtol(optarg, NULL, 10) * 1024;
+                break;
+            case 'f': {
+                    char *end = optarg;
+                    fseqVersion = strtol(optarg, &end, 10);
+                    if (*end == '.') {
+                        fseqVersionMinor = strtol(end + 1, NULL, 10);
+                    }
+                }
                 break;
             case 'o':
                 outputFilename = optarg;
@@ -89,6 +118,9 @@ int parseArguments(int argc, char **argv) {
             case 'n':
                 sparse = false;
                 break;
+            case 'b':
+                benchmark = true;
+                break;
             case 'V':
                 printVersionInfo();
                 exit(0);
@@ -103,18 +135,126 @@ int parseArguments(int argc, char **argv) {
     return this_option_optind;
 }
 
+static void copyFrames(FSEQFile *src, FSEQFile *dest) {
+    static uint8_t data[1024*1024];
+    for (int x = 0; x < src->getNumFrames(); x++) {
+        FSEQFile::FrameData *fdata = src->getFrame(x);
+        fdata->readFrame(data);
+        delete fdata;
+        dest->addFrame(x, data);
+    }
+    dest->finalize();
+}
+
+static double elapsedSeconds(const std::chrono::steady_clock::time_point &start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//time how long it takes to decode every frame of fn on a single thread
+static bool timeDecode(const std::string &fn, uint64_t &size, double &decodeTime) {
+    static uint8_t data[1024*1024];
+    FSEQFile *f = FSEQFile::openFSEQFile(fn);
+    if (f == nullptr) {
+        return false;
+    }
+    size = 0;
+    FILE *file = fopen(fn.c_str(), "rb");
+    if (file) {
+        fseeko(file, 0, SEEK_END);
+        size = ftello(file);
+        fclose(file);
+    }
+    //decode on this thread only so the time is the cost per frame
+    f->setReadAhead(0, 0);
+    f->prepareRead({{0, f->getMaxChannel() + 1}});
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int x = 0; x < f->getNumFrames(); x++) {
+        FSEQFile::FrameData *fdata = f->getFrame(x);
+        fdata->readFrame(data);
+        delete fdata;
+    }
+    decodeTime = elapsedSeconds(start);
+    delete f;
+    return true;
+}
+
+static void printResultHeader() {
+    printf("%-16s %12s %8s %12s %12s %12s\n", "Type", "Size", "Ratio", "Compress(s)", "Decode(s)", "us/frame");
+}
+
+static void printResult(const char *name, uint64_t size, uint64_t rawSize,
+                        double compressTime, double decodeTime, uint32_t frames) {
+    printf("%-16s %12" PRIu64 " %7.2fx %12.3f %12.3f %12.1f\n", name, size,
+           size ? (double)rawSize / size : 0.0,
+           compressTime, decodeTime,
+           frames ? decodeTime * 1000000.0 / frames : 0.0);
+}
+
+//compress the source with each compression type and then time how long it
+//takes to decode every frame on a single thread
+static void runBenchmark(FSEQFile *src, const std::string &fn) {
+    static const char *names[] = { "zstd", "zlib", "zstd-delta", "zstd+dict", "zstd-delta+dict" };
+    static const V2FSEQFile::CompressionType types[] = {
+        V2FSEQFile::CompressionType::zstd,
+        V2FSEQFile::CompressionType::zlib,
+        V2FSEQFile::CompressionType::zstdDelta,
+        V2FSEQFile::CompressionType::zstd,
+        V2FSEQFile::CompressionType::zstdDelta
+    };
+    static const bool useDictionary[] = { false, false, false, true, true };
+    uint64_t rawSize = (uint64_t)src->getChannelCount() * src->getNumFrames();
+
+    printResultHeader();
+    for (int t = 0; t < 5; t++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        FSEQFile *dest = FSEQFile::createFSEQFile(fn, 2, types[t], compressionLevel);
+        dest->setVersionMinor(fseqVersionMinor);
+        dest->setCompressionThreads(compressionThreads);
+        ((V2FSEQFile*)dest)->m_stripeSize = stripeSize;
+        dest->initializeFromFSEQ(*src);
+        if (useDictionary[t]) {
+            ((V2FSEQFile*)dest)->trainCompressionDictionary(src, dictionarySize ? dictionarySize : 16 * 1024);
+        }
+        dest->writeHeader();
+        copyFrames(src, dest);
+        delete dest;
+        double compressTime = elapsedSeconds(start);
+
+        uint64_t size;
+        double decodeTime;
+        if (!timeDecode(fn, size, decodeTime)) {
+            continue;
+        }
+        printResult(names[t], size, rawSize, compressTime, decodeTime, src->getNumFrames());
+    }
+    unlink(fn.c_str());
+}
+
 int main(int argc, char *argv[]) {
     int idx = parseArguments(argc, argv);
     if (verbose) {
         SetLogLevel("debug");
     }
     FSEQFile *src = FSEQFile::openFSEQFile(argv[idx]);
-    if (src) {
-        
+    if (src && benchmark) {
+        if (ranges.empty()) {
+            ranges.push_back(std::pair<uint32_t, uint32_t>(0, 999999999));
+        }
+        src->prepareRead(ranges);
+        std::string fn = outputFilename ? outputFilename : std::string(argv[idx]) + ".benchmark";
+        runBenchmark(src, fn);
+        delete src;
+    } else if (src) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
         FSEQFile *dest = FSEQFile::createFSEQFile(outputFilename,
                                                   fseqVersion,
                                                   compressionType,
                                                   compressionLevel);
+        if (fseqVersion == 2) {
+            dest->setVersionMinor(fseqVersionMinor);
+            ((V2FSEQFile*)dest)->m_stripeSize = stripeSize;
+        }
+        dest->setCompressionThreads(compressionThreads);
         if (ranges.empty()) {
             ranges.push_back(std::pair<uint32_t, uint32_t>(0, 999999999));
         } else if (fseqVersion == 2 && sparse) {
@@ -124,23 +264,31 @@ int main(int argc, char *argv[]) {
         src->prepareRead(ranges);
 
         dest->initializeFromFSEQ(*src);
-        dest->writeHeader();
-        
-        uint8_t data[1024*1024];
-        for (int x = 0; x < src->getNumFrames(); x++) {
-            FSEQFile::FrameData *fdata = src->getFrame(x);
-            fdata->readFrame(data);
-            delete fdata;
-            dest->addFrame(x, data);
+        if (fseqVersion == 2 && dictionarySize) {
+            ((V2FSEQFile*)dest)->trainCompressionDictionary(src, dictionarySize);
         }
-        dest->finalize();
+        dest->writeHeader();
+        copyFrames(src, dest);
         
         if (!strcmp(outputFilename, "-memory-")) {
             printf("size: %d\n", (int)dest->getMemoryBuffer().size());
         }
+        bool report = fseqVersion == 2 && ((V2FSEQFile*)dest)->hasCompressionDictionary()
+            && strcmp(outputFilename, "-memory-");
+        uint64_t rawSize = (uint64_t)dest->getChannelCount() * dest->getNumFrames();
+        uint32_t frames = dest->getNumFrames();
         
         delete dest;
         delete src;
+
+        //show what the dictionary bought
+        uint64_t size;
+        double decodeTime;
+        if (report && timeDecode(outputFilename, size, decodeTime)) {
+            printResultHeader();
+            printResult(compressionType == V2FSEQFile::CompressionType::zstdDelta ? "zstd-delta+dict" : "zstd+dict",
+                        size, rawSize, elapsedSeconds(start), decodeTime, frames);
+        }
     }
 
     
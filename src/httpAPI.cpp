@@ -26,6 +26,8 @@
 
 #include "channeloutput/channeloutput.h"
 #include "channeloutput/channeloutputthread.h"
+#include "channeloutput/FrameDiff.h"
+#include "channeloutput/OutputMetrics.h"
 #include "common.h"
 #include "e131bridge.h"
 #include "fpp.h"
@@ -37,6 +39,7 @@
 #include "playlist/Playlist.h"
 #include "Scheduler.h"
 #include "settings.h"
+#include "Threads.h"
 
 #include <fstream>
 #include <iostream>
@@ -82,7 +85,11 @@ void APIServer::Init(void)
 	m_pr = new PlayerResource;
 	m_ws->register_resource("/fppd", m_pr, true);
 
+	// the web server's threads inherit the scheduling of the thread that
+	// starts them, so start them as HTTP threads
+	SetThreadRole(THREAD_ROLE_HTTP);
 	m_ws->start(false);
+	SetThreadRole(THREAD_ROLE_MAIN);
 }
 
 /*
@@ -152,6 +159,14 @@ const http_response PlayerResource::render_GET(const http_request &req)
 	{
 		GetMultiSyncSystems(result);
 	}
+	else if (url == "outputs/timing")
+	{
+		GetOutputTimings(result);
+	}
+	else if (url == "metrics")
+	{
+		GetMetrics(result);
+	}
 	else if (url == "playlist/filetime")
 	{
 		GetPlaylistFileTime(result);
@@ -276,6 +291,12 @@ const http_response PlayerResource::render_POST(const http_request &req)
 		SetLogMask(url.c_str());
 		SetOKResult(result, "Log Mask set");
 	}
+	else if (url == "metrics/reset")
+	{
+		ResetOutputMetrics();        // OutputMetrics.cpp
+		ResetChannelOutputTimings(); // channeloutput.c
+		SetOKResult(result, "Metrics reset");
+	}
 	else if (url == "outputs")
 	{
 		PostOutputs(data, result);
@@ -649,6 +670,29 @@ void PlayerResource::GetMultiSyncSystems(Json::Value &result)
 		SetErrorResult(result, 400, "MultiSync did not return any systems.");
 }
 
+/*
+ *
+ */
+void PlayerResource::GetOutputTimings(Json::Value &result)
+{
+	GetChannelOutputTimings(result); // channeloutput.c
+
+	SetOKResult(result, "");
+}
+
+/*
+ *
+ */
+void PlayerResource::GetMetrics(Json::Value &result)
+{
+	GetOutputMetrics(result);        // OutputMetrics.cpp
+	GetChannelOutputTimings(result); // channeloutput.c
+	GetFrameDiffStats(result);       // FrameDiff.cpp
+	GetThreadInfo(result);           // Threads.cpp
+
+	SetOKResult(result, "");
+}
+
 /*
  *
  */
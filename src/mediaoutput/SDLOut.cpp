@@ -58,6 +58,7 @@ extern "C"
 #include "Sequence.h"
 #include "settings.h"
 #include "PixelOverlay.h"
+#include "Threads.h"
 
 #define DEFAULT_RATE 44100
 
@@ -428,6 +429,7 @@ public:
     virtual ~SDL();
     
     static void decodeThreadEntry(SDL *sdl) {
+        SetThreadRole(THREAD_ROLE_MEDIA, "fpp-sdldecode");
         sdl->runDecode();
     }
     bool Start(SDLInternalData *d) {
@@ -107,6 +107,34 @@ function flashEMMCBtrfs() {
 				output devices such as the FPD do not support rates other than 50ms.</td>
 		</tr>
 		<tr><td colspan='2'><hr></td></tr>
+		<tr><td valign='top'><? PrintSettingSelect("Bridge Receive Threads", "BridgeReceiveThreads", 1, 0, "0", Array('Auto' => '0', '1' => '1', '2' => '2', '3' => '3', '4' => '4')); ?><br>
+				<? PrintSettingSelect("Bridge Receive Buffer", "BridgeReceiveBuffer", 1, 0, "4096", Array('1MB' => '1024', '4MB' => '4096', '16MB' => '16384')); ?><br>
+				<? PrintSettingSelect("Bridge Busy Poll", "BridgeBusyPoll", 1, 0, "0", Array('Disabled' => '0', '50us' => '50', '100us' => '100')); ?></td>
+			<td valign='top'><b>Bridge Receive Threads</b> - The number of
+				threads receiving E1.31 and DDP data in Bridge Mode.  Unicast
+				senders are spread over the threads by the kernel, multicast
+				universes are all received by the first thread so they stay
+				in order with their sync packets.  Auto uses half
+				the CPU cores, up to 4.  <b>Bridge Receive Buffer</b> is the
+				socket buffer size for each thread, larger buffers ride out
+				bursts of packets.  <b>Bridge Busy Poll</b> keeps the threads
+				polling the network for a while after each packet instead of
+				sleeping, lowering latency at the cost of CPU time.
+				Changing these values requires a FPPD restart.</td>
+		</tr>
+		<tr><td colspan='2'><hr></td></tr>
+		<tr><td valign='top'><? PrintSettingText("BridgeSyncUniverse", 1, 0, 5, 5, "", "0"); ?><br>
+				<? PrintSettingSave("Bridge Sync Universe", "BridgeSyncUniverse", 1, 0); ?><br>
+				<? PrintSettingSelect("Bridge Sync Timeout", "BridgeSyncTimeout", 1, 0, "1000", Array('250ms' => '250', '1s' => '1000', '2.5s' => '2500')); ?></td>
+			<td valign='top'><b>Bridge Sync Universe</b> - In Bridge Mode the
+				received data is held until an E1.31 sync packet for this
+				universe or a DDP push arrives so a whole frame is output at
+				once.  0 accepts sync packets for any universe.  If no sync
+				packet or push arrives within the <b>Bridge Sync Timeout</b>
+				the data is output as it arrives.  Changing these values
+				requires a FPPD restart.</td>
+		</tr>
+		<tr><td colspan='2'><hr></td></tr>
 		<tr><td valign='top'><? PrintSettingSelect("Boot Delay", "bootDelay", 0, 0, "0", Array('0s' => '0', '1s' => '1', '2s' => '2', '3s' => '3', '4s' => '4', '5s' => '5', '6s' => '6', '7s' => '7', '8s' => '8', '9s' => '9', '10s' => '10', '15s' => '10', '20s' => '20', '25s' => '25', '30s' => '30')); ?></td>
 			<td valign='top'><b>Boot Delay</b> - The time that FPP waits after
 				system boot up to start fppd.  For environments that are
@@ -117,6 +145,89 @@ function flashEMMCBtrfs() {
 				give the network switches and routers time to fully start up.</td>
 		</tr>
 		<tr><td colspan='2'><hr></td></tr>
+		<tr><td valign='top'><? PrintSettingSelect("Sequence Read Ahead Blocks", "fseqReadAheadBlocks", 0, 0, "2", Array('Disabled' => '0', '1' => '1', '2' => '2', '3' => '3', '4' => '4')); ?><br>
+				<? PrintSettingSelect("Sequence Read Ahead Memory", "fseqReadAheadMemory", 0, 0, "64", Array('16MB' => '16', '32MB' => '32', '64MB' => '64', '128MB' => '128', '256MB' => '256')); ?></td>
+			<td valign='top'><b>Sequence Read Ahead</b> - The number of
+				compression blocks of a compressed sequence that are
+				decompressed in the background while the current block is
+				playing and the maximum memory those blocks may use.  Larger
+				sequences may need more memory for the read ahead to be used.
+				Takes effect the next time a sequence is started.</td>
+		</tr>
+		<tr><td colspan='2'><hr></td></tr>
+		<tr><td valign='top'><? PrintSettingSelect("Channel Output Threads", "ChannelOutputThreads", 1, 0, "1", Array('Disabled' => '1', '2' => '2', '3' => '3', '4' => '4', 'Auto' => 'auto')); ?></td>
+			<td valign='top'><b>Channel Output Threads</b> - The number of
+				threads used to prepare and send the channel data for the
+				configured outputs each frame.  Outputs are run at the same
+				time so a slow output does not delay the others.  Only enable
+				this if all the configured outputs can safely run at the same
+				time.  Auto uses one thread per CPU core, Disabled (the
+				default) runs the outputs one after another.  Outputs with
+				"ordered" set in their config are always run in config order
+				on the output thread.
+				Changing this value requires a FPPD restart.</td>
+		</tr>
+		<tr><td colspan='2'><hr></td></tr>
+		<tr><td valign='top'><? PrintSettingSelect("Real Time Threads", "RealTimeThreads", 1, 0, "0", Array('Disabled' => '0', 'Enabled' => '1')); ?><br>
+				<? PrintSettingSelect("Lock Memory", "LockMemory", 1, 0, "0", Array('Disabled' => '0', 'Enabled' => '1')); ?></td>
+			<td valign='top'><b>Real Time Threads</b> - Run the channel output
+				threads with real time priority so they are not held up by the
+				web interface or media decoding.  On systems with four or more
+				cores the output threads are also kept on the upper half of the
+				cores and the web server, media and network threads on the
+				lower half.  The CPUs and priority of each thread role can be
+				changed with the &lt;Role&gt;ThreadCPUs and
+				&lt;Role&gt;ThreadPriority settings.  <b>Lock Memory</b> keeps
+				all of fppd in RAM so it is never paged out.
+				Changing these values requires a FPPD restart.</td>
+		</tr>
+		<tr><td colspan='2'><hr></td></tr>
+		<tr><td valign='top'><? PrintSettingSelect("Pipeline Channel Output", "PipelineChannelOutput", 1, 0, "0", Array('Disabled' => '0', 'Enabled' => '1')); ?></td>
+			<td valign='top'><b>Pipeline Channel Output</b> - Read and process
+				the next frame on a separate thread while the current frame is
+				being sent to the outputs.  This allows higher frame rates on
+				multi-core systems when reading/processing and sending each take
+				a good part of the frame time.  Takes effect the next time the
+				output thread is started.</td>
+		</tr>
+		<tr><td colspan='2'><hr></td></tr>
+		<tr><td valign='top'><? PrintSettingSelect("Skip Unchanged Universes", "SkipUnchangedUniverses", 1, 0, "0", Array('Disabled' => '0', 'Enabled' => '1')); ?><br>
+				<? PrintSettingSelect("Universe Keep Alive", "UniverseKeepAlive", 1, 0, "1000", Array('250ms' => '250', '500ms' => '500', '1s' => '1000', '2s' => '2000')); ?></td>
+			<td valign='top'><b>Skip Unchanged Universes</b> - Only send
+				E1.31, ArtNet and DDP packets whose channels changed since the
+				last frame.  Packets which have not changed are still resent
+				every <b>Universe Keep Alive</b> so controllers do not time
+				out.  Cuts network traffic a lot for mostly static displays.
+				Changing these values requires a FPPD restart.</td>
+		</tr>
+		<tr><td colspan='2'><hr></td></tr>
+		<tr><td valign='top'><? PrintSettingSelect("UDP Transmit Thread", "UDPTransmitThread", 1, 0, "0", Array('Disabled' => '0', 'Enabled' => '1')); ?><br>
+				<? PrintSettingSelect("UDP Pacing", "UDPPacing", 1, 0, "0", Array('None' => '0', '25%' => '25', '50%' => '50', '75%' => '75')); ?><br>
+				<? PrintSettingSelect("UDP Kernel Timed Send", "UDPTxTime", 1, 0, "0", Array('Disabled' => '0', 'Enabled' => '1')); ?></td>
+			<td valign='top'><b>UDP Transmit Thread</b> - Send E1.31, ArtNet
+				and DDP packets from their own thread so the channel output
+				thread does not wait on the network.  <b>UDP Pacing</b> spreads
+				each controller's packets over that part of the frame time
+				instead of sending the whole frame as one burst, which helps
+				switches and controllers with small buffers.  <b>UDP Kernel
+				Timed Send</b> lets the kernel time each packet (SO_TXTIME,
+				needs the fq qdisc on the interface).  Per controller packet,
+				drop and late counts are shown in the output timings.
+				Changing these values requires a FPPD restart.</td>
+		</tr>
+		<tr><td colspan='2'><hr></td></tr>
+		<tr><td valign='top'><? PrintSettingSelect("UDP Segmentation Offload", "UDPSegmentOffload", 1, 0, "0", Array('Disabled' => '0', 'Enabled' => '1')); ?></td>
+			<td valign='top'><b>UDP Segmentation Offload</b> - Hand the
+				kernel all the DDP, E1.31 or ArtNet packets for a controller
+				in one send and let it split them into packets (UDP GSO).
+				Reduces the CPU time spent sending to controllers with a lot
+				of channels.  Falls back to sending each packet when the
+				kernel or network device can't do it.  Not used together with
+				UDP Kernel Timed Send.  The send time per packet is shown in
+				the output timings.  Changing this value requires a FPPD
+				restart.</td>
+		</tr>
+		<tr><td colspan='2'><hr></td></tr>
 <?
 	if ($settings['fppMode'] != 'remote')
 	{